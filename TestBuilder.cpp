@@ -186,3 +186,64 @@ int f0(int a0)
 }
 )");
 }
+
+TEST(Builder, Array)
+{
+	auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+
+	auto a = f <<= comp::declaration(comp::array(comp::ast::ValueType::integer(), f[0]));
+	f <<= a[0] = a.length();
+	f <<= comp::ret(a[f[0] - 1]);
+
+	CHECK(std::string("\n") + f.build().dumpAst() == R"(
+struct c0
+{
+};
+
+int f0(int a0)
+{
+    int[] l0 = new int[a0];
+    l0[0] = l0.length;
+    return l0[a0 - 1];
+}
+)");
+}
+
+TEST(Builder, Layout)
+{
+	auto base = comp::ClassBuilder::make();
+	auto fFlag = base.addField(comp::ast::ValueType::logical());
+	auto fCount = base.addField(comp::ast::ValueType::integer());
+	auto fNext = base.addField(base);
+	base.addStaticField(comp::ast::ValueType::int8());
+
+	auto derived = comp::ClassBuilder::make(base);
+	auto fTag = derived.addField(comp::ast::ValueType::uint8());
+	auto fShort = derived.addField(comp::ast::ValueType::int16());
+	auto fNative = derived.addField(comp::ast::ValueType::native());
+	auto fScale = derived.addField(comp::ast::ValueType::floating());
+
+	using Area = comp::ast::Class::Layout::Area;
+	const auto b = base.data->getLayout(), d = derived.data->getLayout();
+
+	CHECK(b.nReferences == 1 && b.nScalars == 0 && b.nBytes == 5);
+	CHECK(b.fields[fCount.index].area == Area::Bytes && b.fields[fCount.index].offset == 0);
+	CHECK(b.fields[fFlag.index].area == Area::Bytes && b.fields[fFlag.index].offset == 4);
+	CHECK(b.fields[fNext.index].area == Area::References && b.fields[fNext.index].offset == 0);
+
+	CHECK(d.nReferences == 1 && d.nScalars == 1 && d.nBytes == 15);
+	CHECK(d.fields[fScale.index].offset == 8 && d.fields[fScale.index].width == 4);
+	CHECK(d.fields[fShort.index].offset == 12 && d.fields[fShort.index].width == 2);
+	CHECK(d.fields[fTag.index].offset == 14 && d.fields[fTag.index].width == 1);
+	CHECK(d.fields[fNative.index].area == Area::Scalars);
+
+	auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {});
+	auto l = f <<= comp::declaration(derived());
+	f <<= comp::ret(l[fShort] + l[fTag]);
+
+	const auto types = f.build().generateTypes();
+	CHECK(types.size() == 3);
+	CHECK(types[0] == prog::TypeInfo(0, 0, 1, 0));  // statics are not packed
+	CHECK(types[1] == prog::TypeInfo(2, 1, 1, 15));
+	CHECK(types[2] == prog::TypeInfo(0, 1, 0, 5));
+}
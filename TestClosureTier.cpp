@@ -0,0 +1,254 @@
+#include "1test/Test.h"
+
+#include "vm/Scheduler.h"
+
+#include "compiler/internal/Compiler.h"
+
+TEST_GROUP(ClosureTier)
+{
+	vm::Storage storage;
+
+	const prog::Program loopFactorial = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 1),
+					/* 1 */ prog::Instruction::lit({}, 0),
+					/* 2 */ prog::Instruction::jNe(0, {}, 4),
+					/* 3 */ prog::Instruction::ret(0, 1),
+					/* 4 */ prog::Instruction::mulI(1, 1, 0),
+					/* 5 */ prog::Instruction::lit({}, 1),
+					/* 6 */ prog::Instruction::subI(0, 0, {}),
+					/* 7 */ prog::Instruction::jump(1),
+				}
+			}
+		}
+	};
+
+	const prog::Program fibonacci = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 5,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 2),
+					/*  1 */ prog::Instruction::jLtI(0, {}, 12),
+					/*  2 */ prog::Instruction::lit({}, 1),
+					/*  3 */ prog::Instruction::subI({}, 0, {}),
+					/*  4 */ prog::Instruction::lit({}, 0),
+					/*  5 */ prog::Instruction::call(0, 1),
+					/*  6 */ prog::Instruction::lit({}, 2),
+					/*  7 */ prog::Instruction::subI({}, 0, {}),
+					/*  8 */ prog::Instruction::lit({}, 0),
+					/*  9 */ prog::Instruction::call(0, 1),
+					/* 10 */ prog::Instruction::addI({}, {}, {}),
+					/* 11 */ prog::Instruction::ret(0, 1),
+					/* 12 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+};
+
+TEST(ClosureTier, BackEdge)
+{
+	for(const auto &p: {loopFactorial, comp::Compiler::fuseInstructions(loopFactorial)})
+	{
+		vm::Vm uut(storage, p);
+		uut.enableClosureTier(1000, 3);
+
+		CHECK(2 == uut.run({}, {2}).second.front().integer);
+		CHECK(0 == uut.getStatistics().tierUps);
+
+		CHECK(5040 == uut.run({}, {7}).second.front().integer);
+		CHECK(1 == uut.getStatistics().tierUps);
+
+		CHECK(362880 == uut.run({}, {9}).second.front().integer);
+		CHECK(1 == uut.getStatistics().tierUps);
+	}
+}
+
+TEST(ClosureTier, Calls)
+{
+	for(const auto &p: {fibonacci, comp::Compiler::fuseInstructions(fibonacci)})
+	{
+		vm::Vm uut(storage, p);
+		uut.enableClosureTier(5, 1000);
+
+		CHECK(1 == uut.run({}, {2}).second.front().integer);
+		CHECK(0 == uut.getStatistics().tierUps);
+
+		CHECK(610 == uut.run({}, {15}).second.front().integer);
+		CHECK(1 == uut.getStatistics().tierUps);
+
+		vm::Vm interpreter(storage, p);
+		interpreter.run({}, {2});
+		interpreter.run({}, {15});
+		CHECK(interpreter.getStatistics().instructions == uut.getStatistics().instructions);
+		CHECK(interpreter.getStatistics().calls == uut.getStatistics().calls);
+	}
+}
+
+TEST(ClosureTier, Objects)
+{
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 1, 1)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 3,
+				.nScalars = 3,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),        // s1 -> i
+					/*  1 */ prog::Instruction::make({}, 0),       // r0 -> head
+					/*  2 */ prog::Instruction::movr({}, 0),       // r1 -> tail
+
+					/*  3 */ prog::Instruction::jNe(0, 1, 6),      // if(i == n) return head;
+					/*  4 */ prog::Instruction::drop(1, 0),
+					/*  5 */ prog::Instruction::ret(1, 0),
+
+					/*  6 */ prog::Instruction::make({}, 1),       // r2 -> next
+					/*  7 */ prog::Instruction::puts(1, 2, 0),     // next->s0 = i;
+					/*  8 */ prog::Instruction::jNul(1, 11),       // if(tail != vm::null) {
+					/*  9 */ prog::Instruction::putr(2, 1, 0),     //   tail->r0 = next;
+					/* 10 */ prog::Instruction::jump(12),          // } else {
+					/* 11 */ prog::Instruction::movr(0, 2),        //   head = next; }
+					/* 12 */ prog::Instruction::movr(1, {}),       // tail = next;
+
+					/* 13 */ prog::Instruction::lit({}, 1),        // i++
+					/* 14 */ prog::Instruction::addI(1, 1, {}),
+					/* 15 */ prog::Instruction::jump(3),
+				}
+			}
+		}
+	};
+
+	vm::Vm uut(storage, p);
+	uut.enableClosureTier(1, 1);
+
+	auto h = uut.run({}, {20}).first.front();
+	CHECK(1 == uut.getStatistics().tierUps);
+
+	for(int i = 0; i < 20; i++)
+	{
+		CHECK(h != vm::null);
+		CHECK(i == storage.reads(h, 0).integer);
+		h = storage.readr(h, 0);
+	}
+
+	CHECK(h == vm::null);
+}
+
+TEST(ClosureTier, Coroutine)
+{
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 4,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),     // s = 0;
+					/* 1 */ prog::Instruction::lit({}, 0),     // while(n != 0) {
+					/* 2 */ prog::Instruction::jNe(0, {}, 5),
+					/* 3 */ prog::Instruction::mov({}, 1),
+					/* 4 */ prog::Instruction::ret(0, 1),
+
+					/* 5 */ prog::Instruction::addI(1, 1, 0),  //   s += n;
+					/* 6 */ prog::Instruction::yield(),        //   yield;
+
+					/* 7 */ prog::Instruction::lit({}, 1),     //   n--;
+					/* 8 */ prog::Instruction::subI(0, 0, {}),
+					/* 9 */ prog::Instruction::jump(1),        // } return s;
+				}
+			}
+		}
+	};
+
+	vm::Vm machine(storage, p);
+	machine.enableClosureTier(1, 2);
+	vm::Scheduler uut(machine);
+
+	auto a = uut.spawn(0, {}, {10});
+	auto b = uut.spawn(0, {}, {20});
+
+	CHECK(11 + 21 == uut.run());
+	CHECK(1 == machine.getStatistics().tierUps);
+
+	CHECK(55 == machine.getResults(a).second.front().integer);
+	CHECK(210 == machine.getResults(b).second.front().integer);
+}
+
+TEST(ClosureTier, DynamicCall)
+{
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 8,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),        // s = 0;
+					/*  1 */ prog::Instruction::lit({}, 0),        // for(i = 0; i < n; i++)
+					/*  2 */ prog::Instruction::jLtI(2, 0, 5),
+					/*  3 */ prog::Instruction::mov({}, 1),
+					/*  4 */ prog::Instruction::ret(0, 1),
+
+					/*  5 */ prog::Instruction::mov({}, 2),        //   s += (i & 1 ? twice : increment)(i);
+					/*  6 */ prog::Instruction::lit({}, 1),
+					/*  7 */ prog::Instruction::andI({}, 2, {}),
+					/*  8 */ prog::Instruction::lit({}, 1),
+					/*  9 */ prog::Instruction::addI({}, {}, {}),
+					/* 10 */ prog::Instruction::call(0, 1),
+					/* 11 */ prog::Instruction::addI(1, 1, {}),
+
+					/* 12 */ prog::Instruction::lit({}, 1),
+					/* 13 */ prog::Instruction::addI(2, 2, {}),
+					/* 14 */ prog::Instruction::jump(2),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 1),
+					/* 1 */ prog::Instruction::addI({}, 0, {}),
+					/* 2 */ prog::Instruction::ret(0, 1),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 2),
+					/* 1 */ prog::Instruction::mulI({}, 0, {}),
+					/* 2 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm uut(storage, p);
+	uut.enableClosureTier(1, 1);
+	CHECK(75 == uut.run({}, {10}).second.front().integer);
+	CHECK(3 == uut.getStatistics().tierUps);
+
+	vm::Vm interpreter(storage, p);
+	CHECK(75 == interpreter.run({}, {10}).second.front().integer);
+	CHECK(interpreter.getStatistics().calls == uut.getStatistics().calls);
+}
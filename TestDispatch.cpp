@@ -0,0 +1,156 @@
+#include "1test/Test.h"
+
+#include "vm/Vm.h"
+
+#include "compiler/builder/ClassBuilder.h"
+#include "compiler/builder/FunctionBuilder.h"
+
+TEST_GROUP(Dispatch)
+{
+	vm::Storage storage;
+
+	static inline prog::Function getter(prog::Instruction::Operation op, uint32_t k)
+	{
+		return prog::Function
+		{
+			.nRefs = 1,
+			.nScalars = 3,
+			.code = {
+				/* 0 */ prog::Instruction::gets({}, 0, 0),
+				/* 1 */ prog::Instruction::lit({}, k),
+				/* 2 */ prog::Instruction(op, {}, {}, {}),
+				/* 3 */ prog::Instruction::ret(0, 1),
+			}
+		};
+	}
+};
+
+TEST(Dispatch, VirtualCall)
+{
+	const prog::Program p = {
+		.types = {
+			prog::TypeInfo::empty,
+			prog::TypeInfo(0, 0, 1),                        // base
+			prog::TypeInfo(1, 0, 1),                        // derived, overrides the method
+			prog::TypeInfo(2, 0, 1),                        // inherits the override
+		},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 4,
+				.code = {
+					/*  0 */ prog::Instruction::make({}, 0),     // r0 -> object of the type given
+					/*  1 */ prog::Instruction::lit({}, 10),     // s1 -> 10
+					/*  2 */ prog::Instruction::jEqL(0, 1, 5),
+					/*  3 */ prog::Instruction::jEqL(0, 2, 7),
+					/*  4 */ prog::Instruction::jump(9),
+					/*  5 */ prog::Instruction::make(0, 1),
+					/*  6 */ prog::Instruction::jump(10),
+					/*  7 */ prog::Instruction::make(0, 2),
+					/*  8 */ prog::Instruction::jump(10),
+					/*  9 */ prog::Instruction::make(0, 3),
+					/* 10 */ prog::Instruction::puts(1, 0, 0),
+					/* 11 */ prog::Instruction::movr({}, 0),
+					/* 12 */ prog::Instruction::vcall(0, 1, 0),
+					/* 13 */ prog::Instruction::ret(0, 1),
+				}
+			},
+			getter(prog::Instruction::Operation::addI, 1),
+			getter(prog::Instruction::Operation::mulI, 2),
+		},
+		.methods = {{}, {1}, {2}, {2}}
+	};
+
+	vm::Vm uut(storage, p);
+	CHECK(11 == uut.run({}, {1}).second.front().integer);
+	CHECK(20 == uut.run({}, {2}).second.front().integer);
+	CHECK(20 == uut.run({}, {3}).second.front().integer);
+	CHECK(3 == uut.getStatistics().calls);
+}
+
+TEST(Dispatch, InstanceOf)
+{
+	const std::vector<prog::TypeInfo> types = {
+		prog::TypeInfo::empty,
+		prog::TypeInfo(0, 0, 0),                        // a
+		prog::TypeInfo(4, 0, 0),                        // c extends d
+		prog::TypeInfo(1, 0, 0),                        // b extends a
+		prog::TypeInfo(3, 0, 0),                        // d extends b
+		prog::TypeInfo(0, 0, 0),                        // e
+	};
+
+	const std::vector<std::vector<bool>> expected = {
+		{false, false, false, false, false, false},     // null
+		{false, true,  false, false, false, false},
+		{false, true,  true,  true,  true,  false},
+		{false, true,  false, true,  false, false},
+		{false, true,  false, true,  true,  false},
+		{false, false, false, false, false, true },
+	};
+
+	for(auto actual = 0u; actual < types.size(); actual++)
+	{
+		for(auto tested = 0u; tested < types.size(); tested++)
+		{
+			const prog::Program p = {
+				.types = types,
+				.functions =
+				{
+					prog::Function
+					{
+						.nRefs = 1,
+						.nScalars = 2,
+						.code = {
+							/* 0 */ prog::Instruction::make({}, actual),
+							/* 1 */ prog::Instruction::iof({}, {}, tested),
+							/* 2 */ prog::Instruction::ret(0, 1),
+						}
+					}
+				}
+			};
+
+			vm::Vm uut(storage, p);
+			CHECK(expected[actual][tested] == (bool)uut.run({}, {}).second.front().integer);
+		}
+	}
+}
+
+TEST(Dispatch, MethodTables)
+{
+	auto base = comp::ClassBuilder::make();
+	auto fData = base.addField(comp::ast::ValueType::integer());
+	auto derived = comp::ClassBuilder::make(base);
+
+	const auto method = [&](int k)
+	{
+		auto ret = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::reference(base.data)});
+		ret <<= comp::ret(ret[0][fData] + k);
+		return ret;
+	};
+
+	CHECK(0 == base.addMethod(method(1)));
+	CHECK(1 == base.addMethod(method(2)));
+	derived.overrideMethod(1, method(3));
+	CHECK(2 == derived.addMethod(method(4)));
+
+	auto f = comp::FunctionBuilder::make({}, {});
+	f <<= comp::declaration(derived());
+	f <<= comp::ret();
+
+	const auto tables = f.build().generateMethodTables();
+
+	CHECK(3 == tables.size());
+	CHECK(tables[0].empty());                           // statics
+
+	const auto &d = tables[1], &b = tables[2];
+	CHECK(3 == d.size() && 2 == b.size());
+	CHECK(d[0] == b[0]);
+	CHECK(d[1] != b[1]);
+
+	for(const auto i: {b[0], b[1], d[1], d[2]})
+	{
+		CHECK(0 < i && i < 5);
+	}
+}
@@ -0,0 +1,277 @@
+#include "1test/Test.h"
+
+#include "vm/Vm.h"
+#include "vm/Scheduler.h"
+
+#include "compiler/internal/Compiler.h"
+#include "compiler/builder/FunctionBuilder.h"
+#include "compiler/builder/ClassBuilder.h"
+#include "compiler/builder/Helpers.h"
+
+TEST_GROUP(Exceptions)
+{
+	vm::Storage storage;
+
+	const prog::Program unwind = {
+		.types = {
+			prog::TypeInfo::empty,
+			prog::TypeInfo(0, 0, 0),                        // exception
+		},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::addI({}, 0, {}),
+					/* 2 */ prog::Instruction::callL(1, 0, 1),  // raises after the given number of nested calls
+					/* 3 */ prog::Instruction::ret(0, 1),
+					/* 4 */ prog::Instruction::iof({}, {}, 1),  // handler, the exception is on the reference stack
+					/* 5 */ prog::Instruction::addI({}, {}, 0),
+					/* 6 */ prog::Instruction::ret(0, 1),
+				},
+				.handlers = {{2, 3, 4, 0, 1}}
+			},
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jNe(0, {}, 4),
+					/* 2 */ prog::Instruction::make({}, 1),
+					/* 3 */ prog::Instruction::raise(),
+					/* 4 */ prog::Instruction::lit({}, 1),
+					/* 5 */ prog::Instruction::subI({}, 0, {}),
+					/* 6 */ prog::Instruction::callL(1, 0, 1),
+					/* 7 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+};
+
+TEST(Exceptions, SameFrame)
+{
+	const prog::Program p = {
+		.types = {
+			prog::TypeInfo::empty,
+			prog::TypeInfo(0, 0, 0),                        // exception
+		},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 3,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),
+					/*  1 */ prog::Instruction::lit({}, 0),
+					/*  2 */ prog::Instruction::jEq(0, {}, 9),   // the loop counter is the argument
+					/*  3 */ prog::Instruction::lit({}, 7),      // left on the stack, dropped by the handler
+					/*  4 */ prog::Instruction::make({}, 1),
+					/*  5 */ prog::Instruction::raise(),
+					/*  6 */ prog::Instruction::lit({}, 1),      // handler
+					/*  7 */ prog::Instruction::addI(1, 1, {}),
+					/*  8 */ prog::Instruction::jump(10),
+					/*  9 */ prog::Instruction::ret(0, 1),
+					/* 10 */ prog::Instruction::lit({}, 1),
+					/* 11 */ prog::Instruction::subI(0, 0, {}),
+					/* 12 */ prog::Instruction::drop(1, 0),     // the exception
+					/* 13 */ prog::Instruction::jump(1),
+				},
+				.handlers = {{3, 6, 6, 0, 2}}
+			}
+		}
+	};
+
+	vm::Vm uut(storage, p);
+	CHECK(1000 == uut.run({}, {1000}).second.front().integer);
+	CHECK(vm::null == uut.getUncaught());
+}
+
+TEST(Exceptions, Unwind)
+{
+	vm::Vm uut(storage, unwind);
+
+	for(int i = 0; i < 10; i++)
+	{
+		CHECK(i + 1 == uut.run({}, {i}).second.front().integer);
+	}
+
+	CHECK(vm::null == uut.getUncaught());
+}
+
+TEST(Exceptions, Uncaught)
+{
+	const prog::Program p = {
+		.types = {
+			prog::TypeInfo::empty,
+			prog::TypeInfo(0, 0, 0),                        // exception
+		},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 2,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jNe(0, {}, 4),
+					/* 2 */ prog::Instruction::make({}, 1),
+					/* 3 */ prog::Instruction::raise(),
+					/* 4 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm uut(storage, p);
+
+	const auto r = uut.run({}, {0});
+	CHECK(r.first.empty() && r.second.empty());
+	CHECK(1 == storage.getTypeIndex(uut.getUncaught()));
+
+	uut.gc({});
+	CHECK(1 == storage.getTypeIndex(uut.getUncaught()));
+
+	CHECK(2 == uut.run({}, {2}).second.front().integer);
+	CHECK(vm::null == uut.getUncaught());
+}
+
+TEST(Exceptions, Coroutine)
+{
+	const prog::Program p = {
+		.types = {
+			prog::TypeInfo::empty,
+			prog::TypeInfo(0, 0, 0),                        // exception
+		},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 2,
+				.code = {
+					/* 0 */ prog::Instruction::yield(),
+					/* 1 */ prog::Instruction::make({}, 1),
+					/* 2 */ prog::Instruction::raise(),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::movr({}, 0),     // try { return await(co); }
+					/* 1 */ prog::Instruction::await(0, 1),
+					/* 2 */ prog::Instruction::ret(0, 1),
+					/* 3 */ prog::Instruction::lit({}, 7),      // catch { return 7; }
+					/* 4 */ prog::Instruction::ret(0, 1),
+				},
+				.handlers = {{1, 2, 3, 1, 0}}
+			},
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::movr({}, 0),     // return await(co);
+					/* 1 */ prog::Instruction::await(0, 1),
+					/* 2 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	const auto thrower = uut.spawn(0, {}, {});
+	const auto caught = uut.spawn(1, {thrower}, {});
+	const auto passed = uut.spawn(2, {thrower}, {});
+	uut.run();
+
+	CHECK(0 == uut.getSuspendedCount());
+	CHECK(1 == storage.getTypeIndex(machine.getException(thrower)));
+	CHECK(machine.getResults(thrower).second.empty());
+
+	CHECK(vm::null == machine.getException(caught));
+	CHECK(7 == machine.getResults(caught).second.front().integer);
+
+	CHECK(machine.getException(thrower) == machine.getException(passed));
+	CHECK(machine.getResults(passed).second.empty());
+
+	uut.gc({thrower});
+	CHECK(1 == storage.getTypeIndex(machine.getException(thrower)));
+}
+
+TEST(Exceptions, Tiers)
+{
+	for(const auto &p: {unwind, comp::Compiler::fuseInstructions(unwind)})
+	{
+		vm::Vm uut(storage, p);
+		uut.enableClosureTier(2, 2);
+
+		for(int i = 0; i < 10; i++)
+		{
+			CHECK(i + 1 == uut.run({}, {i}).second.front().integer);
+		}
+
+		CHECK(0 < uut.getStatistics().tierUps);
+	}
+}
+
+TEST(Exceptions, Builder)
+{
+	auto e = comp::ClassBuilder::make();
+
+	auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	auto r = uut <<= comp::declaration(comp::ast::ValueType::integer(), 0);
+	uut <<= comp::attempt();
+	uut <<= 	comp::conditional(uut[0] < 0);
+	uut <<= 		comp::raise(e());
+	uut <<= 	comp::endBlock();
+	uut <<= 	r = uut[0] * 2;
+	uut <<= comp::handler(comp::ast::ValueType::reference(e.data));
+	uut <<= 	r = -1;
+	uut <<= comp::endBlock();
+	uut <<= comp::ret(r);
+
+	auto c = uut.build();
+
+	CHECK(std::string("\n") + c.dumpAst() == R"(
+struct c0
+{
+};
+
+struct c1
+{
+};
+
+int f0(int a0)
+{
+    int l0 = 0;
+    try
+    {
+        if(a0 < 0)
+        {
+            throw new c1;
+        }
+        l0 = a0 * 2;
+    }
+    catch(c1* l1)
+    {
+        l0 = -1;
+    }
+    return l0;
+}
+)");
+
+	const auto cfg = c.dumpCfg();
+	CHECK(cfg.find("catch") != std::string::npos);
+	CHECK(cfg.find("throw") != std::string::npos);
+	CHECK(cfg.find("style=dashed") != std::string::npos);
+}
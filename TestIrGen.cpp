@@ -4,7 +4,9 @@
 #include "compiler/builder/ClassBuilder.h"
 #include "compiler/builder/Helpers.h"
 
+#include <sstream>
 #include <iostream>
+#include <filesystem>
 
 TEST_GROUP(Tacify) {};
 
@@ -68,3 +70,457 @@ TEST(Tacify, Loop)
 	std::cout << uut.build().dumpCfg() << std::endl;
 }
 #endif
+
+TEST(Tacify, ScalarReplacement)
+{
+	auto c = comp::ClassBuilder::make();
+	auto fX = c.addField(comp::ast::ValueType::integer());
+	auto fY = c.addField(comp::ast::ValueType::integer());
+	auto fNext = c.addField(c);
+
+	auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	auto p = uut <<= comp::declaration(c());
+	uut <<= p[fX] = uut[0];
+	uut <<= p[fY] = uut[0] + 1;
+	uut <<= p[fNext] = comp::null;
+	uut <<= comp::ret(p[fX] * p[fY]);
+
+	auto compiler = uut.build();
+	const auto cfg = compiler.dumpCfg();
+	std::cout << cfg << std::endl;
+
+	CHECK(1 == compiler.getStatistics().eliminatedAllocations);
+	CHECK(cfg.find("new") == std::string::npos);
+}
+
+TEST(Tacify, EscapingObjects)
+{
+	auto c = comp::ClassBuilder::make();
+	auto fX = c.addField(comp::ast::ValueType::integer());
+	auto sfLast = c.addStaticField(c);
+
+	auto use = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::reference(c.data)});
+	use <<= comp::ret(use[0][fX]);
+
+	auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	auto stored = uut <<= comp::declaration(c());
+	auto passed = uut <<= comp::declaration(c());
+	auto local = uut <<= comp::declaration(c());
+	uut <<= stored[fX] = uut[0];
+	uut <<= c[sfLast] = stored;
+	uut <<= local[fX] = use(passed);
+	uut <<= comp::ret(local[fX]);
+
+	auto compiler = uut.build();
+	const auto cfg = compiler.dumpCfg();
+
+	CHECK(1 == compiler.getStatistics().eliminatedAllocations);
+
+	size_t nCreates = 0;
+	for(auto i = cfg.find("new "); i != std::string::npos; i = cfg.find("new ", i + 1))
+	{
+		nCreates++;
+	}
+
+	CHECK(2 == nCreates);
+}
+
+TEST(Tacify, Parallel)
+{
+	auto c = comp::ClassBuilder::make();
+	auto fX = c.addField(comp::ast::ValueType::integer());
+
+	auto callee = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	callee <<= comp::ret(callee[0]);
+
+	for(int i = 0; i < 20; i++)
+	{
+		auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto p = f <<= comp::declaration(c());
+		f <<= p[fX] = callee(f[0] + i);
+		f <<= comp::ret(p[fX]);
+		callee = f;
+	}
+
+	auto sequential = callee.build(), parallel = callee.build();
+	sequential.setThreadCount(1);
+	parallel.setThreadCount(4);
+
+	CHECK(sequential.dumpCfg() == parallel.dumpCfg());
+	CHECK(20 == sequential.getStatistics().eliminatedAllocations);
+	CHECK(20 == parallel.getStatistics().eliminatedAllocations);
+}
+
+TEST(Tacify, Cache)
+{
+	const auto dir = std::filesystem::temp_directory_path() / "TestIrGenCache";
+	std::filesystem::remove_all(dir);
+
+	const auto program = [](int edited)
+	{
+		auto c = comp::ClassBuilder::make();
+		auto fX = c.addField(comp::ast::ValueType::integer());
+
+		auto main = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto sum = main <<= comp::declaration(main[0]);
+
+		for(int i = 0; i < 5; i++)
+		{
+			auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+			auto p = f <<= comp::declaration(c());
+			f <<= p[fX] = f[0] * (i == 3 ? edited : i);
+			f <<= comp::ret(p[fX] + 1);
+			main <<= sum = sum + f(sum);
+		}
+
+		main <<= comp::ret(sum);
+		return main.build();
+	};
+
+	auto cold = program(3);
+	auto cache = std::make_shared<comp::CompilationCache>(dir.string());
+	cold.setCache(cache);
+	const auto expected = cold.dumpCfg();
+	CHECK(0 == cache->getHitCount());
+	CHECK(6 == cache->getMissCount());
+
+	auto warm = program(3);
+	cache = std::make_shared<comp::CompilationCache>(dir.string());
+	warm.setCache(cache);
+	CHECK(expected == warm.dumpCfg());
+	CHECK(cold.getStatistics().eliminatedAllocations == warm.getStatistics().eliminatedAllocations);
+	CHECK(!warm.getStatistics().simplifications.empty());
+	CHECK(cold.getStatistics().simplifications == warm.getStatistics().simplifications);
+	CHECK(6 == cache->getHitCount());
+	CHECK(0 == cache->getMissCount());
+
+	auto edited = program(7);
+	cache = std::make_shared<comp::CompilationCache>(dir.string());
+	edited.setCache(cache);
+	const auto result = edited.dumpCfg();
+	CHECK(5 == cache->getHitCount());
+	CHECK(1 == cache->getMissCount());
+
+	CHECK(result == program(7).dumpCfg());
+	CHECK(result != expected);
+
+	std::filesystem::remove_all(dir);
+}
+
+TEST(Tacify, CopyPropagation)
+{
+	static constexpr auto base = comp::Options::doJumpOptimizations | comp::Options::propagateConstants | comp::Options::eliminateDeadCode | comp::Options::replaceScalars;
+
+	std::vector<comp::FunctionBuilder> corpus;
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		uut <<= comp::ret(uut[0] * (uut[0] + 1) / 2);
+		corpus.push_back(uut);
+	}
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		uut <<= comp::ret(comp::ternary(uut[0] >= 2, uut(uut[0] - 1) * uut[0], 1));
+		corpus.push_back(uut);
+	}
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto r = uut <<= comp::declaration(1);
+		uut <<= comp::loop();
+		uut <<= 	comp::conditional(!(uut[0] > 2));
+		uut <<= 		comp::exitLoop();
+		uut <<= 	comp::endBlock();
+		uut <<= 	r = r * uut[0];
+		uut <<= 	uut[0] = uut[0] - 1;
+		uut <<= comp::endBlock();
+		uut <<= comp::ret(r);
+		corpus.push_back(uut);
+	}
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer(), comp::ast::ValueType::integer()});
+		auto a = uut <<= comp::declaration(uut[0]);
+		auto b = uut <<= comp::declaration(uut[1]);
+		auto n = uut <<= comp::declaration(a);
+		uut <<= comp::loop();
+		uut <<= 	comp::conditional(!(n > 0));
+		uut <<= 		comp::exitLoop();
+		uut <<= 	comp::endBlock();
+		auto t = uut <<= comp::declaration(a);
+		uut <<= 	a = b;
+		uut <<= 	b = t;
+		uut <<= 	n = n - 1;
+		uut <<= comp::endBlock();
+		uut <<= comp::ret(comp::ternary(a > b, a, b));
+		corpus.push_back(uut);
+	}
+
+	const auto countOperations = [](const std::string& cfg)
+	{
+		size_t ret = 0;
+		for(auto i = cfg.find("\\n"); i != std::string::npos; i = cfg.find("\\n", i + 1))
+		{
+			ret++;
+		}
+		return ret;
+	};
+
+	size_t before = 0, after = 0, nExecuted = 0;
+
+	for(auto& f: corpus)
+	{
+		const auto plain = countOperations(f.build().dumpCfg(base));
+		const auto cfg = f.build().dumpCfg(base | comp::Options::propagateCopies);
+		const auto propagated = countOperations(cfg);
+
+		std::cout << cfg << std::endl;
+		CHECK(propagated <= plain);
+
+		before += plain;
+		after += propagated;
+
+		// The same results with and without the propagation, where it can be run (not with the calls
+		// or the wrong number of arguments).
+		const auto compiler = f.build();
+
+		for(int x: {0, 1, 2, 5, -3})
+		{
+			for(const auto& args: {std::vector<int>{x}, std::vector<int>{x, 3 * x + 1}})
+			{
+				const auto without = compiler.execute(0, args, base), with = compiler.execute(0, args, base | comp::Options::propagateCopies);
+
+				CHECK(without.has_value() == with.has_value());
+
+				if(without && with)
+				{
+					CHECK(without->ret == with->ret);
+					nExecuted++;
+				}
+			}
+		}
+	}
+
+	std::cout << "operations: " << before << " -> " << after << std::endl;
+	CHECK(after < before);
+	CHECK(nExecuted == 3 * 5 + 3); // The recursive one only where it does not call itself
+}
+
+TEST(Tacify, BranchFusion)
+{
+	std::vector<comp::FunctionBuilder> corpus;
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer(), comp::ast::ValueType::integer()});
+		uut <<= comp::conditional(uut[0] < uut[1]);
+		uut <<= 	comp::ret(uut[0]);
+		uut <<= comp::endBlock();
+		uut <<= comp::ret(uut[1]);
+		corpus.push_back(uut);
+	}
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer(), comp::ast::ValueType::integer()});
+		uut <<= comp::ret(comp::ternary(!(uut[0] > uut[1]), uut[0], uut[1]));
+		corpus.push_back(uut);
+	}
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer(), comp::ast::ValueType::integer()});
+		uut <<= comp::conditional(uut[0] > 0 && (uut[1] > 0 || !(uut[0] < uut[1])));
+		uut <<= 	comp::ret(uut[0]);
+		uut <<= comp::endBlock();
+		uut <<= comp::ret(uut[1]);
+		corpus.push_back(uut);
+	}
+
+	{
+		auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer(), comp::ast::ValueType::integer()});
+		auto n = uut <<= comp::declaration(0);
+		uut <<= comp::loop();
+		uut <<= 	comp::conditional(!(uut[0] < uut[1]) || n > 100);
+		uut <<= 		comp::exitLoop();
+		uut <<= 	comp::endBlock();
+		uut <<= 	uut[0] = uut[0] * 2;
+		uut <<= 	n = n + 1;
+		uut <<= comp::endBlock();
+		uut <<= comp::ret(n);
+		corpus.push_back(uut);
+	}
+
+	struct Counts
+	{
+		size_t blocks = 0, branches = 0, tests = 0;
+	};
+
+	const auto count = [](const std::string& cfg, Counts& c)
+	{
+		std::stringstream ss(cfg);
+
+		for(std::string line; std::getline(ss, line);)
+		{
+			c.blocks += line.find("[shape=rect") != std::string::npos;
+
+			// Both edges of a conditional branch are labeled with the condition.
+			if(line.find(" -> ") != std::string::npos && line.find(" -> exit") == std::string::npos && line.find("[label=") != std::string::npos)
+			{
+				c.branches++;
+				c.tests += line.find("== true") != std::string::npos;
+			}
+		}
+	};
+
+	Counts generated, optimized;
+
+	for(auto& f: corpus)
+	{
+		count(f.build().dumpCfg(comp::Options()), generated);
+		count(f.build().dumpCfg(), optimized);
+	}
+
+	std::cout << "generated: " << generated.blocks << " blocks, " << generated.branches / 2 << " conditional branches, " << generated.tests << " tests of materialized booleans" << std::endl;
+	std::cout << "optimized: " << optimized.blocks << " blocks, " << optimized.branches / 2 << " conditional branches" << std::endl;
+
+	CHECK(0 == generated.tests);
+	CHECK(optimized.blocks <= generated.blocks);
+}
+
+TEST(Tacify, Simplification)
+{
+	auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()},
+			{comp::ast::ValueType::integer(), comp::ast::ValueType::array(comp::ast::ValueType::integer()), comp::ast::ValueType::floating()});
+
+	auto x = uut[0];
+	auto n = uut <<= comp::declaration(uut[1].length());
+	auto a = uut <<= comp::declaration((x + 0) * 1 - x * 0);
+	auto b = uut <<= comp::declaration((x - x) + (x ^ x));
+	auto c = uut <<= comp::declaration(x * 8 + n / 4 + n % 8 + x / 4);
+	auto d = uut <<= comp::declaration((uut[2] * 1.0f).asInt() + comp::RValWrapper(2.5f).asInt() + comp::RValWrapper(-7).asFloat().asInt());
+	uut <<= comp::ret(a * b + c + d);
+
+	auto compiler = uut.build();
+	const auto cfg = compiler.dumpCfg();
+	std::cout << cfg << std::endl;
+
+	for(const auto& p: compiler.getStatistics().simplifications)
+	{
+		std::cout << p.first << ": " << p.second << std::endl;
+	}
+
+	const auto &s = compiler.getStatistics().simplifications;
+	const auto count = [&](const char* rule){ const auto it = s.find(rule); return it != s.end() ? it->second : 0; };
+
+	CHECK(1 == count("mulPow2"));
+	CHECK(1 == count("divPow2"));
+	CHECK(1 == count("modPow2"));
+	CHECK(1 == count("mulOneF"));
+	CHECK(1 == count("subSelf"));
+	CHECK(1 == count("xorSelf"));
+
+	CHECK(cfg.find(" / 4") != std::string::npos); // The sign of x is not known
+	CHECK(cfg.find(" * ") == std::string::npos);
+	CHECK(cfg.find(" % ") == std::string::npos);
+	CHECK(cfg.find("(float)") == std::string::npos);
+	CHECK(cfg.find("(int)") != std::string::npos);
+	CHECK(cfg.find(" + 2\\n") != std::string::npos); // (int)2.5f
+	CHECK(cfg.find(" + -7\\n") != std::string::npos); // (int)(float)-7
+}
+
+TEST(Tacify, NarrowStatics)
+{
+	auto c = comp::ClassBuilder::make();
+	auto sTag = c.addStaticField(comp::ast::ValueType::uint8());
+	auto sByte = c.addStaticField(comp::ast::ValueType::int8());
+	auto sWord = c.addStaticField(comp::ast::ValueType::uint16());
+	auto sShort = c.addStaticField(comp::ast::ValueType::int16());
+
+	// The statics are not packed, but read back as if they were.
+	auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	uut <<= c[sTag] = uut[0];
+	uut <<= c[sByte] = uut[0];
+	uut <<= c[sWord] = uut[0];
+	uut <<= c[sShort] = uut[0];
+	uut <<= comp::ret(((c[sTag] * 3 + c[sByte]) * 5 + c[sWord]) * 7 + c[sShort]);
+
+	auto compiler = uut.build();
+	std::cout << compiler.dumpCfg() << std::endl;
+
+	for(int x: {0, 44, 300, -1, 40000, 100000})
+	{
+		const auto r = compiler.execute(0, {x});
+		const auto expected = (((uint8_t)x * 3 + (int8_t)x) * 5 + (uint16_t)x) * 7 + (int16_t)x;
+
+		CHECK(r.has_value() && r->ret == std::vector<int>{expected});
+	}
+}
+
+TEST(Tacify, LoopUnrolling)
+{
+	static constexpr auto rolled = comp::Options::doJumpOptimizations | comp::Options::propagateConstants | comp::Options::eliminateDeadCode |
+			comp::Options::replaceScalars | comp::Options::propagateCopies | comp::Options::simplifyOperations;
+
+	// Counted up to a constant, down with the test at the end, and up to an argument.
+	auto uut = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	auto s = uut <<= comp::declaration(0);
+	auto i = uut <<= comp::declaration(0);
+	uut <<= comp::loop();
+	uut <<= 	comp::conditional(!(i < 10));
+	uut <<= 		comp::exitLoop();
+	uut <<= 	comp::endBlock();
+	uut <<= 	s = s + i * uut[0];
+	uut <<= 	i = i + 1;
+	uut <<= comp::endBlock();
+
+	auto j = uut <<= comp::declaration(600);
+	uut <<= comp::loop();
+	uut <<= 	s = s + (j ^ uut[0]);
+	uut <<= 	j = j - 3;
+	uut <<= 	comp::conditional(j == 0);
+	uut <<= 		comp::exitLoop();
+	uut <<= 	comp::endBlock();
+	uut <<= comp::endBlock();
+
+	auto k = uut <<= comp::declaration(0);
+	uut <<= comp::loop();
+	uut <<= 	comp::conditional(!(k < uut[0]));
+	uut <<= 		comp::exitLoop();
+	uut <<= 	comp::endBlock();
+	uut <<= 	s = s - k;
+	uut <<= 	k = k + 1;
+	uut <<= comp::endBlock();
+	uut <<= comp::ret(s);
+
+	auto compiler = uut.build();
+	const auto cfg = compiler.dumpCfg();
+	std::cout << cfg << std::endl;
+
+	CHECK(1 == compiler.getStatistics().unrolledLoops);
+	CHECK(1 == compiler.getStatistics().partiallyUnrolledLoops);
+
+	for(int x: {0, 1, 7, -13})
+	{
+		const auto before = compiler.execute(0, {x}, rolled), after = compiler.execute(0, {x});
+
+		CHECK(before.has_value() && after.has_value());
+		CHECK(before->ret == after->ret);
+		CHECK(after->nBranches + after->nJumps < before->nBranches + before->nJumps);
+		CHECK(after->nOperations <= before->nOperations);
+
+		int expected = 0;
+		for(int n = 0; n < 10; n++) expected += n * x;
+		for(int n = 600; n != 0; n -= 3) expected += n ^ x;
+		for(int n = 0; n < x; n++) expected -= n;
+		CHECK(after->ret == std::vector<int>{expected});
+
+		std::cout << "x = " << x << ": " << before->nOperations << " -> " << after->nOperations << " operations, "
+				<< before->nBranches << " -> " << after->nBranches << " branches, "
+				<< before->nJumps << " -> " << after->nJumps << " jumps" << std::endl;
+	}
+
+	// Nothing fits a budget of zero.
+	auto c = uut.build();
+	c.setUnrollBudget(0);
+	c.dumpCfg();
+	CHECK(0 == c.getStatistics().unrolledLoops + c.getStatistics().partiallyUnrolledLoops);
+}
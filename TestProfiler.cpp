@@ -0,0 +1,199 @@
+#include "1test/Test.h"
+
+#include "vm/Profiler.h"
+#include "vm/AllocationProfiler.h"
+#include "vm/Vm.h"
+
+#include <sstream>
+
+TEST_GROUP(Profiler) {};
+
+TEST(Profiler, Sanity)
+{
+	using Op = prog::Instruction::Operation;
+	vm::Profiler uut;
+
+	uut.enter({0});
+	uut.step(0, 0, Op::lit);
+	uut.step(0, 1, Op::call);
+	uut.call(1);
+	uut.step(1, 0, Op::lit);
+	uut.step(1, 1, Op::ret);
+	uut.ret();
+	uut.step(0, 2, Op::ret);
+	uut.leave();
+
+	CHECK(2 == uut.getOperation(Op::lit).count);
+	CHECK(1 == uut.getOperation(Op::call).count);
+	CHECK(2 == uut.getOperation(Op::ret).count);
+	CHECK(0 == uut.getOperation(Op::jump).count);
+
+	CHECK(2 == uut.getFunctions().size());
+	CHECK(0 == uut.getFunctions()[0].count);
+	CHECK(1 == uut.getFunctions()[1].count);
+
+	CHECK(1 == uut.getEdges().size());
+	CHECK(1 == uut.getEdges().at({0, 1}));
+
+	CHECK(2 == uut.getSequences().size());
+	CHECK(1 == uut.getSequences().at({Op::lit, Op::call}));
+	CHECK(1 == uut.getSequences().at({Op::lit, Op::ret}));
+
+	std::stringstream flat;
+	uut.writeFlat(flat);
+	CHECK(flat.str().find("op\tlit\t2\t") != std::string::npos);
+	CHECK(flat.str().find("pc\tfn1+1\t1\t") != std::string::npos);
+	CHECK(flat.str().find("call\tfn0->fn1\t1\t") != std::string::npos);
+
+	std::stringstream folded;
+	uut.writeFolded(folded);
+	CHECK(folded.str().find("fn0 ") != std::string::npos);
+	CHECK(folded.str().find("fn0;fn1 ") != std::string::npos);
+}
+
+// Only built with the hooks, see the Makefile.
+#ifdef VM_PROFILE
+TEST(Profiler, Vm)
+{
+	vm::Storage storage;
+	vm::Profiler uut;
+
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jEq(0, {}, 8),
+
+					/* 2 */ prog::Instruction::lit({}, 1),
+					/* 3 */ prog::Instruction::subI({}, 0, {}),
+
+					/* 4 */ prog::Instruction::lit({}, 0),
+					/* 5 */ prog::Instruction::call(0, 1),
+
+					/* 6 */ prog::Instruction::mulI({}, 0, {}),
+					/* 7 */ prog::Instruction::ret(0, 1),
+
+					/* 8 */ prog::Instruction::lit({}, 1),
+					/* 9 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm machine(storage, p);
+	machine.setProfiler(&uut);
+	CHECK(120 == machine.run({}, {5}).second.front().integer);
+
+	CHECK(5 == uut.getEdges().at({0, 0}));
+	CHECK(5 == uut.getOperation(prog::Instruction::Operation::call).count);
+	CHECK(6 == uut.getOperation(prog::Instruction::Operation::ret).count);
+
+	std::stringstream folded;
+	uut.writeFolded(folded);
+	CHECK(folded.str().find("fn0;fn0;fn0;fn0;fn0;fn0 ") != std::string::npos);
+}
+#endif
+
+TEST(Profiler, Allocations)
+{
+	vm::Storage storage;
+	vm::AllocationProfiler uut;
+	storage.setAllocationProfiler(&uut);
+
+	const prog::TypeInfo t(0, 1, 2);
+	std::vector<vm::Reference> kept;
+
+	for(int i = 0; i < 10; i++)
+	{
+		uut.at(0, 3);
+		const auto r = storage.create(t, 1);
+
+		if(i % 5 < 2)
+		{
+			kept.push_back(r);
+		}
+	}
+
+	uut.at(1, vm::AllocationProfiler::frame);
+	storage.createBuffer(100);
+	storage.createArray(0, 1);
+
+	CHECK(8 == storage.gc(kept));
+
+	const auto &make = uut.getSites().at({0, 3});
+	CHECK(10 == make.objects);
+	CHECK(10 * (2 * sizeof(vm::Value) + sizeof(vm::Reference)) == make.bytes);
+	CHECK(4 == make.survived && 6 == make.diedYoung);
+	CHECK(0.4 == make.getSurvivalRate());
+
+	CHECK(1 == uut.getSites().at({1, vm::AllocationProfiler::frame}).objects);
+	CHECK(100 == uut.getSites().at({1, vm::AllocationProfiler::frame}).bytes);
+	CHECK(1 == uut.getSites().at({vm::AllocationProfiler::none, vm::AllocationProfiler::none}).objects);
+
+	CHECK(4 == storage.gc(std::vector<vm::Reference>{}));
+	CHECK(4 == uut.getSites().at({0, 3}).survived);
+
+	std::stringstream ss;
+	uut.write(ss);
+	CHECK(ss.str().find("fn0+3\t10\t") < ss.str().find("fn1:frame\t1\t100\t0\n"));
+}
+
+TEST(Profiler, SampledAllocations)
+{
+	static constexpr auto n = 10000;
+
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 0, 1)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jLtI(1, 0, 4),
+					/* 2 */ prog::Instruction::mov({}, 1),
+					/* 3 */ prog::Instruction::ret(0, 1),
+					/* 4 */ prog::Instruction::make({}, 1),
+					/* 5 */ prog::Instruction::callL(1, 1, 0),
+					/* 6 */ prog::Instruction::addIL(1, 1, 1),
+					/* 7 */ prog::Instruction::jump(1),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 1,
+				.code = {
+					/* 0 */ prog::Instruction::ret(0, 0),
+				}
+			}
+		}
+	};
+
+	vm::Storage storage;
+	vm::AllocationProfiler uut(100);
+	storage.setAllocationProfiler(&uut);
+
+	vm::Vm machine(storage, p);
+	machine.enableClosureTier(10, 10);
+	CHECK(n == machine.run({}, {n}).second.front().integer);
+	machine.gc({});
+
+	const auto &make = uut.getSites().at({0, 4});
+	CHECK(n / 200 < make.objects && make.objects < n / 50);
+	CHECK(0 == make.survived && make.objects == make.diedYoung);
+
+	const auto &frames = uut.getSites().at({1, vm::AllocationProfiler::frame});
+	CHECK(n / 200 < frames.objects && frames.objects < n / 50);
+	CHECK(0 == frames.getSurvivalRate());
+
+	CHECK(uut.getSites().size() <= 3);
+}
@@ -0,0 +1,76 @@
+#include "1test/Test.h"
+
+#include "vm/Runtime.h"
+
+TEST_GROUP(Runtime)
+{
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 4,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),     // s = 0;
+					/* 1 */ prog::Instruction::lit({}, 0),     // while(n != 0) {
+					/* 2 */ prog::Instruction::jNe(0, {}, 5),
+					/* 3 */ prog::Instruction::mov({}, 1),
+					/* 4 */ prog::Instruction::ret(0, 1),
+
+					/* 5 */ prog::Instruction::addI(1, 1, 0),  //   s += n;
+					/* 6 */ prog::Instruction::yield(),        //   yield;
+
+					/* 7 */ prog::Instruction::lit({}, 1),     //   n--;
+					/* 8 */ prog::Instruction::subI(0, 0, {}),
+					/* 9 */ prog::Instruction::jump(1),        // } return s;
+				}
+			}
+		}
+	};
+
+	static constexpr auto nInstances = 100;
+};
+
+TEST(Runtime, Sanity)
+{
+	vm::Runtime uut(p, 4, 3);
+
+	std::vector<std::pair<vm::Reference, vm::Reference>> cos;
+	size_t expectedSwitches = 0;
+
+	for(int i = 0; i < nInstances; i++)
+	{
+		auto &s = uut.add().scheduler;
+		cos.push_back({s.spawn(0, {}, {i}), s.spawn(0, {}, {2 * i})});
+		expectedSwitches += 3 * i + 2;
+	}
+
+	CHECK(expectedSwitches == uut.run());
+
+	for(int i = 0; i < nInstances; i++)
+	{
+		auto &m = uut.getInstance(i).vm;
+		CHECK(i * (i + 1) / 2 == m.getResults(cos[i].first).second.front().integer);
+		CHECK(i * (2 * i + 1) == m.getResults(cos[i].second).second.front().integer);
+	}
+}
+
+TEST(Runtime, Rerun)
+{
+	vm::Runtime uut(p, 3);
+
+	for(int i = 0; i < nInstances; i++)
+	{
+		uut.add();
+	}
+
+	CHECK(0 == uut.run());
+
+	auto &s = uut.getInstance(nInstances / 2).scheduler;
+	const auto co = s.spawn(0, {}, {10});
+
+	CHECK(11 == uut.run());
+	CHECK(55 == uut.getInstance(nInstances / 2).vm.getResults(co).second.front().integer);
+}
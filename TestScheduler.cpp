@@ -0,0 +1,111 @@
+#include "1test/Test.h"
+
+#include "vm/Scheduler.h"
+
+TEST_GROUP(Scheduler)
+{
+	vm::Storage storage;
+
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),     // while(n != 0) {
+					/* 1 */ prog::Instruction::jNe(0, {}, 4),
+					/* 2 */ prog::Instruction::lit({}, 42),
+					/* 3 */ prog::Instruction::ret(0, 1),
+
+					/* 4 */ prog::Instruction::yield(),        //   yield;
+
+					/* 5 */ prog::Instruction::lit({}, 1),     //   n--;
+					/* 6 */ prog::Instruction::subI(0, 0, {}),
+					/* 7 */ prog::Instruction::jump(0),        // } return 42;
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					prog::Instruction::movr({}, 0),            // return await(co) + 1;
+					prog::Instruction::await(0, 1),
+					prog::Instruction::lit({}, 1),
+					prog::Instruction::addI({}, {}, {}),
+					prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+};
+
+TEST(Scheduler, Yield)
+{
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	auto a = uut.spawn(0, {}, {2});
+	auto b = uut.spawn(0, {}, {5});
+	CHECK(uut.getSuspendedCount() == 2);
+
+	CHECK(3 + 6 == uut.run());
+	CHECK(uut.getSuspendedCount() == 0);
+
+	CHECK(42 == machine.getResults(a).second.front().integer);
+	CHECK(42 == machine.getResults(b).second.front().integer);
+}
+
+TEST(Scheduler, Limit)
+{
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	uut.spawn(0, {}, {2});
+	uut.spawn(0, {}, {5});
+
+	CHECK(4 == uut.run(4));
+	CHECK(uut.hasReady());
+
+	CHECK(5 == uut.run());
+	CHECK(!uut.hasReady());
+}
+
+TEST(Scheduler, Await)
+{
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	auto b = uut.spawn(0, {}, {3});
+	auto a = uut.spawn(1, {b}, {});
+
+	CHECK(4 + 2 == uut.run());
+	CHECK(43 == machine.getResults(a).second.front().integer);
+
+	auto c = uut.spawn(1, {b}, {});
+	CHECK(1 == uut.run());
+	CHECK(43 == machine.getResults(c).second.front().integer);
+}
+
+TEST(Scheduler, Gc)
+{
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	auto b = uut.spawn(0, {}, {100});
+	uut.spawn(1, {b}, {});
+	CHECK(0 == uut.gc());
+
+	vm::Vm other(storage, p);
+	auto d = other.startCoroutine(0, {}, {0});
+	CHECK(other.resumeCoroutine(d) == vm::Vm::CoroutineState::Finished);
+
+	CHECK(0 < uut.gc());
+	CHECK(101 + 2 == uut.run());
+	CHECK(0 < uut.gc({b}));
+
+	CHECK(42 == machine.getResults(b).second.front().integer);
+}
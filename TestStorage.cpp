@@ -3,6 +3,8 @@
 
 #include "1test/Test.h"
 
+#include <sstream>
+
 TEST_GROUP(Storage)
 {
 	const prog::TypeInfo singleRef = prog::TypeInfo{0, 1, 0};
@@ -85,3 +87,142 @@ TEST(Storage, List)
 
 	CHECK(9 == uut.gc(head));
 }
+
+TEST(Storage, Buffer)
+{
+	auto a = uut.create(singleRef);
+	auto b = uut.createBuffer(16);
+	uut.writer(a, 0, b);
+
+	CHECK(uut.getBufferSize(b) == 16);
+	CHECK(uut.getType(b) == prog::TypeInfo::empty);
+
+	for(int i = 0; i < 16; i++)
+	{
+		CHECK(uut.accessBytes(b, i, 1)[0] == 0);
+		uut.accessBytes(b, i, 1)[0] = i;
+	}
+
+	CHECK(0 == uut.gc(a));
+	CHECK(uut.accessBytes(b, 15, 1)[0] == 15);
+
+	uut.writer(a, 0, vm::null);
+	CHECK(1 == uut.gc(a));
+}
+
+TEST(Storage, Array)
+{
+	auto a = uut.createArray(100, 0);
+	CHECK(uut.getLength(a) == 100);
+
+	for(int i = 0; i < 100; i++)
+	{
+		auto s = uut.createArray(0, i);
+		CHECK(uut.getLength(s) == (size_t)i);
+		uut.writer(a, i, s);
+	}
+
+	auto dangling = uut.createArray(0, 1);
+	uut.writes(dangling, 0, 1);
+
+	CHECK(1 == uut.gc(a));
+	CHECK(uut.readr(a, 99) != vm::null);
+	CHECK(uut.getLength(uut.readr(a, 99)) == 99);
+
+	uut.writer(a, 50, vm::null);
+	CHECK(1 == uut.gc(a));
+}
+
+TEST(Storage, Snapshot)
+{
+	const auto a = uut.create(singleRef, 2), b = uut.create(singleRef, 2);
+	const auto e1 = uut.create(listElement, 1), e2 = uut.create(listElement, 1), e3 = uut.create(listElement, 1);
+	uut.create(listElement, 1); // garbage
+
+	uut.writer(a, 0, e1);
+	uut.writer(b, 0, e2);
+	uut.writer(e1, 0, e2);
+	uut.writer(e2, 0, e3);
+
+	auto s = uut.snapshot({a, b, a, vm::null});
+	s.analyze();
+
+	const auto &o = s.getObjects();
+	CHECK(5 == o.size() && 2 == s.getRootCount());
+	CHECK(o[0].ref == a && o[1].ref == b && o[2].ref == e1 && o[3].ref == e2 && o[4].ref == e3);
+
+	const auto r = sizeof(vm::Reference), e = sizeof(vm::Reference) + sizeof(vm::Value);
+	CHECK(2 * r + 3 * e == s.getTotalSize());
+
+	const auto none = vm::HeapSnapshot::none;
+	CHECK(o[0].dominator == none && o[1].dominator == none && o[2].dominator == 0 && o[3].dominator == none && o[4].dominator == 3);
+	CHECK(o[0].retained == r + e && o[1].retained == r && o[2].retained == e && o[3].retained == 2 * e && o[4].retained == e);
+
+	const auto t = s.getTypeStatistics();
+	CHECK(2 == t.size());
+	CHECK(2 == t.at(2).count && 2 * r == t.at(2).bytes && 2 * r + e == t.at(2).retained);
+	CHECK(3 == t.at(1).count && 3 * e == t.at(1).bytes && 3 * e == t.at(1).retained);
+
+	CHECK(std::vector<uint32_t>{3} == s.getLeakSuspects(0.3));
+	CHECK((std::vector<uint32_t>{3, 2}) == s.getLeakSuspects(0));
+	CHECK(std::vector<uint32_t>{3} == s.getLeakSuspects(0, 1));
+
+	std::stringstream ss;
+	s.write(ss);
+
+	std::string line;
+	std::getline(ss, line);
+	CHECK(line == "heap 5 " + std::to_string(2 * r + 3 * e) + " 2");
+
+	CHECK(1 == uut.gc({a, b}));
+}
+
+TEST(Storage, ParallelMarking)
+{
+	const prog::TypeInfo node(0, 3, 0);
+	vm::Storage sequential, parallel;
+	parallel.setMarkerCount(4);
+
+	std::vector<vm::Reference> roots;
+
+	// The same random graph in both.
+	for(auto *s: {&sequential, &parallel})
+	{
+		std::vector<vm::Reference> objects;
+		uint32_t random = 0x2545f491;
+
+		for(int i = 0; i < 5000; i++)
+		{
+			const auto o = s->create(node);
+
+			for(int j = 0; j < 3 && !objects.empty(); j++)
+			{
+				random ^= random << 13;
+				random ^= random >> 17;
+				random ^= random << 5;
+
+				if(random % 4)
+				{
+					s->writer(o, j, objects[random % objects.size()]);
+				}
+			}
+
+			objects.push_back(o);
+		}
+
+		roots = {objects[4999], objects[3000], objects[17]};
+	}
+
+	// The helpers are kept from one collection to the next, with fewer of them needed each time.
+	for(int i = 0; i < 3; i++)
+	{
+		parallel.setMarkerCount(4 - i);
+		const auto n = sequential.gc(roots);
+		CHECK(n == parallel.gc(roots));
+		CHECK(sequential.getObjectCount() == parallel.getObjectCount());
+
+		roots.pop_back();
+	}
+
+	CHECK(sequential.getObjectCount() < 5000);
+}
@@ -0,0 +1,126 @@
+#include "1test/Test.h"
+
+#include "compiler/internal/Compiler.h"
+
+#include "vm/Vm.h"
+
+TEST_GROUP(Superinstructions)
+{
+	vm::Storage storage;
+
+	static auto ops(const prog::Program &p)
+	{
+		std::vector<prog::Instruction::Operation> ret;
+
+		for(const auto &isn: p.functions[0].code)
+		{
+			ret.push_back(isn.op);
+		}
+
+		return ret;
+	}
+};
+
+TEST(Superinstructions, LoopFactorial)
+{
+	using Op = prog::Instruction::Operation;
+
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 1),
+					/* 1 */ prog::Instruction::lit({}, 0),
+					/* 2 */ prog::Instruction::jNe(0, {}, 4),
+					/* 3 */ prog::Instruction::ret(0, 1),
+					/* 4 */ prog::Instruction::mulI(1, 1, 0),
+					/* 5 */ prog::Instruction::lit({}, 1),
+					/* 6 */ prog::Instruction::subI(0, 0, {}),
+					/* 7 */ prog::Instruction::jump(1),
+				}
+			}
+		}
+	};
+
+	const auto uut = comp::Compiler::fuseInstructions(p);
+	CHECK((ops(uut) == std::vector{Op::lit, Op::jNeL, Op::ret, Op::mulI, Op::subIL, Op::jump}));
+	CHECK(uut.functions[0].code[1].imm2 == 3);
+	CHECK(uut.functions[0].code[5].imm == 1);
+
+	for(int i = 0; i < 8; i++)
+	{
+		const auto expected = vm::Vm(storage, p).run({}, {i}).second.front().integer;
+		CHECK(expected == vm::Vm(storage, uut).run({}, {i}).second.front().integer);
+	}
+}
+
+TEST(Superinstructions, Fibonacci)
+{
+	using Op = prog::Instruction::Operation;
+
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 5,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 2),
+					/*  1 */ prog::Instruction::jLtI(0, {}, 12),
+					/*  2 */ prog::Instruction::lit({}, 1),
+					/*  3 */ prog::Instruction::subI({}, 0, {}),
+					/*  4 */ prog::Instruction::lit({}, 0),
+					/*  5 */ prog::Instruction::call(0, 1),
+					/*  6 */ prog::Instruction::lit({}, 2),
+					/*  7 */ prog::Instruction::subI({}, 0, {}),
+					/*  8 */ prog::Instruction::lit({}, 0),
+					/*  9 */ prog::Instruction::call(0, 1),
+					/* 10 */ prog::Instruction::addI({}, {}, {}),
+					/* 11 */ prog::Instruction::ret(0, 1),
+					/* 12 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	const auto uut = comp::Compiler::fuseInstructions(p);
+	CHECK((ops(uut) == std::vector{Op::jLtIL, Op::subIL, Op::callL, Op::subIL, Op::callL, Op::addI, Op::ret, Op::ret}));
+	CHECK(uut.functions[0].code[0].imm2 == 7);
+
+	CHECK(55 == vm::Vm(storage, uut).run({}, {10}).second.front().integer);
+}
+
+TEST(Superinstructions, JumpTarget)
+{
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 3),
+					/* 1 */ prog::Instruction::jump(3),
+					/* 2 */ prog::Instruction::lit({}, 5),
+					/* 3 */ prog::Instruction::addI({}, 0, {}),  // Not fused, as it is a jump target
+					/* 4 */ prog::Instruction::lit({}, 1),
+					/* 5 */ prog::Instruction::addI({}, {}, {}), // Not fused, the literal is not the last operand
+					/* 6 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	const auto uut = comp::Compiler::fuseInstructions(p);
+	CHECK(ops(uut) == ops(p));
+	CHECK(4 == vm::Vm(storage, uut).run({}, {0}).second.front().integer);
+}
@@ -2,6 +2,8 @@
 
 #include "vm/Vm.h"
 
+#include <cstring>
+
 static const std::pair<int, int> factorialTestVectors[] =
 {
 	{0, 1},
@@ -135,6 +137,10 @@ TEST(Vm, UnaryOpMov) { unaryTest(prog::Instruction::mov({}, {}), 69, 69); }
 TEST(Vm, UnaryOpNeg) { unaryTest(prog::Instruction::neg({}, {}), 69, ~69); }
 TEST(Vm, UnaryOpI2f) { unaryTest(prog::Instruction::i2f({}, {}), 69, 69.0f); }
 TEST(Vm, UnaryOpF2i) { unaryTest(prog::Instruction::f2i({}, {}), 69.0f, 69); }
+TEST(Vm, UnaryOpX1i) { unaryTest(prog::Instruction::x1i({}, {}), 0x1ff, -1); }
+TEST(Vm, UnaryOpX1u) { unaryTest(prog::Instruction::x1u({}, {}), -1, 0xff); }
+TEST(Vm, UnaryOpX2i) { unaryTest(prog::Instruction::x2i({}, {}), 0x18000, -0x8000); }
+TEST(Vm, UnaryOpX2u) { unaryTest(prog::Instruction::x2u({}, {}), -1, 0xffff); }
 
 TEST(Vm, ConditionalEq1) { conditionalTest(prog::Instruction::jEq({}, {}, 3), 69, 69, true); }
 TEST(Vm, ConditionalEq2) { conditionalTest(prog::Instruction::jEq({}, {}, 3), 69, 420, false); }
@@ -422,3 +428,375 @@ TEST(Vm, StaticAccess)
 	CHECK(r != vm::null);
 	CHECK(420 == storage.reads(r, 0).integer);
 }
+
+TEST(Vm, NativeCall)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					prog::Instruction::mov({}, 0),
+					prog::Instruction::lit({}, 3),
+					prog::Instruction::ncall(0),
+					prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm uut(storage, p);
+	CHECK(0 == uut.addNative({[](vm::NativeFrame& f){ f.scalars[0] = f.scalars[0].integer - f.scalars[1].integer; }, 0, 2, 0, 1}));
+	CHECK(39 == uut.run({}, {42}).second.front().integer);
+}
+
+TEST(Vm, NativeObjectAccess)
+{
+	prog::Program p = {
+		.types = {
+			prog::TypeInfo::empty,
+			listElement
+		},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 1,
+				.code = {
+					prog::Instruction::make({}, 1),
+					prog::Instruction::ncall(0),
+					prog::Instruction::ret(1, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm uut(storage, p);
+	uut.addNative({[](vm::NativeFrame& f)
+	{
+		const auto obj = f.references[0];
+		f.storage.accessScalars(obj)[0] = 123;
+		f.storage.overwriting(f.storage.readr(obj, 0));
+		vm::storeReference(f.storage.accessReferences(obj), obj);
+		f.scalars[0] = (int)f.storage.getType(obj).nScalars;
+	}, 1, 0, 1, 1});
+
+	const auto r = uut.run({}, {});
+	const auto obj = r.first.front();
+	CHECK(1 == r.second.front().integer);
+	CHECK(123 == storage.reads(obj, 0).integer);
+	CHECK(obj == storage.readr(obj, 0));
+}
+
+TEST(Vm, BufferLoadStore)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 3,
+				.code = {
+					prog::Instruction::lit({}, 4),
+					prog::Instruction::lit({}, 0x12345678),
+					prog::Instruction::st4({}, 0, {}),  // buf[4..7] = 0x12345678
+					prog::Instruction::lit({}, 1),
+					prog::Instruction::lit({}, 0xfedc),
+					prog::Instruction::st2({}, 0, {}),  // buf[1..2] = 0xfedc
+					prog::Instruction::lit({}, 1),
+					prog::Instruction::ld2i({}, 0, {}), // -> (int16_t)0xfedc
+					prog::Instruction::lit({}, 2),
+					prog::Instruction::ld1i({}, 0, {}), // -> (int8_t)0xfe
+					prog::Instruction::lit({}, 7),
+					prog::Instruction::ld1u({}, 0, {}), // -> 0x12
+					prog::Instruction::ret(0, 3),
+				}
+			}
+		}
+	};
+
+	const auto buffer = storage.createBuffer(8);
+	const auto r = vm::Vm(storage, p).run({buffer}, {}).second;
+
+	CHECK(r.size() == 3);
+	CHECK(r[0].integer == 0x12);
+	CHECK(r[1].integer == -2);
+	CHECK(r[2].integer == (int16_t)0xfedc);
+
+	CHECK(*storage.accessBytes(buffer, 0, 1) == 0);
+	CHECK(*storage.accessBytes(buffer, 3, 1) == 0);
+}
+
+TEST(Vm, PackedFields)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 0, 1, 8)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 6,
+				.code = {
+					prog::Instruction::callL(1, 0, 0),
+					prog::Instruction::ret(0, 6),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 6,
+				.code = {
+					prog::Instruction::make({}, 1),
+					prog::Instruction::lit({}, 0x12345678),
+					prog::Instruction::puts4({}, 0, 0),     // o.b[0..3] = 0x12345678
+					prog::Instruction::lit({}, 0xfedc),
+					prog::Instruction::puts2({}, 0, 4),     // o.b[4..5] = 0xfedc
+					prog::Instruction::lit({}, 0x1ff),
+					prog::Instruction::puts1({}, 0, 6),     // o.b[6] = 0xff, truncated
+					prog::Instruction::lit({}, 7),
+					prog::Instruction::puts({}, 0, 0),      // o.s[0] = 7, independent of the packed area
+					prog::Instruction::gets4({}, 0, 0),     // -> 0x12345678
+					prog::Instruction::gets2i({}, 0, 4),    // -> (int16_t)0xfedc
+					prog::Instruction::gets2u({}, 0, 4),    // -> 0xfedc
+					prog::Instruction::gets1i({}, 0, 6),    // -> -1
+					prog::Instruction::gets1u({}, 0, 6),    // -> 0xff
+					prog::Instruction::gets({}, 0, 0),      // -> 7
+					prog::Instruction::ret(0, 6),
+				}
+			}
+		}
+	};
+
+	for(const bool tiered: {false, true})
+	{
+		vm::Vm uut(storage, p);
+
+		if(tiered)
+		{
+			uut.enableClosureTier(1, 1);
+		}
+
+		const auto r = uut.run({}, {}).second;
+
+		CHECK(tiered == (1 == uut.getStatistics().tierUps));
+		CHECK(r.size() == 6);
+		CHECK(r[0].integer == 7);
+		CHECK(r[1].integer == 0xff);
+		CHECK(r[2].integer == -1);
+		CHECK(r[3].integer == 0xfedc);
+		CHECK(r[4].integer == (int16_t)0xfedc);
+		CHECK(r[5].integer == 0x12345678);
+	}
+}
+
+TEST(Vm, BufferBulk)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 4,
+				.nScalars = 4,
+				.code = {
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::lit({}, 2),
+					prog::Instruction::lit({}, 0xab),
+					prog::Instruction::lit({}, 4),
+					prog::Instruction::bset(),          // a[2..5] = 0xab
+
+					prog::Instruction::movr({}, 1),
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::lit({}, 1),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 6),
+					prog::Instruction::bcpy(),          // b[1..6] = a[0..5]
+
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::movr({}, 1),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 1),
+					prog::Instruction::lit({}, 6),
+					prog::Instruction::bcmp(),          // a[0..5] <=> b[1..6]
+
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::movr({}, 1),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 8),
+					prog::Instruction::bcmp(),          // a <=> b
+
+					prog::Instruction::ret(0, 2),
+				}
+			}
+		}
+	};
+
+	const auto a = storage.createBuffer(8);
+	const auto b = storage.createBuffer(8);
+	const auto r = vm::Vm(storage, p).run({b, a}, {}).second;
+
+	CHECK(r.size() == 2);
+	CHECK(r[0].integer == 1);
+	CHECK(r[1].integer == 0);
+
+	const uint8_t expected[] = {0, 0, 0, 0xab, 0xab, 0xab, 0xab, 0};
+	CHECK(memcmp(storage.accessBytes(b, 0, 8), expected, 8) == 0);
+}
+
+TEST(Vm, BufferEmpty)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 4,
+				.nScalars = 4,
+				.code = {
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0xab),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::bset(),
+
+					prog::Instruction::movr({}, 1),
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::bcpy(),
+
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::movr({}, 1),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::bcmp(),
+
+					prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	// Nothing is allocated for the bytes of these.
+	const auto a = storage.createBuffer(0);
+	const auto b = storage.createBuffer(0);
+	const auto r = vm::Vm(storage, p).run({b, a}, {}).second;
+
+	CHECK(r.size() == 1);
+	CHECK(r[0].integer == 0);
+}
+
+TEST(Vm, Array)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 3,
+				.nScalars = 4,
+				.code = {
+					/*  0 */ prog::Instruction::news({}, 0),       // r0 -> squares = new int[n]
+					/*  1 */ prog::Instruction::lit({}, 1),
+					/*  2 */ prog::Instruction::newr({}, {}),      // r1 -> holder = new int[][1]
+					/*  3 */ prog::Instruction::lit({}, 0),        // holder[0] = squares
+					/*  4 */ prog::Instruction::aputr(0, 1, {}),
+
+					/*  5 */ prog::Instruction::lit({}, 0),        // s1 -> i
+
+					/*  6 */ prog::Instruction::alen({}, 0),       // while(i < squares.length) {
+					/*  7 */ prog::Instruction::jLtI(1, {}, 9),
+					/*  8 */ prog::Instruction::jump(14),
+
+					/*  9 */ prog::Instruction::mulI({}, 1, 1),    //   squares[i] = i * i
+					/* 10 */ prog::Instruction::aputs({}, 0, 1),
+
+					/* 11 */ prog::Instruction::lit({}, 1),        //   i++
+					/* 12 */ prog::Instruction::addI(1, 1, {}),
+					/* 13 */ prog::Instruction::jump(6),           // }
+
+					/* 14 */ prog::Instruction::lit({}, 0),        // return holder[0][n - 1]
+					/* 15 */ prog::Instruction::agetr({}, 1, {}),
+					/* 16 */ prog::Instruction::lit({}, 1),
+					/* 17 */ prog::Instruction::subI({}, 0, {}),
+					/* 18 */ prog::Instruction::agets({}, {}, {}),
+					/* 19 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	CHECK(81 == vm::Vm(storage, p).run({}, {10}).second.front().integer);
+}
+
+TEST(Vm, BackgroundCollection)
+{
+	// Prepends the given number of new elements to the list in the static field.
+	const prog::Program p = {
+		.types = {prog::TypeInfo(0, 1, 0), listElement},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jLtI(1, 0, 3),
+					/* 2 */ prog::Instruction::ret(0, 0),
+					/* 3 */ prog::Instruction::make({}, 1),
+					/* 4 */ prog::Instruction::putr(prog::Instruction::Reg::global(0), 0, 0),
+					/* 5 */ prog::Instruction::movr(prog::Instruction::Reg::global(0), {}),
+					/* 6 */ prog::Instruction::addIL(1, 1, 1),
+					/* 7 */ prog::Instruction::jump(1),
+				}
+			}
+		}
+	};
+
+	for(const auto tiered: {false, true})
+	{
+		vm::Storage storage;
+		vm::Vm machine(storage, p);
+
+		if(tiered)
+		{
+			machine.enableClosureTier(1, 1);
+		}
+
+		machine.run({}, {1000});
+		machine.gc({});
+		const auto before = storage.getObjectCount();
+		machine.run({}, {0});
+
+		// Every element is referenced only from the new ones once the head is overwritten.
+		machine.startCollection({});
+
+		for(int i = 0; i < 10; i++)
+		{
+			machine.run({}, {100});
+		}
+
+		machine.finishCollection({});
+		// Only the frame of the run before, the new objects are kept until the next collection.
+		CHECK(1 == storage.waitForCollection());
+		CHECK(before + 1000 + 10 == storage.getObjectCount());
+
+		CHECK(10 == machine.gc({}));
+		CHECK(before + 1000 == storage.getObjectCount());
+	}
+}
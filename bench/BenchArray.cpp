@@ -0,0 +1,104 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+static constexpr auto nElements = 10000;
+
+TEST_GROUP(BenchArray)
+{
+	vm::Storage storage;
+};
+
+TEST(BenchArray, SumArrayVsList)
+{
+	static const prog::TypeInfo listElement(0, 1, 1);
+
+	prog::Program list = {
+		.types = {prog::TypeInfo::empty, listElement},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 2,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),        // s0 -> sum
+					/* 1 */ prog::Instruction::jNnl(0, 3),        // while(p != null) {
+					/* 2 */ prog::Instruction::ret(0, 1),
+
+					/* 3 */ prog::Instruction::gets({}, 0, 0),    //   sum += p->s0;
+					/* 4 */ prog::Instruction::addI(0, 0, {}),
+
+					/* 5 */ prog::Instruction::getr(0, 0, 0),     //   p = p->r0;
+					/* 6 */ prog::Instruction::jump(1),           // }
+				}
+			}
+		}
+	};
+
+	prog::Program array = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 1,
+				.nScalars = 4,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),        // s0 -> sum
+					/* 1 */ prog::Instruction::alen({}, 0),       // s1 -> i = a.length
+
+					/* 2 */ prog::Instruction::lit({}, 0),        // while(i != 0) {
+					/* 3 */ prog::Instruction::jNe(1, {}, 5),
+					/* 4 */ prog::Instruction::ret(0, 2),
+
+					/* 5 */ prog::Instruction::lit({}, 1),        //   i--;
+					/* 6 */ prog::Instruction::subI(1, 1, {}),
+
+					/* 7 */ prog::Instruction::agets({}, 0, 1),   //   sum += a[i];
+					/* 8 */ prog::Instruction::addI(0, 0, {}),
+					/* 9 */ prog::Instruction::jump(2),           // }
+				}
+			}
+		}
+	};
+
+	vm::Reference head = vm::null;
+	bench::report("list construction", bench::measure(nElements, [&]()
+	{
+		head = vm::null;
+
+		for(int i = 0; i < nElements; i++)
+		{
+			auto next = storage.create(listElement);
+			storage.writes(next, 0, i);
+			storage.writer(next, 0, head);
+			head = next;
+		}
+	}), "ns/element");
+
+	vm::Reference a = vm::null;
+	bench::report("array construction", bench::measure(nElements, [&]()
+	{
+		a = storage.createArray(0, nElements);
+
+		for(int i = 0; i < nElements; i++)
+		{
+			storage.writes(a, i, i);
+		}
+	}), "ns/element");
+
+	const int expected = nElements * (nElements - 1) / 2;
+
+	bench::report("list iteration", bench::measure(nElements, [&]()
+	{
+		CHECK(expected == vm::Vm(storage, list).run({head}, {}).second.front().integer);
+	}), "ns/element");
+
+	bench::report("array iteration", bench::measure(nElements, [&]()
+	{
+		CHECK(expected == vm::Vm(storage, array).run({a}, {}).second.back().integer);
+	}), "ns/element");
+}
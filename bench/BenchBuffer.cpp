@@ -0,0 +1,131 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+#include <cstring>
+
+static constexpr auto bufferSize = 64 * 1024;
+
+TEST_GROUP(BenchBuffer)
+{
+	vm::Storage storage;
+
+	static inline prog::Program checksum(prog::Instruction load, int step)
+	{
+		return {
+			.types = {prog::TypeInfo::empty},
+			.functions =
+			{
+				prog::Function
+				{
+					.nRefs = 1,
+					.nScalars = 4,
+					.code = {
+						/* 0 */ prog::Instruction::lit({}, 0),        // s1 -> i
+						/* 1 */ prog::Instruction::lit({}, 0),        // s2 -> sum
+
+						/* 2 */ prog::Instruction::jLtU(1, 0, 4),     // while(i < n) {
+						/* 3 */ prog::Instruction::ret(0, 1),
+
+						/* 4 */ load,                                 //   sum += buf[i];
+						/* 5 */ prog::Instruction::addI(2, 2, {}),
+
+						/* 6 */ prog::Instruction::lit({}, step),     //   i += step;
+						/* 7 */ prog::Instruction::addI(1, 1, {}),
+						/* 8 */ prog::Instruction::jump(2),           // }
+					}
+				}
+			}
+		};
+	}
+
+	static inline void reportThroughput(const char* name, double nsPerByte) {
+		bench::report(name, 1e3 / nsPerByte, "MB/s");
+	}
+};
+
+TEST(BenchBuffer, Checksum)
+{
+	const auto buffer = storage.createBuffer(bufferSize);
+	const auto data = storage.accessBytes(buffer, 0, bufferSize);
+
+	int expected = 0;
+	for(int i = 0; i < bufferSize; i++)
+	{
+		expected += data[i] = (uint8_t)(i * 7);
+	}
+
+	const auto bytewise = checksum(prog::Instruction::ld1u({}, 0, 1), 1);
+	reportThroughput("checksum ld1u", bench::measure(bufferSize, [&]()
+	{
+		CHECK(expected == vm::Vm(storage, bytewise).run({buffer}, {bufferSize}).second.front().integer);
+	}));
+
+	const auto wordwise = checksum(prog::Instruction::ld4({}, 0, 1), 4);
+	reportThroughput("checksum ld4", bench::measure(bufferSize, [&]()
+	{
+		vm::Vm(storage, wordwise).run({buffer}, {bufferSize});
+	}));
+}
+
+TEST(BenchBuffer, Copy)
+{
+	prog::Program loop = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),        // s1 -> i
+
+					/* 1 */ prog::Instruction::jLtU(1, 0, 3),     // while(i < n) {
+					/* 2 */ prog::Instruction::ret(0, 0),
+
+					/* 3 */ prog::Instruction::ld1u({}, 1, 1),    //   dst[i] = src[i];
+					/* 4 */ prog::Instruction::st1({}, 0, 1),
+
+					/* 5 */ prog::Instruction::lit({}, 1),        //   i++;
+					/* 6 */ prog::Instruction::addI(1, 1, {}),
+					/* 7 */ prog::Instruction::jump(1),           // }
+				}
+			}
+		}
+	};
+
+	prog::Program bulk = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 4,
+				.nScalars = 4,
+				.code = {
+					prog::Instruction::movr({}, 0),
+					prog::Instruction::movr({}, 1),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::lit({}, 0),
+					prog::Instruction::mov({}, 0),
+					prog::Instruction::bcpy(),
+					prog::Instruction::ret(0, 0),
+				}
+			}
+		}
+	};
+
+	const auto src = storage.createBuffer(bufferSize);
+	const auto dst = storage.createBuffer(bufferSize);
+	memset(storage.accessBytes(src, 0, bufferSize), 0x5a, bufferSize);
+
+	reportThroughput("copy ld1u/st1", bench::measure(bufferSize, [&](){ vm::Vm(storage, loop).run({src, dst}, {bufferSize}); }));
+	CHECK(memcmp(storage.accessBytes(src, 0, bufferSize), storage.accessBytes(dst, 0, bufferSize), bufferSize) == 0);
+
+	memset(storage.accessBytes(dst, 0, bufferSize), 0, bufferSize);
+	reportThroughput("copy bcpy", bench::measure(bufferSize, [&](){ vm::Vm(storage, bulk).run({src, dst}, {bufferSize}); }));
+	CHECK(memcmp(storage.accessBytes(src, 0, bufferSize), storage.accessBytes(dst, 0, bufferSize), bufferSize) == 0);
+}
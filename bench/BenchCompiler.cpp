@@ -0,0 +1,348 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "compiler/internal/Compiler.h"
+#include "compiler/builder/FunctionBuilder.h"
+#include "compiler/builder/ClassBuilder.h"
+#include "compiler/builder/Helpers.h"
+
+#include <filesystem>
+
+static constexpr auto nRuns = 100;
+
+/*
+ * Runs the IR pipeline on every function, reports the time it takes and the object allocations
+ * left and removed by scalar replacement.
+ */
+static void optimize(const std::string& name, comp::Compiler c)
+{
+	std::string cfg;
+	const auto t = bench::measure(nRuns, [&]()
+	{
+		for(int i = 0; i < nRuns; i++)
+		{
+			cfg = comp::Compiler(c).dumpCfg();
+		}
+	});
+
+	size_t nCreates = 0;
+	for(auto i = cfg.find("← new "); i != std::string::npos; i = cfg.find("← new ", i + 1))
+	{
+		nCreates++;
+	}
+
+	c.dumpCfg();
+	bench::report(name + ".optimization", t / 1000, "us");
+	bench::report(name + ".eliminatedAllocations", (double)c.getStatistics().eliminatedAllocations, "sites");
+	bench::report(name + ".remainingAllocations", (double)nCreates, "sites");
+}
+
+TEST_GROUP(BenchCompiler) {};
+
+/*
+ * Temporary pair holding the bounds of a range.
+ */
+TEST(BenchCompiler, Pair)
+{
+	auto pair = comp::ClassBuilder::make();
+	auto fLow = pair.addField(comp::ast::ValueType::integer());
+	auto fHigh = pair.addField(comp::ast::ValueType::integer());
+
+	auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer(), comp::ast::ValueType::integer()});
+	auto p = f <<= comp::declaration(pair());
+	f <<= p[fLow] = comp::ternary(f[0] < f[1], f[0], f[1]);
+	f <<= p[fHigh] = comp::ternary(f[0] < f[1], f[1], f[0]);
+	f <<= comp::ret(p[fHigh] - p[fLow]);
+
+	optimize("pair", f.build());
+}
+
+/*
+ * Iterator object created for a loop.
+ */
+TEST(BenchCompiler, Iterator)
+{
+	auto it = comp::ClassBuilder::make();
+	auto fIndex = it.addField(comp::ast::ValueType::integer());
+	auto fEnd = it.addField(comp::ast::ValueType::integer());
+
+	auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	auto s = f <<= comp::declaration(0);
+	auto i = f <<= comp::declaration(it());
+	f <<= i[fEnd] = f[0];
+	f <<= comp::loop();
+	f <<= 	comp::conditional(!(i[fIndex] < i[fEnd]));
+	f <<= 		comp::exitLoop();
+	f <<= 	comp::endBlock();
+	f <<= 	s = s + i[fIndex];
+	f <<= 	i[fIndex] = i[fIndex] + 1;
+	f <<= comp::endBlock();
+	f <<= comp::ret(s);
+
+	optimize("iterator", f.build());
+}
+
+/*
+ * Result holder filled in by a callee, which needs a real object without inlining.
+ */
+TEST(BenchCompiler, ResultHolder)
+{
+	auto holder = comp::ClassBuilder::make();
+	auto fValue = holder.addField(comp::ast::ValueType::integer());
+
+	auto fill = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::reference(holder.data)});
+	fill <<= fill[0][fValue] = 42;
+	fill <<= comp::ret(1);
+
+	auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {});
+	auto h = f <<= comp::declaration(holder());
+	auto ok = f <<= comp::declaration(fill(h));
+	f <<= comp::ret(ok * h[fValue]);
+
+	optimize("resultHolder", f.build());
+}
+
+/*
+ * A chain of functions each calling the previous one in a loop, the one at the given position
+ * differs from the others in a constant.
+ */
+static inline comp::Compiler generateProgram(int nFunctions, int edited = -1)
+{
+	auto it = comp::ClassBuilder::make();
+	auto fIndex = it.addField(comp::ast::ValueType::integer());
+
+	auto callee = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+	callee <<= comp::ret(callee[0]);
+
+	for(int n = 0; n < nFunctions; n++)
+	{
+		auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto s = f <<= comp::declaration((n == edited) ? n + 1 : n);
+		auto i = f <<= comp::declaration(it());
+		f <<= comp::loop();
+		f <<= 	comp::conditional(!(i[fIndex] < f[0]));
+		f <<= 		comp::exitLoop();
+		f <<= 	comp::endBlock();
+		f <<= 	s = s + callee(i[fIndex] * 3 + n);
+		f <<= 	i[fIndex] = i[fIndex] + 1;
+		f <<= comp::endBlock();
+		f <<= comp::ret(s);
+		callee = f;
+	}
+
+	return callee.build();
+}
+
+/*
+ * Wall-clock time of the IR pipeline on a large generated program, from one thread up to the
+ * number of cores (at least four).
+ */
+TEST(BenchCompiler, Scaling)
+{
+	const auto program = generateProgram(1000);
+	const auto maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+	// Widest first, the reference counting of the standard library is only atomic after a thread is started.
+	std::vector<std::pair<unsigned int, double>> times;
+	std::string reference;
+
+	for(auto n = maxThreads; n; n /= 2)
+	{
+		std::string cfg;
+		const auto t = bench::measure(1, [&]()
+		{
+			auto c = program;
+			c.setThreadCount(n);
+			cfg = c.dumpCfg();
+		});
+
+		CHECK(reference.empty() || cfg == reference);
+		reference = cfg;
+		times.push_back({n, t});
+	}
+
+	for(auto it = times.rbegin(); it != times.rend(); it++)
+	{
+		bench::report("scaling.threads" + std::to_string(it->first), it->second / 1e6, "ms");
+		bench::report("scaling.threads" + std::to_string(it->first) + ".speedup", times.back().second / it->second, "x");
+	}
+}
+
+/*
+ * Rebuilding the generated program after changing a single function, with the results of the
+ * others taken from the cache filled by a cold build, against the cold build itself.
+ */
+TEST(BenchCompiler, IncrementalRebuild)
+{
+	static constexpr auto nFunctions = 1000;
+
+	const auto dir = std::filesystem::temp_directory_path() / "BenchCompilerCache";
+	std::filesystem::remove_all(dir);
+
+	// Timed by single runs, as a warm-up would fill the cache.
+	std::string cold, warm, edited;
+	size_t misses = 0;
+
+	const auto tCold = bench::time([&]()
+	{
+		auto c = generateProgram(nFunctions);
+		c.setCache(std::make_shared<comp::CompilationCache>(dir.string()));
+		cold = c.dumpCfg();
+	});
+
+	const auto tRebuild = bench::time([&]()
+	{
+		auto c = generateProgram(nFunctions, nFunctions / 2);
+		auto cache = std::make_shared<comp::CompilationCache>(dir.string());
+		c.setCache(cache);
+		edited = c.dumpCfg();
+		misses = cache->getMissCount();
+	});
+
+	const auto tUncached = bench::time([&]()
+	{
+		warm = generateProgram(nFunctions, nFunctions / 2).dumpCfg();
+	});
+
+	CHECK(1 == misses);
+	CHECK(edited == warm);
+	CHECK(edited != cold);
+
+	bench::report("incremental.cold", tCold / 1e6, "ms");
+	bench::report("incremental.uncached", tUncached / 1e6, "ms");
+	bench::report("incremental.rebuild", tRebuild / 1e6, "ms");
+	bench::report("incremental.speedup", tCold / tRebuild, "x");
+
+	std::filesystem::remove_all(dir);
+}
+
+/*
+ * Collecting the functions and classes of programs of growing size and looking up the index of
+ * each of them, the time per element should not grow with the size of the program.
+ */
+TEST(BenchCompiler, ObjectTables)
+{
+	for(auto n: {100, 1000, 10000})
+	{
+		auto callee = comp::FunctionBuilder::make({}, {});
+		callee <<= comp::ret();
+
+		for(int i = 0; i < n; i++)
+		{
+			auto c = comp::ClassBuilder::make();
+			c.addField(comp::ast::ValueType::integer());
+
+			auto f = comp::FunctionBuilder::make({}, {});
+			f <<= comp::declaration(c());
+			f <<= callee();
+			f <<= comp::ret();
+			callee = f;
+		}
+
+		const auto entry = callee.build().getProgramObjects().functions.front();
+		size_t sum = 0;
+
+		const auto t = bench::measure(2 * n, [&]()
+		{
+			const auto gi = comp::ast::ProgramObjectSet::shakeTree(entry);
+
+			for(const auto& f: gi.functions)
+			{
+				sum += gi.getFunctionIndex(f.get());
+			}
+
+			for(const auto& c: gi.classes)
+			{
+				sum += gi.getClassIndex(c.get());
+			}
+		});
+
+		CHECK(sum);
+		bench::report("objectTables.elements" + std::to_string(2 * n), t, "ns");
+	}
+}
+
+/*
+ * Counted loops of a few shapes run on the IR with and without unrolling, reporting the operations
+ * and terminations executed (the dispatches) and the conditional branches among them. The loop up
+ * to the argument is not counted, for reference.
+ */
+TEST(BenchCompiler, LoopUnrolling)
+{
+	static constexpr auto rolled = comp::Options::doJumpOptimizations | comp::Options::propagateConstants | comp::Options::eliminateDeadCode |
+			comp::Options::replaceScalars | comp::Options::propagateCopies | comp::Options::simplifyOperations;
+
+	const auto counted = [](int start, int end, int step)
+	{
+		auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto s = f <<= comp::declaration(0);
+		auto i = f <<= comp::declaration(start);
+		f <<= comp::loop();
+		f <<= 	comp::conditional(!(i < end));
+		f <<= 		comp::exitLoop();
+		f <<= 	comp::endBlock();
+		f <<= 	s = s * 31 + (i ^ f[0]);
+		f <<= 	i = i + step;
+		f <<= comp::endBlock();
+		f <<= comp::ret(s);
+		return f.build();
+	};
+
+	// Like building a list of the given length from the end, with the test at the bottom.
+	const auto countdown = [](int n)
+	{
+		auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto s = f <<= comp::declaration(0);
+		auto i = f <<= comp::declaration(n);
+		f <<= comp::loop();
+		f <<= 	s = s + i * f[0];
+		f <<= 	i = i - 1;
+		f <<= 	comp::conditional(i == 0);
+		f <<= 		comp::exitLoop();
+		f <<= 	comp::endBlock();
+		f <<= comp::endBlock();
+		f <<= comp::ret(s);
+		return f.build();
+	};
+
+	const auto bounded = []()
+	{
+		auto f = comp::FunctionBuilder::make({comp::ast::ValueType::integer()}, {comp::ast::ValueType::integer()});
+		auto s = f <<= comp::declaration(0);
+		auto i = f <<= comp::declaration(0);
+		f <<= comp::loop();
+		f <<= 	comp::conditional(!(i < f[0]));
+		f <<= 		comp::exitLoop();
+		f <<= 	comp::endBlock();
+		f <<= 	s = s * 31 + i;
+		f <<= 	i = i + 1;
+		f <<= comp::endBlock();
+		f <<= comp::ret(s);
+		return f.build();
+	};
+
+	const std::pair<const char*, comp::Compiler> kernels[] =
+	{
+		{"small", counted(0, 8, 1)},
+		{"strided", counted(3, 100, 4)},
+		{"long", counted(0, 1000, 1)},
+		{"countdown", countdown(100)},
+		{"bounded", bounded()},
+	};
+
+	for(const auto& k: kernels)
+	{
+		const auto before = k.second.execute(0, {100}, rolled), after = k.second.execute(0, {100});
+
+		CHECK(before.has_value() && after.has_value());
+		CHECK(before->ret == after->ret);
+
+		const auto dispatches = [](const auto& e) { return (double)(e->nOperations + e->nBranches + e->nJumps); };
+		const auto name = std::string("unroll.") + k.first;
+		bench::report(name + ".dispatches", dispatches(after), "");
+		bench::report(name + ".dispatchReduction", dispatches(before) / dispatches(after), "x");
+		bench::report(name + ".branches", (double)after->nBranches, "");
+		bench::report(name + ".branchReduction", (double)before->nBranches / std::max<size_t>(after->nBranches, 1), "x");
+	}
+}
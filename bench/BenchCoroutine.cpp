@@ -0,0 +1,75 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Scheduler.h"
+
+static constexpr auto nCoroutines = 10000;
+static constexpr auto nYields = 10;
+
+TEST_GROUP(BenchCoroutine)
+{
+	vm::Storage storage;
+
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),     // while(n != 0) {
+					/* 1 */ prog::Instruction::jNe(0, {}, 3),
+					/* 2 */ prog::Instruction::ret(0, 0),
+
+					/* 3 */ prog::Instruction::yield(),        //   yield;
+
+					/* 4 */ prog::Instruction::lit({}, 1),     //   n--;
+					/* 5 */ prog::Instruction::subI(0, 0, {}),
+					/* 6 */ prog::Instruction::jump(0),        // }
+				}
+			}
+		}
+	};
+};
+
+TEST(BenchCoroutine, SwitchCost)
+{
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	size_t nSwitches = 0;
+	bench::report("context switch", bench::measure(nCoroutines * (nYields + 1), [&]()
+	{
+		for(int i = 0; i < nCoroutines; i++)
+		{
+			uut.spawn(0, {}, {nYields});
+		}
+
+		nSwitches = uut.run();
+		uut.gc();
+	}), "ns/switch");
+
+	CHECK(nSwitches == nCoroutines * (nYields + 1));
+}
+
+TEST(BenchCoroutine, Footprint)
+{
+	vm::Vm machine(storage, p);
+	vm::Scheduler uut(machine);
+
+	const auto before = bench::Memory::current();
+
+	for(int i = 0; i < nCoroutines; i++)
+	{
+		uut.spawn(0, {}, {nYields});
+	}
+
+	const auto after = bench::Memory::current();
+	bench::report("suspended coroutine", (double)(after - before) / nCoroutines, "bytes");
+
+	uut.run();
+	uut.gc();
+}
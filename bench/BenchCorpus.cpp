@@ -0,0 +1,304 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+#include "compiler/internal/Compiler.h"
+
+#include <fstream>
+
+/*
+ * Runs the program repeatedly on a fresh VM with a full gc after every run, returns the
+ * scalar results and the average run time.
+ */
+static std::pair<std::vector<int>, double> runProgram(const std::string& name, const prog::Program& p, std::vector<vm::Value> args, size_t nRuns, bool tiered)
+{
+	vm::Storage storage;
+	vm::Vm machine(storage, p);
+
+	if(tiered)
+	{
+		machine.enableClosureTier();
+	}
+
+#ifdef VM_PROFILE
+	vm::Profiler profiler;
+	machine.setProfiler(&profiler);
+#endif
+
+	std::vector<int> ret;
+
+	for(const auto& v: machine.run({}, args).second)
+	{
+		ret.push_back(v.integer);
+	}
+
+	machine.gc({});
+
+	std::vector<double> pauses;
+	pauses.reserve(nRuns);
+
+	const auto baseMemory = bench::Memory::current();
+	bench::Memory::resetPeak();
+
+	const auto stats0 = machine.getStatistics();
+	const auto allocs0 = storage.getAllocationCount();
+
+	double runTime = 0;
+
+	for(auto i = 0u; i < nRuns; i++)
+	{
+		runTime += bench::time([&](){ machine.run({}, args); });
+		pauses.push_back(bench::time([&](){ machine.gc({}); }) / 1000);
+	}
+
+	const auto peakMemory = bench::Memory::peak() - baseMemory;
+	const auto seconds = runTime / 1e9;
+	const auto &stats = machine.getStatistics();
+
+	bench::report(name + ".runtime", runTime / nRuns / 1000, "us/run");
+	bench::report(name + ".dispatches", (double)(stats.instructions - stats0.instructions) / nRuns, "instr/run");
+	bench::report(name + ".instructions", (stats.instructions - stats0.instructions) / seconds, "instr/s");
+	bench::report(name + ".calls", (stats.calls - stats0.calls) / seconds, "call/s");
+	bench::report(name + ".allocations", (storage.getAllocationCount() - allocs0) / seconds, "alloc/s");
+	bench::report(name + ".gc", pauses, "us");
+	bench::report(name + ".peak", (double)peakMemory, "bytes");
+
+#ifdef VM_PROFILE
+	std::ofstream flat(name + ".profile");
+	profiler.writeFlat(flat);
+
+	std::ofstream folded(name + ".folded");
+	profiler.writeFolded(folded);
+
+	std::ofstream sequences(name + ".sequences");
+	profiler.writeSequences(sequences);
+#endif
+
+	return {ret, runTime / nRuns};
+}
+
+/*
+ * Standard program corpus, each one measured as written, after superinstruction fusion
+ * and with the closure tier enabled.
+ */
+static void runCorpus(const std::string& name, const prog::Program& p, std::vector<vm::Value> args, size_t nRuns)
+{
+	const auto base = runProgram(name, p, args, nRuns, false);
+
+	const auto fused = runProgram(name + "Fused", comp::Compiler::fuseInstructions(p), args, nRuns, false);
+	CHECK(base.first == fused.first);
+	bench::report(name + "Fused.speedup", base.second / fused.second, "x");
+
+	const auto tiered = runProgram(name + "Tiered", p, args, nRuns, true);
+	CHECK(base.first == tiered.first);
+	bench::report(name + "Tiered.speedup", base.second / tiered.second, "x");
+}
+
+TEST_GROUP(BenchCorpus) {};
+
+TEST(BenchCorpus, LoopFactorial)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 1),         // r = 1;
+					/* 1 */ prog::Instruction::lit({}, 0),         // while(n != 0) {
+					/* 2 */ prog::Instruction::jNe(0, {}, 4),
+					/* 3 */ prog::Instruction::ret(0, 1),
+
+					/* 4 */ prog::Instruction::mulI(1, 1, 0),      //   r *= n;
+					/* 5 */ prog::Instruction::lit({}, 1),         //   n--;
+					/* 6 */ prog::Instruction::subI(0, 0, {}),
+					/* 7 */ prog::Instruction::jump(1),            // } return r;
+				}
+			}
+		}
+	};
+
+	runCorpus("loopFactorial", p, {12}, 10000);
+}
+
+TEST(BenchCorpus, RecursiveFactorial)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),         // if(n == 0) return 1;
+					/* 1 */ prog::Instruction::jEq(0, {}, 8),
+
+					/* 2 */ prog::Instruction::lit({}, 1),         // return n * fact(n - 1);
+					/* 3 */ prog::Instruction::subI({}, 0, {}),
+					/* 4 */ prog::Instruction::lit({}, 0),
+					/* 5 */ prog::Instruction::call(0, 1),
+					/* 6 */ prog::Instruction::mulI({}, 0, {}),
+					/* 7 */ prog::Instruction::ret(0, 1),
+
+					/* 8 */ prog::Instruction::lit({}, 1),
+					/* 9 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	runCorpus("recursiveFactorial", p, {12}, 10000);
+}
+
+TEST(BenchCorpus, ListConstruction)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 1, 1)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 3,
+				.nScalars = 3,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),        // s1 -> i
+					/*  1 */ prog::Instruction::make({}, 0),       // r0 -> head
+					/*  2 */ prog::Instruction::movr({}, 0),       // r1 -> tail
+
+					/*  3 */ prog::Instruction::jNe(0, 1, 6),      // if(i == n) return head;
+					/*  4 */ prog::Instruction::drop(1, 0),
+					/*  5 */ prog::Instruction::ret(1, 0),
+
+					/*  6 */ prog::Instruction::make({}, 1),       // r2 -> next
+					/*  7 */ prog::Instruction::puts(1, 2, 0),     // next->s0 = i;
+					/*  8 */ prog::Instruction::jNul(1, 11),       // if(tail != vm::null) {
+					/*  9 */ prog::Instruction::putr(2, 1, 0),     //   tail->r0 = next;
+					/* 10 */ prog::Instruction::jump(12),          // } else {
+					/* 11 */ prog::Instruction::movr(0, 2),        //   head = next; }
+					/* 12 */ prog::Instruction::movr(1, {}),       // tail = next;
+
+					/* 13 */ prog::Instruction::lit({}, 1),        // i++
+					/* 14 */ prog::Instruction::addI(1, 1, {}),
+					/* 15 */ prog::Instruction::jump(3),
+				}
+			}
+		}
+	};
+
+	runCorpus("listConstruction", p, {1000}, 100);
+}
+
+TEST(BenchCorpus, TreeChurn)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 2, 0)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 3,
+				.nScalars = 4,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),        // if(d == 0) return null;
+					/*  1 */ prog::Instruction::jNe(0, {}, 4),
+					/*  2 */ prog::Instruction::make({}, 0),
+					/*  3 */ prog::Instruction::ret(1, 0),
+
+					/*  4 */ prog::Instruction::make({}, 1),       // r0 -> node
+					/*  5 */ prog::Instruction::lit({}, 1),        // node->r0 = tree(d - 1);
+					/*  6 */ prog::Instruction::subI({}, 0, {}),
+					/*  7 */ prog::Instruction::lit({}, 0),
+					/*  8 */ prog::Instruction::call(0, 1),
+					/*  9 */ prog::Instruction::putr({}, 0, 0),
+
+					/* 10 */ prog::Instruction::lit({}, 1),        // node->r1 = tree(d - 1);
+					/* 11 */ prog::Instruction::subI({}, 0, {}),
+					/* 12 */ prog::Instruction::lit({}, 0),
+					/* 13 */ prog::Instruction::call(0, 1),
+					/* 14 */ prog::Instruction::putr({}, 0, 1),
+
+					/* 15 */ prog::Instruction::ret(1, 0),         // return node;
+				}
+			}
+		}
+	};
+
+	runCorpus("treeChurn", p, {12}, 50);
+}
+
+TEST(BenchCorpus, FloatArithmetic)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 6,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),        // s = 0.0f;
+					/*  1 */ prog::Instruction::lit({}, 0),        // while(n != 0) {
+					/*  2 */ prog::Instruction::jNe(0, {}, 4),
+					/*  3 */ prog::Instruction::ret(0, 1),
+
+					/*  4 */ prog::Instruction::i2f({}, 0),        //   f = (float)n;
+					/*  5 */ prog::Instruction::mulF({}, 2, 2),    //   g = f * f;
+					/*  6 */ prog::Instruction::lit({}, 1),        //   h = f + 1.0f;
+					/*  7 */ prog::Instruction::i2f({}, {}),
+					/*  8 */ prog::Instruction::addF(4, 4, 2),
+					/*  9 */ prog::Instruction::divF(3, 3, 4),     //   s += g / h;
+					/* 10 */ prog::Instruction::addF(1, 1, 3),
+					/* 11 */ prog::Instruction::drop(0, 3),
+
+					/* 12 */ prog::Instruction::lit({}, 1),        //   n--;
+					/* 13 */ prog::Instruction::subI(0, 0, {}),
+					/* 14 */ prog::Instruction::jump(1),           // } return s;
+				}
+			}
+		}
+	};
+
+	runCorpus("floatArithmetic", p, {1000}, 100);
+}
+
+TEST(BenchCorpus, Fibonacci)
+{
+	prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 5,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 2),        // if(n < 2) return n;
+					/*  1 */ prog::Instruction::jLtI(0, {}, 12),
+
+					/*  2 */ prog::Instruction::lit({}, 1),        // return fib(n - 1) + fib(n - 2);
+					/*  3 */ prog::Instruction::subI({}, 0, {}),
+					/*  4 */ prog::Instruction::lit({}, 0),
+					/*  5 */ prog::Instruction::call(0, 1),
+					/*  6 */ prog::Instruction::lit({}, 2),
+					/*  7 */ prog::Instruction::subI({}, 0, {}),
+					/*  8 */ prog::Instruction::lit({}, 0),
+					/*  9 */ prog::Instruction::call(0, 1),
+					/* 10 */ prog::Instruction::addI({}, {}, {}),
+					/* 11 */ prog::Instruction::ret(0, 1),
+
+					/* 12 */ prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	runCorpus("fibonacci", p, {20}, 10);
+}
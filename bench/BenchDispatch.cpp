@@ -0,0 +1,90 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+static constexpr auto nCalls = 10000;
+static constexpr auto nRuns = 100;
+
+TEST_GROUP(BenchDispatch)
+{
+	vm::Storage storage;
+
+	/*
+	 * Calls a getter on the receiver n times, bound statically or dispatched on its type.
+	 */
+	static inline prog::Program program(prog::Instruction call)
+	{
+		return {
+			.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 0, 1), prog::TypeInfo(1, 0, 1)},
+			.functions =
+			{
+				prog::Function
+				{
+					.nRefs = 2,
+					.nScalars = 5,
+					.code = {
+						/* 0 */ prog::Instruction::lit({}, 0),        // s1 -> acc
+						/* 1 */ prog::Instruction::lit({}, 0),        // for(i = 0; i < n; i++)
+						/* 2 */ prog::Instruction::jLtI(2, 0, 5),
+						/* 3 */ prog::Instruction::mov({}, 1),
+						/* 4 */ prog::Instruction::ret(0, 1),
+
+						/* 5 */ prog::Instruction::movr({}, 0),       //   acc += o.get();
+						/* 6 */ call,
+						/* 7 */ prog::Instruction::addI(1, 1, {}),
+						/* 8 */ prog::Instruction::addIL(2, 2, 1),
+						/* 9 */ prog::Instruction::jump(2),
+					}
+				},
+				prog::Function
+				{
+					.nRefs = 1,
+					.nScalars = 3,
+					.code = {
+						/* 0 */ prog::Instruction::gets({}, 0, 0),
+						/* 1 */ prog::Instruction::ret(0, 1),
+					}
+				}
+			},
+			.methods = {{}, {1}, {1}}
+		};
+	}
+
+	double timeCalls(const prog::Program& p, bool tiered)
+	{
+		vm::Vm machine(storage, p);
+
+		if(tiered)
+		{
+			machine.enableClosureTier();
+		}
+
+		const auto receiver = storage.create(p.types[2], 2);
+		storage.writes(receiver, 0, 1);
+
+		return bench::measure(nCalls * nRuns, [&]()
+		{
+			for(int i = 0; i < nRuns; i++)
+			{
+				CHECK(nCalls == machine.run({receiver}, {nCalls}).second.front().integer);
+				machine.gc({receiver});
+			}
+		});
+	}
+};
+
+TEST(BenchDispatch, VirtualVsStaticCall)
+{
+	for(const auto tiered: {false, true})
+	{
+		const std::string suffix = tiered ? "Tiered" : "";
+		const auto direct = timeCalls(program(prog::Instruction::callL(1, 1, 0)), tiered);
+		const auto dispatched = timeCalls(program(prog::Instruction::vcall(0, 1, 0)), tiered);
+
+		bench::report("staticCall" + suffix, direct, "ns/call");
+		bench::report("virtualCall" + suffix, dispatched, "ns/call");
+		bench::report("virtualCall" + suffix + ".relative", dispatched / direct, "x");
+	}
+}
@@ -0,0 +1,142 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+static constexpr auto nIterations = 100000;
+static constexpr auto nThrows = 1000;
+static constexpr auto nRuns = 10;
+
+TEST_GROUP(BenchExceptions)
+{
+	vm::Storage storage;
+
+	/*
+	 * Counts up to n, the body of the loop is guarded by a handler if requested.
+	 */
+	static inline prog::Program loop(bool guarded)
+	{
+		prog::Function f
+		{
+			.nRefs = 1,
+			.nScalars = 4,
+			.code = {
+				/* 0 */ prog::Instruction::lit({}, 0),        // for(i = 0; i < n; i++)
+				/* 1 */ prog::Instruction::jLtI(1, 0, 4),
+				/* 2 */ prog::Instruction::mov({}, 1),
+				/* 3 */ prog::Instruction::ret(0, 1),
+				/* 4 */ prog::Instruction::addIL(1, 1, 1),    //   try { i++; } catch(...) { return -1; }
+				/* 5 */ prog::Instruction::jump(1),
+				/* 6 */ prog::Instruction::lit({}, -1),
+				/* 7 */ prog::Instruction::ret(0, 1),
+			}
+		};
+
+		if(guarded)
+		{
+			f.handlers = {{4, 5, 6, 0, 2}};
+		}
+
+		return {.types = {prog::TypeInfo::empty}, .functions = {f}};
+	}
+
+	/*
+	 * Raises n times from a call nested to the given depth, catching at the outermost frame.
+	 */
+	static inline prog::Program unwind()
+	{
+		return {
+			.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 0, 0)},
+			.functions =
+			{
+				prog::Function
+				{
+					.nRefs = 1,
+					.nScalars = 4,
+					.code = {
+						/* 0 */ prog::Instruction::lit({}, 0),    // for(i = 0; i < n; i++)
+						/* 1 */ prog::Instruction::jLtI(2, 0, 4),
+						/* 2 */ prog::Instruction::mov({}, 2),
+						/* 3 */ prog::Instruction::ret(0, 1),
+						/* 4 */ prog::Instruction::mov({}, 1),    //   try { f(depth); } catch(...) {}
+						/* 5 */ prog::Instruction::callL(1, 0, 1),
+						/* 6 */ prog::Instruction::drop(1, 0),    //   handler
+						/* 7 */ prog::Instruction::addIL(2, 2, 1),
+						/* 8 */ prog::Instruction::jump(1),
+					},
+					.handlers = {{5, 6, 6, 0, 3}}
+				},
+				prog::Function
+				{
+					.nRefs = 1,
+					.nScalars = 3,
+					.code = {
+						/* 0 */ prog::Instruction::lit({}, 0),
+						/* 1 */ prog::Instruction::jNe(0, {}, 4),
+						/* 2 */ prog::Instruction::make({}, 1),
+						/* 3 */ prog::Instruction::raise(),
+						/* 4 */ prog::Instruction::lit({}, 1),
+						/* 5 */ prog::Instruction::subI({}, 0, {}),
+						/* 6 */ prog::Instruction::callL(1, 0, 1),
+						/* 7 */ prog::Instruction::ret(0, 1),
+					}
+				}
+			}
+		};
+	}
+
+	double timeLoop(bool guarded, bool tiered)
+	{
+		const auto p = loop(guarded);
+		vm::Vm machine(storage, p);
+
+		if(tiered)
+		{
+			machine.enableClosureTier();
+		}
+
+		return bench::measure(nIterations * nRuns, [&]()
+		{
+			for(int i = 0; i < nRuns; i++)
+			{
+				CHECK(nIterations == machine.run({}, {nIterations}).second.front().integer);
+				machine.gc({});
+			}
+		});
+	}
+};
+
+TEST(BenchExceptions, NormalPath)
+{
+	for(const auto tiered: {false, true})
+	{
+		const std::string suffix = tiered ? "Tiered" : "";
+		const auto plain = timeLoop(false, tiered);
+		const auto guarded = timeLoop(true, tiered);
+
+		bench::report("unguardedLoop" + suffix, plain, "ns/iteration");
+		bench::report("guardedLoop" + suffix, guarded, "ns/iteration");
+		bench::report("guardedLoop" + suffix + ".relative", guarded / plain, "x");
+	}
+}
+
+TEST(BenchExceptions, ThrowToCatch)
+{
+	const auto p = unwind();
+	vm::Vm machine(storage, p);
+
+	for(const auto depth: {0, 4, 16})
+	{
+		const auto t = bench::measure(nThrows * nRuns, [&]()
+		{
+			for(int i = 0; i < nRuns; i++)
+			{
+				CHECK(nThrows == machine.run({}, {depth, nThrows}).second.front().integer);
+				machine.gc({});
+			}
+		});
+
+		bench::report("throwToCatch.depth" + std::to_string(depth), t, "ns/throw");
+	}
+}
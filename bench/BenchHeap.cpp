@@ -0,0 +1,279 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+#include <thread>
+#include <functional>
+
+static constexpr auto nObjects = 100000;
+
+TEST_GROUP(BenchHeap)
+{
+	vm::Storage storage;
+
+	/*
+	 * Binary tree with the leaves also linked into a list, so that not every object is dominated
+	 * by the one it was reached from.
+	 */
+	vm::Reference build()
+	{
+		const prog::TypeInfo node(0, 3, 1);
+		std::vector<vm::Reference> nodes;
+
+		for(int i = 0; i < nObjects; i++)
+		{
+			const auto n = storage.create(node, 1);
+			storage.writes(n, 0, i);
+			nodes.push_back(n);
+
+			if(i)
+			{
+				storage.writer(nodes[(i - 1) / 2], (i - 1) % 2, n);
+			}
+		}
+
+		for(int i = nObjects / 2; i + 1 < nObjects; i++)
+		{
+			storage.writer(nodes[i], 2, nodes[i + 1]);
+		}
+
+		return nodes.front();
+	}
+};
+
+TEST(BenchHeap, SnapshotVsCollection)
+{
+	const auto root = build();
+
+	const auto collect = bench::measure(nObjects, [&](){ CHECK(0 == storage.gc(root)); });
+	bench::report("collection", collect, "ns/object");
+
+	vm::HeapSnapshot s;
+	const auto copy = bench::measure(nObjects, [&](){ s = storage.snapshot({root}); });
+	bench::report("snapshot", copy, "ns/object");
+	bench::report("snapshot.relative", copy / collect, "x");
+
+	const auto analysis = bench::measure(nObjects, [&](){ s.analyze(); });
+	bench::report("snapshot.analysis", analysis, "ns/object");
+
+	CHECK(s.getObjects().size() == nObjects);
+	CHECK(s.getObjects().front().retained == s.getTotalSize());
+}
+
+/*
+ * Allocating an object and a frame per iteration, without profiling and with sampling rates.
+ */
+TEST(BenchHeap, AllocationProfiler)
+{
+	static constexpr auto n = 100000;
+
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 0, 1)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jLtI(1, 0, 4),
+					/* 2 */ prog::Instruction::mov({}, 1),
+					/* 3 */ prog::Instruction::ret(0, 1),
+					/* 4 */ prog::Instruction::make({}, 1),
+					/* 5 */ prog::Instruction::callL(1, 1, 0),
+					/* 6 */ prog::Instruction::addIL(1, 1, 1),
+					/* 7 */ prog::Instruction::jump(1),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 1,
+				.code = {
+					/* 0 */ prog::Instruction::ret(0, 0),
+				}
+			}
+		}
+	};
+
+	const auto time = [&](vm::AllocationProfiler* profiler)
+	{
+		vm::Vm machine(storage, p);
+		storage.setAllocationProfiler(profiler);
+
+		const auto ret = bench::measure(n, [&]()
+		{
+			CHECK(n == machine.run({}, {n}).second.front().integer);
+			machine.gc({});
+		});
+
+		storage.setAllocationProfiler(nullptr);
+		return ret;
+	};
+
+	const auto off = time(nullptr);
+	bench::report("allocationLoop", off, "ns/iteration");
+
+	// Densest last, recording every allocation leaves the heap fragmented for the following runs.
+	for(const auto interval: {1024u, 64u, 1u})
+	{
+		vm::AllocationProfiler profiler(interval);
+		const auto t = time(&profiler);
+		bench::report("allocationLoop.sampled" + std::to_string(interval) + ".relative", t / off, "x");
+	}
+}
+
+/*
+ * Collections of a heap where every object survives, by the number of marker threads, on a wide
+ * tree (where the markers can share the work) and on a long list (where they can not). The sweep
+ * is done by a single thread either way.
+ */
+TEST(BenchHeap, ParallelMarking)
+{
+	static constexpr auto width = 512;
+
+	const auto wideTree = [&]()
+	{
+		const auto root = storage.createArray(width, 0);
+
+		for(int i = 0; i < width; i++)
+		{
+			const auto inner = storage.createArray(width, 0);
+			storage.writer(root, i, inner);
+
+			for(int j = 0; j < width; j++)
+			{
+				storage.writer(inner, j, storage.createArray(0, 1));
+			}
+		}
+
+		return root;
+	};
+
+	const auto longList = [&]()
+	{
+		auto head = vm::null;
+
+		for(int i = 0; i < width * width; i++)
+		{
+			const auto n = storage.createArray(1, 0);
+			storage.writer(n, 0, head);
+			head = n;
+		}
+
+		return head;
+	};
+
+	const auto maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+	for(const auto &[name, build]: {std::make_pair("wideTree", std::function<vm::Reference()>(wideTree)), std::make_pair("longList", std::function<vm::Reference()>(longList))})
+	{
+		const auto root = build();
+		const auto nObjects = storage.getObjectCount();
+		double single = 0;
+
+		for(auto n = 1u; n <= maxThreads; n *= 2)
+		{
+			storage.setMarkerCount(n);
+			const auto t = bench::measure(nObjects, [&](){ CHECK(0 == storage.gc(root)); });
+			single = (n == 1) ? t : single;
+
+			bench::report(std::string(name) + ".markers" + std::to_string(n), t, "ns/object");
+			bench::report(std::string(name) + ".markers" + std::to_string(n) + ".speedup", single / t, "x");
+		}
+
+		storage.setMarkerCount(1);
+		storage.gc(std::vector<vm::Reference>{});
+	}
+}
+
+/*
+ * Pauses of the mutator and its throughput, allocating garbage in runs while a large live heap is
+ * collected periodically, with stop-the-world collections and with background ones (paused for
+ * starting, which also waits for the sweep of the previous one, and for the remark).
+ */
+TEST(BenchHeap, BackgroundCollection)
+{
+	static constexpr auto nRuns = 400;
+	static constexpr auto nIterations = 1000;
+	static constexpr auto collectionInterval = 20;
+
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty, prog::TypeInfo(0, 0, 1)},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 3,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),
+					/* 1 */ prog::Instruction::jLtI(1, 0, 4),
+					/* 2 */ prog::Instruction::mov({}, 1),
+					/* 3 */ prog::Instruction::ret(0, 1),
+					/* 4 */ prog::Instruction::make({}, 1),
+					/* 5 */ prog::Instruction::callL(1, 1, 0),
+					/* 6 */ prog::Instruction::addIL(1, 1, 1),
+					/* 7 */ prog::Instruction::jump(1),
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 2,
+				.nScalars = 1,
+				.code = {
+					/* 0 */ prog::Instruction::ret(0, 0),
+				}
+			}
+		}
+	};
+
+	const auto root = build();
+
+	for(const auto background: {false, true})
+	{
+		vm::Vm machine(storage, p);
+		std::vector<double> pauses;
+
+		const auto pause = [&](auto&& c){ pauses.push_back(bench::time(c) / 1e6); };
+
+		const auto t = bench::time([&]()
+		{
+			for(int i = 0; i < nRuns; i++)
+			{
+				CHECK(nIterations == machine.run({}, {nIterations}).second.front().integer);
+
+				if(i % collectionInterval == collectionInterval - 1)
+				{
+					if(!background)
+					{
+						pause([&](){ machine.gc({root}); });
+					}
+					else
+					{
+						if(i != collectionInterval - 1)
+						{
+							pause([&](){ machine.finishCollection({root}); });
+						}
+
+						pause([&](){ machine.startCollection({root}); });
+					}
+				}
+			}
+
+			if(background)
+			{
+				pause([&](){ machine.finishCollection({root}); storage.waitForCollection(); });
+			}
+		});
+
+		const auto name = std::string(background ? "background" : "stopTheWorld");
+		bench::report(name + ".pause", pauses, "ms");
+		bench::report(name + ".throughput", (double)nRuns * nIterations / (t / 1e6), "iterations/ms");
+
+		storage.gc(std::vector<vm::Reference>{root});
+	}
+}
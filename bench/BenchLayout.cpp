@@ -0,0 +1,50 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Storage.h"
+
+static constexpr auto nObjects = 10000;
+
+TEST_GROUP(BenchLayout)
+{
+	/*
+	 * Heap usage per object, including the bookkeeping of the storage.
+	 */
+	static inline double measureObject(const prog::TypeInfo& type)
+	{
+		vm::Storage storage;
+		const auto before = bench::Memory::current();
+
+		for(int i = 0; i < nObjects; i++)
+		{
+			storage.create(type);
+		}
+
+		return (double)(bench::Memory::current() - before) / nObjects;
+	}
+
+	static inline void compare(const std::string& name, const prog::TypeInfo& wide, const prog::TypeInfo& packed)
+	{
+		const auto w = measureObject(wide), p = measureObject(packed);
+
+		bench::report(name + ".wide", w, "bytes/object");
+		bench::report(name + ".packed", p, "bytes/object");
+		bench::report(name + ".saved", w - p, "bytes/object");
+	}
+};
+
+TEST(BenchLayout, TypicalClasses)
+{
+	// Two integers.
+	compare("point", prog::TypeInfo(0, 0, 2), prog::TypeInfo(0, 0, 0, 8));
+
+	// Next pointer, integer key and a deleted flag.
+	compare("listNode", prog::TypeInfo(0, 1, 2), prog::TypeInfo(0, 1, 0, 5));
+
+	// Four 8 bit channels.
+	compare("pixel", prog::TypeInfo(0, 0, 4), prog::TypeInfo(0, 0, 0, 4));
+
+	// Integer id, 16 bit year, 8 bit month and day, active flag and a float score.
+	compare("record", prog::TypeInfo(0, 0, 6), prog::TypeInfo(0, 0, 0, 13));
+}
@@ -0,0 +1,88 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Vm.h"
+
+static constexpr auto nCalls = 1000000;
+
+TEST_GROUP(BenchNative)
+{
+	vm::Storage storage;
+};
+
+TEST(BenchNative, NativeVsBytecodeCall)
+{
+	prog::Program native = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 4,
+				.code = {
+					/* 0 */ prog::Instruction::lit({}, 0),      // s1 -> acc
+
+					/* 1 */ prog::Instruction::lit({}, 0),      // while(n != 0) {
+					/* 2 */ prog::Instruction::jNe(0, {}, 4),
+					/* 3 */ prog::Instruction::ret(0, 1),
+
+					/* 4 */ prog::Instruction::mov({}, 1),      //   acc = inc(acc);
+					/* 5 */ prog::Instruction::ncall(0),
+					/* 6 */ prog::Instruction::mov(1, {}),
+
+					/* 7 */ prog::Instruction::lit({}, 1),      //   n--;
+					/* 8 */ prog::Instruction::subI(0, 0, {}),
+					/* 9 */ prog::Instruction::jump(1),         // }
+				}
+			}
+		}
+	};
+
+	prog::Program bytecode = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 4,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),     // s1 -> acc
+
+					/*  1 */ prog::Instruction::lit({}, 0),     // while(n != 0) {
+					/*  2 */ prog::Instruction::jNe(0, {}, 4),
+					/*  3 */ prog::Instruction::ret(0, 1),
+
+					/*  4 */ prog::Instruction::mov({}, 1),     //   acc = inc(acc);
+					/*  5 */ prog::Instruction::lit({}, 1),
+					/*  6 */ prog::Instruction::call(0, 1),
+					/*  7 */ prog::Instruction::mov(1, {}),
+
+					/*  8 */ prog::Instruction::lit({}, 1),     //   n--;
+					/*  9 */ prog::Instruction::subI(0, 0, {}),
+					/* 10 */ prog::Instruction::jump(1),        // }
+				}
+			},
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 2,
+				.code = {
+					prog::Instruction::lit({}, 1),
+					prog::Instruction::addI({}, 0, {}),
+					prog::Instruction::ret(0, 1),
+				}
+			}
+		}
+	};
+
+	vm::Vm nvm(storage, native);
+	nvm.addNative({[](vm::NativeFrame& f){ f.scalars[0] = f.scalars[0].integer + 1; }, 0, 1, 0, 1});
+
+	vm::Vm bvm(storage, bytecode);
+
+	bench::report("native call", bench::measure(nCalls, [&](){ CHECK(nCalls == nvm.run({}, {nCalls}).second.front().integer); }), "ns/call");
+	bench::report("bytecode call", bench::measure(nCalls, [&](){ CHECK(nCalls == bvm.run({}, {nCalls}).second.front().integer); }), "ns/call");
+}
@@ -0,0 +1,78 @@
+#include "1test/Test.h"
+
+#include "Benchmark.h"
+
+#include "vm/Runtime.h"
+
+#include <thread>
+
+static constexpr auto nInstances = 1000;
+static constexpr auto nSlices = 10;
+static constexpr auto nIterations = 1000;
+
+TEST_GROUP(BenchRuntime)
+{
+	const prog::Program p = {
+		.types = {prog::TypeInfo::empty},
+		.functions =
+		{
+			prog::Function
+			{
+				.nRefs = 0,
+				.nScalars = 6,
+				.code = {
+					/*  0 */ prog::Instruction::lit({}, 0),     // x = 0;
+					/*  1 */ prog::Instruction::lit({}, 0),     // i = 0;
+					/*  2 */ prog::Instruction::lit({}, 0),     // while(n != 0) {
+					/*  3 */ prog::Instruction::jNe(0, {}, 6),
+					/*  4 */ prog::Instruction::mov({}, 1),
+					/*  5 */ prog::Instruction::ret(0, 1),
+
+					/*  6 */ prog::Instruction::lit({}, nIterations),
+					/*  7 */ prog::Instruction::mov(2, {}),     //   for(i = nIterations; i != 0; i--) {
+					/*  8 */ prog::Instruction::lit({}, 0),
+					/*  9 */ prog::Instruction::jEq(2, {}, 15),
+					/* 10 */ prog::Instruction::mulI(1, 1, 2),  //     x = x * i + n;
+					/* 11 */ prog::Instruction::addI(1, 1, 0),
+					/* 12 */ prog::Instruction::lit({}, 1),
+					/* 13 */ prog::Instruction::subI(2, 2, {}),
+					/* 14 */ prog::Instruction::jump(8),        //   }
+
+					/* 15 */ prog::Instruction::yield(),        //   yield;
+
+					/* 16 */ prog::Instruction::lit({}, 1),     //   n--;
+					/* 17 */ prog::Instruction::subI(0, 0, {}),
+					/* 18 */ prog::Instruction::jump(2),        // } return x;
+				}
+			}
+		}
+	};
+};
+
+TEST(BenchRuntime, Scaling)
+{
+	double single = 0;
+
+	for(auto nThreads = 1u; nThreads <= std::max(1u, std::thread::hardware_concurrency()); nThreads *= 2)
+	{
+		const auto t = bench::measure(nInstances, [&]()
+		{
+			vm::Runtime uut(p, nThreads);
+
+			for(int i = 0; i < nInstances; i++)
+			{
+				uut.add().scheduler.spawn(0, {}, {nSlices});
+			}
+
+			CHECK(nInstances * (nSlices + 1) == uut.run());
+		});
+
+		if(nThreads == 1)
+		{
+			single = t;
+		}
+
+		bench::report("instances (" + std::to_string(nThreads) + " threads)", 1e9 / t, "instance/s");
+		bench::report("speedup (" + std::to_string(nThreads) + " threads)", single / t, "x");
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef BENCH_BENCHMARK_H_
+#define BENCH_BENCHMARK_H_
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace bench {
+
+/*
+ * Runs the payload once, returns the elapsed time in nanoseconds.
+ */
+template<class C>
+inline double time(C&& c)
+{
+	const auto start = std::chrono::steady_clock::now();
+	c();
+	const auto end = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/*
+ * Runs the payload once for warm-up then once more measured, returns the average
+ * time per item in nanoseconds.
+ */
+template<class C>
+inline double measure(size_t nItems, C&& c)
+{
+	c();
+	return time(c) / nItems;
+}
+
+/*
+ * Heap usage of the process (provided by the global allocator replacement in Memory.cpp).
+ */
+struct Memory
+{
+	static size_t current();
+	static size_t peak();
+	static void resetPeak();
+};
+
+/*
+ * Results are printed as one JSON object per line, to be picked up by scripts tracking them across commits.
+ */
+inline void report(const std::string& name, double value, const char* unit) {
+	std::cout << "{\"name\": \"" << name << "\", \"value\": " << value << ", \"unit\": \"" << unit << "\"}" << std::endl;
+}
+
+inline void report(const std::string& name, std::vector<double> samples, const char* unit)
+{
+	if(samples.empty())
+	{
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	const auto percentile = [&](double p){ return samples[(size_t)(p * (samples.size() - 1))]; };
+
+	report(name + ".min", samples.front(), unit);
+	report(name + ".p50", percentile(0.5), unit);
+	report(name + ".p90", percentile(0.9), unit);
+	report(name + ".p99", percentile(0.99), unit);
+	report(name + ".max", samples.back(), unit);
+}
+
+} // namespace bench
+
+#endif /* BENCH_BENCHMARK_H_ */
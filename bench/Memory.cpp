@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+/*
+ * Global allocation tracking, each block is prefixed with its size.
+ */
+static constexpr size_t headerSize = alignof(std::max_align_t);
+
+static std::atomic<size_t> current = 0, peak = 0;
+
+void* operator new(size_t size)
+{
+	auto p = (char*)malloc(size + headerSize);
+
+	if(!p)
+	{
+		throw std::bad_alloc();
+	}
+
+	*(size_t*)p = size;
+
+	const auto now = current += size;
+	for(auto old = peak.load(); old < now && !peak.compare_exchange_weak(old, now);) {}
+
+	return p + headerSize;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if(ptr)
+	{
+		auto p = (char*)ptr - headerSize;
+		current -= *(size_t*)p;
+		free(p);
+	}
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+size_t bench::Memory::current() {
+	return ::current;
+}
+
+size_t bench::Memory::peak() {
+	return ::peak;
+}
+
+void bench::Memory::resetPeak() {
+	::peak = ::current.load();
+}
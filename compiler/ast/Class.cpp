@@ -2,10 +2,61 @@
 
 #include "ProgramObjectSet.h"
 
+#include "assert.h"
+
 #include <sstream>
+#include <numeric>
+#include <algorithm>
 
 using namespace comp::ast;
 
+Class::Layout Class::getLayout(bool packed) const
+{
+	Layout ret = base ? base->getLayout(packed) : Layout{};
+	ret.fields.assign(fieldTypes.size(), {});
+
+	std::vector<size_t> order(fieldTypes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](auto a, auto b){ return fieldTypes[a].getPackedWidth() > fieldTypes[b].getPackedWidth(); });
+
+	for(const auto i: order)
+	{
+		const auto &t = fieldTypes[i];
+
+		if(t.kind == TypeKind::Reference)
+		{
+			ret.fields[i] = {Layout::Area::References, (uint32_t)ret.nReferences++, 0};
+		}
+		else if(const auto w = t.getPackedWidth(); packed && w)
+		{
+			ret.nBytes = (ret.nBytes + w - 1) / w * w;
+			ret.fields[i] = {Layout::Area::Bytes, (uint32_t)ret.nBytes, (uint32_t)w};
+			ret.nBytes += w;
+		}
+		else
+		{
+			ret.fields[i] = {Layout::Area::Scalars, (uint32_t)ret.nScalars++, 0};
+		}
+	}
+
+	return ret;
+}
+
+size_t Class::getMethodCount() const {
+	return std::max(methods.size(), base ? base->getMethodCount() : 0);
+}
+
+std::shared_ptr<Function> Class::getMethod(size_t slot) const
+{
+	if(slot < methods.size() && methods[slot])
+	{
+		return methods[slot];
+	}
+
+	assert(base);
+	return base->getMethod(slot);
+}
+
 std::string Class::getReferenceForDump(const ProgramObjectSet& gi) const {
 	return std::string("c") + std::to_string(gi.getClassIndex(this));
 }
@@ -10,15 +10,42 @@ namespace comp {
 namespace ast {
 
 class ProgramObjectSet;
+struct Function;
 
 struct Class: std::enable_shared_from_this<Class>
 {
+	/*
+	 * Placement of the fields in the objects, the inherited ones come first. Scalars that fit
+	 * are packed into the byte area by decreasing width, so each is naturally aligned.
+	 */
+	struct Layout
+	{
+		enum class Area { References, Scalars, Bytes };
+
+		struct Slot
+		{
+			Area area;
+			uint32_t offset, width;
+		};
+
+		std::vector<Slot> fields; // Own fields of the class, by index
+		size_t nReferences = 0, nScalars = 0, nBytes = 0;
+	};
+
+
 	const std::shared_ptr<Class> base;
 	std::vector<ValueType> fieldTypes;
 	std::vector<ValueType> staticTypes;
 
+	// Virtual methods by slot, null entries are inherited from the base class.
+	std::vector<std::shared_ptr<Function>> methods;
+
 	inline Class(std::shared_ptr<Class> base): base(base) {};
 
+	Layout getLayout(bool packed = true) const;
+	size_t getMethodCount() const;
+	std::shared_ptr<Function> getMethod(size_t slot) const;
+
 	std::string dump(const ProgramObjectSet& gi) const;
 	std::string getReferenceForDump(const ProgramObjectSet& gi) const;
 };
@@ -29,6 +29,10 @@ struct Field
 struct StaticField: Field {
 	using Field::Field;
 
+	inline auto getType() const {
+		return type->staticTypes[index];
+	}
+
 	std::string getReferenceForDump(const ProgramObjectSet& gi) const;
 };
 
@@ -86,6 +86,18 @@ static inline std::string dumpExpressionAst(const ProgramObjectSet& gi, std::map
 		{
 			ret = v.type ? "new " + v.type->getReferenceForDump(gi) : "nullptr";
 		},
+		[&](const CreateArray& v)
+		{
+			ret = "new " + v.elementType.getReferenceForDump(gi) + "[" + dumpExpressionAst(gi, locals, v.length, OpPrecedence::Root) + "]";
+		},
+		[&](const Length& v)
+		{
+			ret = dumpExpressionAst(gi, locals, v.array, OpPrecedence::CastCallMember) + ".length";
+		},
+		[&](const Element& v)
+		{
+			ret = dumpExpressionAst(gi, locals, v.array, OpPrecedence::CastCallMember) + "[" + dumpExpressionAst(gi, locals, v.index, OpPrecedence::Root) + "]";
+		},
 		[&](const Global& v)
 		{
 			ret = v.field.getReferenceForDump(gi);;
@@ -106,6 +118,8 @@ static inline std::string dumpExpressionAst(const ProgramObjectSet& gi, std::map
 			case PrimitiveType::Native:
 				ret = "<native>";
 				break;
+			default:
+				assert(false); // Narrow types only appear as fields
 			}
 		},
 		[&](const Ternary& v)
@@ -189,6 +203,21 @@ static inline void dumpStatementAst(const ProgramObjectSet& gi, std::map<const L
 		{
 			ss << std::string(nIndentSpaces * indent, ' ') << "while(true)" << std::endl;
 			dumpStatementAst(gi, locals, ss, v.body, indent);
+		},
+		[&](const Throw& v)
+		{
+			ss << std::string(nIndentSpaces * indent, ' ') << "throw "
+				<< dumpExpressionAst(gi, locals, v.value, OpPrecedence::Root) << ";" << std::endl;
+		},
+		[&](const Try& v)
+		{
+			ss << std::string(nIndentSpaces * indent, ' ') << "try" << std::endl;
+			dumpStatementAst(gi, locals, ss, v.body, indent);
+
+			locals.insert({v.exception.get(), locals.size()});
+			ss << std::string(nIndentSpaces * indent, ' ') << "catch(" << v.exception->type.getReferenceForDump(gi)
+				<< " l" << locals[v.exception.get()] << ")" << std::endl;
+			dumpStatementAst(gi, locals, ss, v.handler, indent);
 		}
 	});
 }
@@ -6,9 +6,9 @@
 
 #include "Overloaded.h"
 
-#include <set>
-#include <list>
+#include <deque>
 #include <vector>
+#include <unordered_set>
 #include <algorithm>
 
 using namespace comp;
@@ -19,9 +19,13 @@ struct ElementReferences
 	std::vector<std::shared_ptr<Function>> functions;
 	std::vector<std::shared_ptr<Class>> classes;
 
+	// Same elements as above, for constant time duplicate checks.
+	std::unordered_set<const Function*> functionSet;
+	std::unordered_set<const Class*> classSet;
+
 	inline void addFunction(std::shared_ptr<Function> fn)
 	{
-		if(std::find(functions.begin(), functions.end(), fn) == functions.end())
+		if(functionSet.insert(fn.get()).second)
 		{
 			functions.push_back(fn);
 		}
@@ -29,9 +33,16 @@ struct ElementReferences
 
 	inline void addClass(std::shared_ptr<Class> c)
 	{
-		if(std::find(classes.begin(), classes.end(), c) == classes.end())
+		if(classSet.insert(c.get()).second)
 		{
 			classes.push_back(c);
+
+			if(c->base)
+			{
+				addClass(c->base);
+			}
+
+			std::for_each(c->methods.begin(), c->methods.end(), [&](const auto& m){ if(m) addFunction(m); });
 		}
 	}
 
@@ -69,6 +80,19 @@ static inline void walkExpressionTree(const RValue& val, C&& c)
 			c(v);
 			walkExpressionTree(*v.object, c);
 		},
+		[&](const CreateArray& v)
+		{
+			walkExpressionTree(*v.length, c);
+		},
+		[&](const Length& v)
+		{
+			walkExpressionTree(*v.array, c);
+		},
+		[&](const Element& v)
+		{
+			walkExpressionTree(*v.array, c);
+			walkExpressionTree(*v.index, c);
+		},
 		[&](const Set& v)
 		{
 			walkExpressionTree(*v.target, c);
@@ -104,34 +128,39 @@ static inline void walkBlockTree(const Statement& stmt, C&& c)
 		[&](const Return& v) { std::for_each(v.value.begin(), v.value.end(), [&](const auto &w){walkExpressionTree(*w, c); }); },
 		[&](const Continue& v) {},
 		[&](const Break& v) {},
+		[&](const Throw& v) { walkExpressionTree(*v.value, c); },
+		[&](const Try& v)
+		{
+			walkBlockTree(*v.body, c);
+			walkBlockTree(*v.handler, c);
+		},
 	});
 }
 
 static inline auto gatherReferences(std::shared_ptr<Function> entryPoint)
 {
 	std::vector<std::pair<std::shared_ptr<Function>, ElementReferences>> ret;
-	std::list<std::shared_ptr<Function>> toDo;
-	std::set<std::shared_ptr<Function>> done;
-
-	toDo.push_back(entryPoint);
+	std::deque<std::shared_ptr<Function>> toDo{entryPoint};
+	std::unordered_set<const Function*> queued{entryPoint.get()};
 
+	// Functions are queued only once, when first seen.
 	while(!toDo.empty())
 	{
 		auto current = toDo.front();
 		toDo.pop_front();
-		done.insert(current);
 
 		ElementReferences refs;
 		walkBlockTree(*current->body, refs);
-		ret.push_back(std::make_pair(current, refs));
 
-		for(auto r: refs.functions)
+		for(const auto& r: refs.functions)
 		{
-			if(done.find(r) == done.end())
+			if(queued.insert(r.get()).second)
 			{
 				toDo.push_back(r);
 			}
 		}
+
+		ret.emplace_back(current, std::move(refs));
 	}
 
 	return ret;
@@ -176,19 +205,39 @@ ProgramObjectSet ProgramObjectSet::shakeTree(std::shared_ptr<Function> entryPoin
 	ret.classes.push_back(gatherStaticFields(allRefs.classes));
 	std::copy(allRefs.classes.begin(), allRefs.classes.end(), std::back_inserter(ret.classes));
 
+	ret.index();
 	return ret;
 }
 
+void ProgramObjectSet::index()
+{
+	functionIndices.clear();
+	functionIndices.reserve(functions.size());
+
+	for(auto i = 0u; i < functions.size(); i++)
+	{
+		functionIndices.emplace(functions[i].get(), i);
+	}
+
+	classIndices.clear();
+	classIndices.reserve(classes.size());
+
+	for(auto i = 0u; i < classes.size(); i++)
+	{
+		classIndices.emplace(classes[i].get(), i);
+	}
+}
+
 size_t ProgramObjectSet::getClassIndex(const Class* cl) const
 {
-	auto it = std::find_if(classes.begin(), classes.end(), [cl](const auto v){return cl == v.get();});
-	assert(it != classes.end());
-	return it - classes.begin();
+	auto it = classIndices.find(cl);
+	assert(it != classIndices.end());
+	return it->second;
 }
 
 size_t ProgramObjectSet::getFunctionIndex(const Function* fn) const
 {
-	auto it = std::find_if(functions.begin(), functions.end(), [fn](const auto v){return fn == v.get();});
-	assert(it != functions.end());
-	return it - functions.begin();
+	auto it = functionIndices.find(fn);
+	assert(it != functionIndices.end());
+	return it->second;
 }
@@ -5,6 +5,7 @@
 #include "compiler/ast/Function.h"
 
 #include <vector>
+#include <unordered_map>
 
 namespace comp {
 namespace ast {
@@ -14,8 +15,14 @@ struct ProgramObjectSet
 	std::vector<std::shared_ptr<Function>> functions;
 	std::vector<std::shared_ptr<Class>> classes;
 
+	// Positions of the elements in the above, must be rebuilt (by index) when those change.
+	std::unordered_map<const Function*, size_t> functionIndices;
+	std::unordered_map<const Class*, size_t> classIndices;
+
 	static ProgramObjectSet shakeTree(std::shared_ptr<Function> entryPoint);
 
+	void index();
+
 	size_t getClassIndex(const Class*) const;
 	size_t getFunctionIndex(const Function*) const;
 };
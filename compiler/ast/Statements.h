@@ -57,6 +57,23 @@ struct Continue: StatementBase<Continue>
 	inline Continue(std::shared_ptr<Loop> loop): loop(loop) {}
 };
 
+struct Throw: StatementBase<Throw>
+{
+	const std::shared_ptr<const RValue> value;
+
+	inline Throw(std::shared_ptr<const RValue> value): value(value) {}
+};
+
+/*
+ * Exceptions thrown while executing the body are bound to the local and passed to the handler.
+ */
+struct Try: StatementBase<Try>
+{
+	const std::shared_ptr<Block> body = std::make_shared<Block>();
+	const std::shared_ptr<Block> handler = std::make_shared<Block>();
+	std::shared_ptr<const Local> exception;
+};
+
 struct Return: StatementBase<Return>
 {
 	std::vector<std::shared_ptr<const RValue>> value;
@@ -15,12 +15,41 @@ std::string ValueType::getReferenceForDump(const ProgramObjectSet &gi) const
 			case PrimitiveType::Floating: return "float";
 			case PrimitiveType::Logical: return "logical";
 			case PrimitiveType::Native: return "native";
+			case PrimitiveType::Int8: return "int8";
+			case PrimitiveType::Uint8: return "uint8";
+			case PrimitiveType::Int16: return "int16";
+			case PrimitiveType::Uint16: return "uint16";
 			default: return "???";
 		}
 	}
 	else
 	{
 		assert(kind == TypeKind::Reference);
+
+		if(isArray())
+		{
+			return elementType->getReferenceForDump(gi) + "[]";
+		}
+
 		return referenceType->getReferenceForDump(gi) + "*";
 	}
 }
+
+size_t ValueType::getPackedWidth() const
+{
+	if(kind == TypeKind::Value)
+	{
+		switch(primitiveType) {
+			case PrimitiveType::Logical:
+			case PrimitiveType::Int8:
+			case PrimitiveType::Uint8: return 1;
+			case PrimitiveType::Int16:
+			case PrimitiveType::Uint16: return 2;
+			case PrimitiveType::Integer:
+			case PrimitiveType::Floating: return 4;
+			default: return 0;
+		}
+	}
+
+	return 0;
+}
@@ -16,7 +16,8 @@ enum TypeKind {
 };
 
 enum PrimitiveType {
-	Integer, Floating, Logical, Native
+	Integer, Floating, Logical, Native,
+	Int8, Uint8, Int16, Uint16 // Only as the type of fields, widened to integer when read.
 };
 
 struct ValueType
@@ -24,13 +25,28 @@ struct ValueType
 	TypeKind kind;
 	PrimitiveType primitiveType;
 	const std::shared_ptr<Class> referenceType;
+	const std::shared_ptr<const ValueType> elementType;
 
 	static inline auto primitive(PrimitiveType primitiveType) { return ValueType{ .kind = TypeKind::Value, .primitiveType = primitiveType}; }
 	static inline auto integer() { return primitive(PrimitiveType::Integer); }
 	static inline auto floating() { return primitive(PrimitiveType::Floating); }
 	static inline auto logical() { return primitive(PrimitiveType::Logical); }
 	static inline auto native() { return primitive(PrimitiveType::Native); }
+	static inline auto int8() { return primitive(PrimitiveType::Int8); }
+	static inline auto uint8() { return primitive(PrimitiveType::Uint8); }
+	static inline auto int16() { return primitive(PrimitiveType::Int16); }
+	static inline auto uint16() { return primitive(PrimitiveType::Uint16); }
 	static inline auto reference(std::shared_ptr<Class> referenceType) { return ValueType{ .kind = TypeKind::Reference, .referenceType = referenceType}; }
+	static inline auto array(const ValueType& elementType) { return ValueType{ .kind = TypeKind::Reference, .elementType = std::make_shared<const ValueType>(elementType)}; }
+
+	inline bool isArray() const { return elementType != nullptr; }
+	inline bool isNarrow() const { return kind == TypeKind::Value && primitiveType >= PrimitiveType::Int8; }
+
+	// The type of the value read from a storage location of this type.
+	inline ValueType promoted() const { return isNarrow() ? integer() : *this; }
+
+	// Size in the packed area of an object, zero if it must be stored as a full value or reference.
+	size_t getPackedWidth() const;
 
 	std::string getReferenceForDump(const ProgramObjectSet &gi) const;
 };
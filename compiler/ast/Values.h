@@ -37,7 +37,7 @@ struct Global: LValueBase<Global>
 	inline Global(const StaticField& field): field(field) {}
 	inline virtual ~Global() = default;
 
-	inline virtual ValueType getType() const override { return field.getType(); }
+	inline virtual ValueType getType() const override { return field.getType().promoted(); }
 };
 
 struct Dereference: LValueBase<Dereference>
@@ -48,7 +48,22 @@ struct Dereference: LValueBase<Dereference>
 	inline Dereference(std::shared_ptr<const RValue> object, const Field& field): object(object), field(field) {}
 	inline virtual ~Dereference() = default;
 
-	inline virtual ValueType getType() const override { return field.getType(); }
+	inline virtual ValueType getType() const override { return field.getType().promoted(); }
+};
+
+struct Element: LValueBase<Element>
+{
+	const std::shared_ptr<const RValue> array, index;
+
+	inline Element(std::shared_ptr<const RValue> array, std::shared_ptr<const RValue> index): array(array), index(index) {}
+	inline virtual ~Element() = default;
+
+	inline virtual ValueType getType() const override
+	{
+		const auto t = array->getType();
+		assert(t.isArray()); // compile error
+		return *t.elementType;
+	}
 };
 
 struct Set: ValueBase<Set>
@@ -158,6 +173,25 @@ struct Create: ValueBase<Create>
 	inline virtual ValueType getType() const override { return ValueType::reference(type); }
 };
 
+struct CreateArray: ValueBase<CreateArray>
+{
+	const ValueType elementType;
+	const std::shared_ptr<const RValue> length;
+
+	inline CreateArray(const ValueType& elementType, std::shared_ptr<const RValue> length): elementType(elementType), length(length) {}
+
+	inline virtual ValueType getType() const override { return ValueType::array(elementType); }
+};
+
+struct Length: ValueBase<Length>
+{
+	const std::shared_ptr<const RValue> array;
+
+	inline Length(std::shared_ptr<const RValue> array): array(array) {}
+
+	inline virtual ValueType getType() const override { return ValueType::integer(); }
+};
+
 struct Call: ValueBase<Call>
 {
 	std::shared_ptr<Function> fn;
@@ -15,6 +15,8 @@ namespace ast {
 	X(Block) \
 	X(Break) \
 	X(Loop) \
+	X(Throw) \
+	X(Try) \
 
 #define X(n) class n;
 _STATEMENT_TYPES()
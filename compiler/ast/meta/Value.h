@@ -15,9 +15,12 @@ namespace ast {
 	X(Unary) \
 	X(Binary) \
 	X(Create) \
+	X(Length) \
+	X(Element) \
 	X(Global) \
 	X(Literal) \
 	X(Ternary) \
+	X(CreateArray) \
 	X(Argument) \
 	X(Dereference)
 
@@ -7,6 +7,7 @@
 #include "compiler/ast/Values.h"
 
 #include "Helpers.h"
+#include "FunctionBuilder.h"
 
 namespace comp {
 
@@ -47,6 +48,24 @@ public:
 		return addStaticField(ast::ValueType::reference(c.data));
 	}
 
+	// Adds a new virtual method slot after the inherited ones, returns its index.
+	inline size_t addMethod(const FunctionBuilder& f)
+	{
+		const auto slot = data->getMethodCount();
+		overrideMethod(slot, f);
+		return slot;
+	}
+
+	inline void overrideMethod(size_t slot, const FunctionBuilder& f)
+	{
+		if(data->methods.size() <= slot)
+		{
+			data->methods.resize(slot + 1);
+		}
+
+		data->methods[slot] = f.data;
+	}
+
 	inline RValWrapper operator()() {
 		return {std::make_shared<ast::Create>(data)};
 	}
@@ -21,6 +21,7 @@ class Line;
 class FunctionBuilder
 {
 	friend class ProgramBuilder;
+	friend class ClassBuilder;
 
 	std::shared_ptr<ast::Function> data;
 	std::shared_ptr<StatementSink> currentBlock;
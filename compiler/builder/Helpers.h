@@ -15,6 +15,10 @@ namespace comp {
 
 inline RValWrapper null(std::make_shared<ast::Create>(nullptr));
 
+inline RValWrapper array(ast::ValueType elementType, const RValWrapper& length) {
+	return {std::make_shared<ast::CreateArray>(elementType, length.val)};
+}
+
 inline auto declaration(ast::ValueType type, const RValWrapper& initializer)
 {
 	return [type, initializer{initializer.val}](std::shared_ptr<StatementSink>& sink) -> LValWrapper
@@ -104,6 +108,40 @@ inline auto restartLoop()
 	};
 }
 
+inline auto raise(const RValWrapper& exception)
+{
+	return [exception{exception.val}](std::shared_ptr<StatementSink>& sink) {
+		sink->add(std::make_shared<ast::Throw>(exception));
+	};
+}
+
+inline auto attempt()
+{
+	return [](std::shared_ptr<StatementSink>& sink)
+	{
+		auto attempt = std::make_shared<ast::Try>();
+		sink->add(attempt);
+		sink = std::make_shared<TrySink>(attempt, sink);
+	};
+}
+
+/*
+ * Ends the body of the enclosing attempt and starts its handler, returns the caught exception.
+ */
+inline auto handler(ast::ValueType type)
+{
+	return [type](std::shared_ptr<StatementSink>& sink) -> LValWrapper
+	{
+		auto tsink = std::dynamic_pointer_cast<TrySink>(sink);
+		assert(tsink != nullptr);
+
+		auto ret = sink->addLocal(type);
+		tsink->attempt->exception = ret;
+		sink = std::make_shared<BlockSink>(tsink->attempt->handler, tsink->parent);
+		return {ret};
+	};
+}
+
 inline auto ret()
 {
 	return [](std::shared_ptr<StatementSink>& sink)
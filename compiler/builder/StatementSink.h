@@ -48,6 +48,14 @@ struct LoopSink: BlockSink
 		BlockSink(loop->body, parent), loop(loop) {}
 };
 
+struct TrySink: BlockSink
+{
+	std::shared_ptr<ast::Try> attempt;
+
+	inline TrySink(std::shared_ptr<ast::Try> attempt, std::shared_ptr<StatementSink> parent = {}):
+		BlockSink(attempt->body, parent), attempt(attempt) {}
+};
+
 }  // namespace comp
 
 #endif /* COMPILER_STATEMENTSINK_H_ */
@@ -24,6 +24,13 @@ struct RValWrapper
 	}
 
 	inline struct LValWrapper operator [](const ast::Field& f) const;
+	inline struct LValWrapper operator [](const RValWrapper& index) const;
+
+	inline RValWrapper length() const
+	{
+		assert(val->getType().isArray()); // TODO compiler error
+		return {std::make_shared<ast::Length>(val)};
+	}
 
 	template<ast::Binary::Operation ifInt, ast::Binary::Operation ifFloat>
 	inline RValWrapper selectBinary(const std::shared_ptr<ast::RValue> &o)
@@ -133,11 +140,11 @@ struct RValWrapper
 	}
 
 	inline auto operator &&(const RValWrapper &o) {
-		return checkIntegerBinary<ast::Binary::Operation::And>(o.val);
+		return checkLogicBinary<ast::Binary::Operation::And>(o.val);
 	}
 
 	inline auto operator ||(const RValWrapper &o) {
-		return checkIntegerBinary<ast::Binary::Operation::Or>(o.val);
+		return checkLogicBinary<ast::Binary::Operation::Or>(o.val);
 	}
 
 	inline RValWrapper operator -()
@@ -220,6 +227,12 @@ inline LValWrapper RValWrapper::operator [](const ast::Field& f) const {
 	return {std::make_shared<ast::Dereference>(val, f)};
 }
 
+inline LValWrapper RValWrapper::operator [](const RValWrapper& index) const
+{
+	assert(val->getType().isArray()); // TODO compiler error
+	return {std::make_shared<ast::Element>(val, index.val)};
+}
+
 } // namespace comp
 
 #endif /* COMPILER_BUILDER_RVALWRAPPER_H_ */
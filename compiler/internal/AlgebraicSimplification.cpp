@@ -0,0 +1,239 @@
+#include "Compiler.h"
+
+#include "compiler/ir/Temporary.h"
+#include "compiler/ir/Operations.h"
+#include "compiler/ir/Terminations.h"
+
+#include "Overloaded.h"
+
+#include <map>
+#include <cstring>
+#include <optional>
+#include <functional>
+
+using namespace comp;
+using namespace comp::ir;
+
+static inline std::optional<int> constant(const std::shared_ptr<Temporary>& t)
+{
+	if(auto c = std::dynamic_pointer_cast<Constant>(t))
+	{
+		return c->value;
+	}
+
+	return {};
+}
+
+/*
+ * Variables known to hold non-negative values everywhere, as their only definition produces such.
+ */
+class Facts
+{
+	std::map<std::shared_ptr<Variable>, std::shared_ptr<Operation>> definitions;
+
+public:
+	Facts(const std::shared_ptr<ir::Function> &f)
+	{
+		std::for_each(f->args.begin(), f->args.end(), [&](const auto& a){ definitions[a] = nullptr; });
+
+		f->traverse([&](std::shared_ptr<BasicBlock> bb)
+		{
+			for(const auto& o: bb->code)
+			{
+				const auto define = [&](const std::shared_ptr<Variable>& v)
+				{
+					const auto r = definitions.insert({v, o});
+
+					if(!r.second)
+					{
+						r.first->second = nullptr;
+					}
+				};
+
+				o->accept(overloaded
+				{
+					[&](const Copy& v) { define(v.target); },
+					[&](const Unary& v) { define(v.target); },
+					[&](const Create& v) { define(v.target); },
+					[&](const LoadField& v) { define(v.target); },
+					[&](const StoreField& v) {},
+					[&](const LoadGlobal& v) { define(v.target); },
+					[&](const StoreGlobal& v) {},
+					[&](const CreateArray& v) { define(v.target); },
+					[&](const LoadElement& v) { define(v.target); },
+					[&](const StoreElement& v) {},
+					[&](const ArrayLength& v) { define(v.target); },
+					[&](const Binary& v) { define(v.target); },
+					[&](const Call& v) { std::for_each(v.ret.begin(), v.ret.end(), define); },
+					[&](const Catch& v) { define(v.target); },
+				});
+			}
+		});
+	}
+
+	bool isNonNegative(const std::shared_ptr<Temporary>& t) const
+	{
+		if(auto c = std::dynamic_pointer_cast<Constant>(t))
+		{
+			return c->value >= 0;
+		}
+
+		const auto it = definitions.find(std::static_pointer_cast<Variable>(t));
+
+		if(it == definitions.end() || !it->second)
+		{
+			return false;
+		}
+
+		bool ret = false;
+
+		it->second->accept(overloaded
+		{
+			[&](const ArrayLength& v) { ret = true; },
+			[&](const Copy& v)
+			{
+				const auto c = constant(v.source);
+				ret = c && *c >= 0;
+			},
+			[&](const Binary& v)
+			{
+				const auto f = constant(v.first), s = constant(v.second);
+
+				switch(v.op)
+				{
+					case Binary::Op::ShrU: ret = s && (*s & 31); break;
+					case Binary::Op::AndI: ret = (f && *f >= 0) || (s && *s >= 0); break;
+					default: break;
+				}
+			},
+			[&](const Operation& v) {},
+		});
+
+		return ret;
+	}
+};
+
+static inline bool is(const std::shared_ptr<Temporary>& t, int v)
+{
+	const auto c = constant(t);
+	return c && *c == v;
+}
+
+static inline bool isFloat(const std::shared_ptr<Temporary>& t, float v)
+{
+	int bits;
+	std::memcpy(&bits, &v, sizeof(bits));
+	return is(t, bits);
+}
+
+// The exponent if it is a positive power of two.
+static inline std::optional<int> log2(const std::shared_ptr<Temporary>& t)
+{
+	if(const auto c = constant(t); c && *c > 0 && !(*c & (*c - 1)))
+	{
+		return __builtin_ctz(*c);
+	}
+
+	return {};
+}
+
+static inline std::shared_ptr<Operation> copy(const std::shared_ptr<Variable>& t, const std::shared_ptr<Temporary>& v) {
+	return std::make_shared<Copy>(t, v);
+}
+
+static inline std::shared_ptr<Operation> literal(const std::shared_ptr<Variable>& t, int v) {
+	return std::make_shared<Copy>(t, std::make_shared<Constant>(t->type, v));
+}
+
+static inline std::shared_ptr<Operation> binary(const std::shared_ptr<Variable>& t, const std::shared_ptr<Temporary>& v, Binary::Op op, int c) {
+	return std::make_shared<Binary>(t, v, std::make_shared<Constant>(ast::ValueType::integer(), c), op);
+}
+
+struct Rule
+{
+	const char* name;
+	Binary::Op op;
+	bool commutative; // Tried with the operands swapped as well.
+	std::function<std::shared_ptr<Operation>(const Facts&, const std::shared_ptr<Variable>&, const std::shared_ptr<Temporary>&, const std::shared_ptr<Temporary>&)> rewrite;
+};
+
+#define RULE(name, op, commutative, expr) {name, Binary::Op:: op, commutative, [](const Facts& facts, const auto& t, const auto& a, const auto& b) -> std::shared_ptr<Operation> { return expr; }}
+
+/*
+ * The first rule matching an operation replaces it. The division and the remainder round towards
+ * zero, so they are only turned into shifts and masks for dividends that can not be negative.
+ * The floating point rules are the ones exact for every value, including the signed zeros and NaNs.
+ */
+static const Rule rules[] =
+{
+	RULE("addZero",   AddI, true,  is(b, 0) ? copy(t, a) : nullptr),
+	RULE("subZero",   SubI, false, is(b, 0) ? copy(t, a) : nullptr),
+	RULE("subSelf",   SubI, false, (a == b) ? literal(t, 0) : nullptr),
+	RULE("mulZero",   MulI, true,  is(b, 0) ? literal(t, 0) : nullptr),
+	RULE("mulOne",    MulI, true,  is(b, 1) ? copy(t, a) : nullptr),
+	RULE("mulPow2",   MulI, true,  log2(b) ? binary(t, a, Binary::Op::ShlI, *log2(b)) : nullptr),
+	RULE("divOne",    DivI, false, is(b, 1) ? copy(t, a) : nullptr),
+	RULE("divPow2",   DivI, false, (log2(b) && facts.isNonNegative(a)) ? binary(t, a, Binary::Op::ShrU, *log2(b)) : nullptr),
+	RULE("modOne",    Mod,  false, is(b, 1) ? literal(t, 0) : nullptr),
+	RULE("modPow2",   Mod,  false, (log2(b) && facts.isNonNegative(a)) ? binary(t, a, Binary::Op::AndI, *constant(b) - 1) : nullptr),
+	RULE("shiftZero", ShlI, false, is(b, 0) ? copy(t, a) : nullptr),
+	RULE("shiftZero", ShrI, false, is(b, 0) ? copy(t, a) : nullptr),
+	RULE("shiftZero", ShrU, false, is(b, 0) ? copy(t, a) : nullptr),
+	RULE("andZero",   AndI, true,  is(b, 0) ? literal(t, 0) : nullptr),
+	RULE("andSelf",   AndI, false, (a == b) ? copy(t, a) : nullptr),
+	RULE("orZero",    OrI,  true,  is(b, 0) ? copy(t, a) : nullptr),
+	RULE("orSelf",    OrI,  false, (a == b) ? copy(t, a) : nullptr),
+	RULE("xorZero",   XorI, true,  is(b, 0) ? copy(t, a) : nullptr),
+	RULE("xorSelf",   XorI, false, (a == b) ? literal(t, 0) : nullptr),
+	RULE("subZeroF",  SubF, false, isFloat(b, 0.0f) ? copy(t, a) : nullptr),
+	RULE("mulOneF",   MulF, true,  isFloat(b, 1.0f) ? copy(t, a) : nullptr),
+	RULE("divOneF",   DivF, false, isFloat(b, 1.0f) ? copy(t, a) : nullptr),
+};
+
+#undef RULE
+
+/*
+ * Replaces the arithmetic operations with cheaper equivalents (copies, shifts and masks) where an
+ * operand is a constant or both are the same variable, counting the rewrites by the rule applied.
+ */
+bool Compiler::simplifyOperations(std::shared_ptr<ir::Function> f, Statistics& stats)
+{
+	const Facts facts(f);
+	bool ret = false;
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		for(auto& o: bb->code)
+		{
+			const auto b = std::dynamic_pointer_cast<Binary>(o);
+
+			if(!b)
+			{
+				continue;
+			}
+
+			for(const auto& r: rules)
+			{
+				if(r.op == b->op)
+				{
+					auto s = r.rewrite(facts, b->target, b->first, b->second);
+
+					if(!s && r.commutative)
+					{
+						s = r.rewrite(facts, b->target, b->second, b->first);
+					}
+
+					if(s)
+					{
+						o = s;
+						stats.simplifications[r.name]++;
+						ret = true;
+						break;
+					}
+				}
+			}
+		}
+	});
+
+	return ret;
+}
@@ -0,0 +1,106 @@
+#ifndef COMPILER_INTERNAL_ARITHMETIC_H_
+#define COMPILER_INTERNAL_ARITHMETIC_H_
+
+#include "compiler/ir/Operations.h"
+#include "compiler/ir/Terminations.h"
+
+#include "assert.h"
+
+#include <cstring>
+#include <optional>
+
+namespace comp {
+namespace ir {
+
+/*
+ * The operations on the raw values as done by the VM, for evaluating them at compile time.
+ */
+inline float i2f(int i) { float f; std::memcpy(&f, &i, sizeof(f)); return f; }
+inline int f2i(float f) { int i; std::memcpy(&i, &f, sizeof(i)); return i; }
+
+inline bool calculateCondition(Conditional::Condition cond, int a, int b)
+{
+	switch(cond)
+	{
+		case Conditional::Condition::Eq: return a == b;
+		case Conditional::Condition::Ne: return a != b;
+		case Conditional::Condition::LtI: return a < b;
+		case Conditional::Condition::GtI: return a > b;
+		case Conditional::Condition::LeI: return a <= b;
+		case Conditional::Condition::GeI: return a >= b;
+		case Conditional::Condition::LtU: return (unsigned)a < (unsigned)b;
+		case Conditional::Condition::GtU: return (unsigned)a > (unsigned)b;
+		case Conditional::Condition::LeU: return (unsigned)a <= (unsigned)b;
+		case Conditional::Condition::GeU: return (unsigned)a >= (unsigned)b;
+		case Conditional::Condition::LtF: return i2f(a) < i2f(b);
+		case Conditional::Condition::GtF: return i2f(a) > i2f(b);
+		case Conditional::Condition::LeF: return i2f(a) <= i2f(b);
+		case Conditional::Condition::GeF: return i2f(a) >= i2f(b);
+	}
+
+	assert(false);
+	return false;
+}
+
+/*
+ * Operations that would trap (or are undefined in the compiler) are left to be done at run time.
+ */
+inline std::optional<int> calculateBinary(Binary::Op op, int f, int s)
+{
+	const bool isDivisionValid = s != 0 && !(f == INT32_MIN && s == -1);
+	const bool isShiftValid = s >= 0 && s < 32;
+
+	switch(op)
+	{
+		case Binary::Op::AddI: return (int)((unsigned)f + (unsigned)s);
+		case Binary::Op::MulI: return (int)((unsigned)f * (unsigned)s);
+		case Binary::Op::SubI: return (int)((unsigned)f - (unsigned)s);
+		case Binary::Op::DivI: return isDivisionValid ? std::optional<int>(f / s) : std::nullopt;
+		case Binary::Op::Mod : return isDivisionValid ? std::optional<int>(f % s) : std::nullopt;
+		case Binary::Op::ShlI: return isShiftValid ? std::optional<int>((int)((unsigned)f << s)) : std::nullopt;
+		case Binary::Op::ShrI: return isShiftValid ? std::optional<int>(f >> s) : std::nullopt;
+		case Binary::Op::ShrU: return isShiftValid ? std::optional<int>((unsigned)f >> s) : std::nullopt;
+		case Binary::Op::AndI: return f & s;
+		case Binary::Op::OrI : return f | s;
+		case Binary::Op::XorI: return f ^ s;
+		case Binary::Op::AddF: return f2i(i2f(f) + i2f(s));
+		case Binary::Op::MulF: return f2i(i2f(f) * i2f(s));
+		case Binary::Op::SubF: return f2i(i2f(f) - i2f(s));
+		case Binary::Op::DivF: return f2i(i2f(f) / i2f(s));
+	}
+
+	assert(false);
+	return {};
+}
+
+/*
+ * The conversions as done by the VM, the float to integer one only for values in range.
+ */
+inline std::optional<int> calculateUnary(Unary::Op op, int v)
+{
+	switch(op)
+	{
+		case Unary::Op::Neg: return ~v;
+		case Unary::Op::I2F: return f2i((float)v);
+		case Unary::Op::F2I:
+		{
+			const auto f = i2f(v);
+
+			if(f >= -2147483648.0f && f < 2147483648.0f)
+			{
+				return (int)f;
+			}
+
+			return {};
+		}
+		default: break;
+	}
+
+	assert(false);
+	return {};
+}
+
+} // namespace ir
+} // namespace comp
+
+#endif /* COMPILER_INTERNAL_ARITHMETIC_H_ */
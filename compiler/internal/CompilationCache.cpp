@@ -0,0 +1,55 @@
+#include "CompilationCache.h"
+
+#include <thread>
+#include <sstream>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+using namespace comp;
+
+CompilationCache::CompilationCache(const std::string& directory): directory(directory) {
+	std::filesystem::create_directories(directory);
+}
+
+std::string CompilationCache::getPath(const std::string& key) const {
+	return (std::filesystem::path(directory) / key).string();
+}
+
+std::optional<std::string> CompilationCache::load(const std::string& key)
+{
+	std::ifstream in(getPath(key), std::ios::binary);
+
+	if(!in)
+	{
+		misses++;
+		return {};
+	}
+
+	hits++;
+	return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void CompilationCache::store(const std::string& key, const std::string& value) const
+{
+	std::stringstream tmp;
+	tmp << getPath(key) << ".tmp" << std::this_thread::get_id();
+
+	{
+		std::ofstream out(tmp.str(), std::ios::binary | std::ios::trunc);
+		out << value;
+
+		if(!out)
+		{
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tmp.str(), getPath(key), ec);
+
+	if(ec)
+	{
+		std::filesystem::remove(tmp.str(), ec);
+	}
+}
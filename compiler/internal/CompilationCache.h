@@ -0,0 +1,41 @@
+#ifndef COMPILER_INTERNAL_COMPILATIONCACHE_H_
+#define COMPILER_INTERNAL_COMPILATIONCACHE_H_
+
+#include <atomic>
+#include <string>
+#include <optional>
+
+namespace comp {
+
+/*
+ * Results of the per function stages of the compiler, stored in a directory under the hash of
+ * everything they depend on, so unchanged functions are not processed again by later builds.
+ *
+ * Entries are written to a temporary file that is then renamed, so concurrent writers (threads
+ * or separate builds sharing the directory) never expose a partial entry.
+ */
+class CompilationCache
+{
+	const std::string directory;
+	std::atomic<size_t> hits = 0, misses = 0;
+
+	std::string getPath(const std::string& key) const;
+
+public:
+	CompilationCache(const std::string& directory);
+
+	std::optional<std::string> load(const std::string& key);
+	void store(const std::string& key, const std::string& value) const;
+
+	inline size_t getHitCount() const {
+		return hits;
+	}
+
+	inline size_t getMissCount() const {
+		return misses;
+	}
+};
+
+} // namespace comp
+
+#endif /* COMPILER_INTERNAL_COMPILATIONCACHE_H_ */
@@ -6,8 +6,18 @@
 #include "compiler/ast/Function.h"
 #include "compiler/ir/Function.h"
 
+#include "CompilationCache.h"
+
 #include "program/Program.h"
 
+#include <map>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <optional>
+#include <vector>
+#include <algorithm>
+
 namespace comp {
 
 enum class Options
@@ -15,6 +25,10 @@ enum class Options
     doJumpOptimizations = 0x00000001,
     propagateConstants  = 0x00000002,
     eliminateDeadCode   = 0x00000004,
+    replaceScalars      = 0x00000008,
+    propagateCopies     = 0x00000010, // And coalesce the variables of the copies left
+    simplifyOperations  = 0x00000020,
+    unrollLoops         = 0x00000040, // With a trip count known at compile time
 };
 
 static constexpr inline Options operator| (Options x, Options y)
@@ -31,34 +45,139 @@ static constexpr inline bool operator& (Options x, Options y)
 
 class Compiler
 {
+public:
+	struct Statistics
+	{
+		size_t eliminatedAllocations = 0;
+		std::map<std::string, size_t> simplifications; // By the name of the rule applied
+		size_t unrolledLoops = 0, partiallyUnrolledLoops = 0;
+
+		inline Statistics& operator+=(const Statistics& o)
+		{
+			eliminatedAllocations += o.eliminatedAllocations;
+			unrolledLoops += o.unrolledLoops;
+			partiallyUnrolledLoops += o.partiallyUnrolledLoops;
+			std::for_each(o.simplifications.begin(), o.simplifications.end(), [&](const auto& p){ simplifications[p.first] += p.second; });
+			return *this;
+		}
+	};
+
+	// Result of running a function on the IR, with the number of operations and terminations executed.
+	struct Execution
+	{
+		std::vector<int> ret;
+		size_t nOperations = 0, nBranches = 0, nJumps = 0;
+	};
+
+private:
 	std::shared_ptr<ast::Function> entryPoint;
 	ast::ProgramObjectSet gi;
+	Statistics statistics;
+	size_t nThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::shared_ptr<CompilationCache> cache;
+	size_t unrollBudget = 64;
 
-public:
+	template<class C> inline auto forEachFunction(C&& c) const;
+	std::string getCacheKey(size_t functionIdx, Options opt) const;
 
-private:
 	static std::shared_ptr<ir::Function> generateIr(std::shared_ptr<ast::Function> f);
-	static void optimizeIr(std::shared_ptr<ir::Function> f, Options opt);
+	static void optimizeIr(std::shared_ptr<ir::Function> f, Options opt, size_t unrollBudget, Statistics& stats);
+	static size_t replaceScalars(std::shared_ptr<ir::Function> f);
 	static bool removeEmptyBasicBlocks(std::shared_ptr<ir::Function> f);
 	static bool mergeBasicBlocks(std::shared_ptr<ir::Function> f);
 	static bool propagateConstants(std::shared_ptr<ir::Function> f);
 	static bool eliminateDeadCode(std::shared_ptr<ir::Function> f);
+	static bool propagateCopies(std::shared_ptr<ir::Function> f);
+	static bool coalesceCopies(std::shared_ptr<ir::Function> f);
+	static bool simplifyOperations(std::shared_ptr<ir::Function> f, Statistics& stats);
+	static bool unrollLoops(std::shared_ptr<ir::Function> f, size_t budget, Statistics& stats);
 
 	static inline constexpr auto defaultFlags =
 			Options::doJumpOptimizations |
 			Options::propagateConstants |
-			Options::eliminateDeadCode;
+			Options::eliminateDeadCode |
+			Options::replaceScalars |
+			Options::propagateCopies |
+			Options::simplifyOperations |
+			Options::unrollLoops;
 public:
 	inline Compiler(std::shared_ptr<ast::Function> entryPoint):
 		entryPoint(entryPoint),
 		gi(ast::ProgramObjectSet::shakeTree(entryPoint)) {}
 
+	// The functions are processed independently, by up to the given number of threads.
+	inline void setThreadCount(size_t n) {
+		nThreads = std::max<size_t>(n, 1);
+	}
+
+	// Results of the functions not changed since they were stored are taken from the cache.
+	inline void setCache(std::shared_ptr<CompilationCache> c) {
+		cache = c;
+	}
+
+	// Operations a loop may be unrolled to at most.
+	inline void setUnrollBudget(size_t n) {
+		unrollBudget = n;
+	}
+
 	std::string dumpAst();
 	std::string dumpCfg(Options opt = defaultFlags);
 
+	// Functions and classes reachable from the entry point, which is the first function.
+	inline const ast::ProgramObjectSet& getProgramObjects() const {
+		return gi;
+	}
+
+	// Accumulated over the functions optimized so far.
+	inline const Statistics& getStatistics() const {
+		return statistics;
+	}
+
+	/*
+	 * Runs a function on the IR after the optimizations, for measuring and checking them until it
+	 * can be compiled. Only the arithmetic and the scalar globals (starting from zero) are supported,
+	 * there is no result for code that works on objects, calls or exceptions, traps, or runs for
+	 * more than the given number of steps.
+	 */
+	std::optional<Execution> execute(size_t functionIdx, const std::vector<int>& args, Options opt = defaultFlags, size_t maxSteps = 1 << 20) const;
+
 	prog::Program compile(); // TBD
+	std::vector<std::vector<uint32_t>> generateMethodTables();
+	std::vector<prog::TypeInfo> generateTypes();
+
+	static prog::Program fuseInstructions(const prog::Program& p);
+
 };
 
+/*
+ * Calls the payload with the index of every function of the program, the results are in the order
+ * of the functions regardless of which thread got to which function first.
+ */
+template<class C>
+inline auto Compiler::forEachFunction(C&& c) const
+{
+	std::vector<decltype(c(size_t(0)))> ret(gi.functions.size());
+	std::atomic<size_t> next = 0;
+
+	const auto worker = [&]()
+	{
+		for(size_t i; (i = next++) < ret.size();)
+		{
+			ret[i] = c(i);
+		}
+	};
+
+	std::vector<std::thread> helpers;
+	for(auto i = 1u; i < std::min(nThreads, ret.size()); i++)
+	{
+		helpers.emplace_back(worker);
+	}
+
+	worker();
+	std::for_each(helpers.begin(), helpers.end(), [](auto& t){ t.join(); });
+	return ret;
+}
+
 } // namespace comp
 
 #endif /* COMPILER_COMPILE_H_ */
@@ -1,4 +1,5 @@
 #include "Compiler.h"
+#include "Arithmetic.h"
 
 #include "compiler/ir/Temporary.h"
 #include "compiler/ir/Operations.h"
@@ -88,68 +89,21 @@ public:
 	}
 };
 
-static inline float i2f(int i) { return *(float*)&i; }
-static inline int f2i(float f) { return *(int*)&f; }
-
-static inline bool calculateCondition(Conditional::Condition cond, int a, int b)
-{
-	switch(cond)
-	{
-		case Conditional::Condition::Eq: return a == b;
-		case Conditional::Condition::Ne: return a != b;
-		case Conditional::Condition::LtI: return a < b;
-		case Conditional::Condition::GtI: return a > b;
-		case Conditional::Condition::LeI: return a <= b;
-		case Conditional::Condition::GeI: return a >= b;
-		case Conditional::Condition::LtU: return (unsigned)a < (unsigned)b;
-		case Conditional::Condition::GtU: return (unsigned)a > (unsigned)b;
-		case Conditional::Condition::LeU: return (unsigned)a <= (unsigned)b;
-		case Conditional::Condition::GeU: return (unsigned)a >= (unsigned)b;
-		case Conditional::Condition::LtF: return i2f(a) < i2f(b);
-		case Conditional::Condition::GtF: return i2f(a) > i2f(b);
-		case Conditional::Condition::LeF: return i2f(a) <= i2f(b);
-		case Conditional::Condition::GeF: return i2f(a) >= i2f(b);
-	}
-
-	assert(false);
-	return false;
-}
-
-static inline int calculateBinary(Binary::Op op, int f, int s)
-{
-	switch(op)
-	{
-		case Binary::Op::AddI: return f + s;
-		case Binary::Op::MulI: return f * s;
-		case Binary::Op::SubI: return f - s;
-		case Binary::Op::DivI: return f / s;
-		case Binary::Op::Mod : return f % s;
-		case Binary::Op::ShlI: return f << s;
-		case Binary::Op::ShrI: return f >> s;
-		case Binary::Op::ShrU: return (unsigned)f >> s;
-		case Binary::Op::AndI: return f & s;
-		case Binary::Op::OrI : return f | s;
-		case Binary::Op::XorI: return f ^ s;
-		case Binary::Op::AddF: return f2i(i2f(f) + i2f(s));
-		case Binary::Op::MulF: return f2i(i2f(f) * i2f(s));
-		case Binary::Op::SubF: return f2i(i2f(f) - i2f(s));
-		case Binary::Op::DivF: return f2i(i2f(f) / i2f(s));
-	}
-
-	assert(false);
-	return 0;
-}
-
 static inline void examineOperation(ConstnessAnalysis& state, const std::shared_ptr<Operation> &op)
 {
 	op->accept(overloaded
 	{
 		[&](const StoreField& v) {},
 		[&](const StoreGlobal& v) {},
+		[&](const StoreElement& v) {},
 		[&](const Create& v) { state.addConstnessInformation(v.target, {}); },
+		[&](const CreateArray& v) { state.addConstnessInformation(v.target, {}); },
+		[&](const LoadElement& v) { state.addConstnessInformation(v.target, {}); },
+		[&](const ArrayLength& v) { state.addConstnessInformation(v.target, {}); },
 		[&](const LoadField& v) { state.addConstnessInformation(v.target, {}); },
 		[&](const LoadGlobal& v) { state.addConstnessInformation(v.target, {}); },
 		[&](const Call& v) { std::for_each(v.ret.begin(), v.ret.end(), [&](const auto r){ state.addConstnessInformation(r, {}); }); },
+		[&](const Catch& v) { state.addConstnessInformation(v.target, {}); },
 		[&](const Copy& v)
 		{
 			if(auto val = state.evaluateConstant(v.source))
@@ -165,18 +119,7 @@ static inline void examineOperation(ConstnessAnalysis& state, const std::shared_
 		{
 			if(auto c = state.evaluateConstant(v.source))
 			{
-				switch(v.op)
-				{
-					case Unary::Op::Neg:
-						state.addConstnessInformation(v.target, ~*c);
-					break;
-					case Unary::Op::I2F:
-					case Unary::Op::F2I:
-						state.addConstnessInformation(v.target, *c);
-					break;
-					default: assert(false);
-				}
-
+				state.addConstnessInformation(v.target, calculateUnary(v.op, *c));
 			}
 			else
 			{
@@ -209,9 +152,41 @@ static inline std::shared_ptr<Operation> substituteOperation(const ConstnessAnal
 		[&](const StoreField& v) {},
 		[&](const StoreGlobal& v) {},
 		[&](const Create& v) {},
+		[&](const ArrayLength& v) {},
+		[&](const Catch& v) {},
+		[&](const CreateArray& v)
+		{
+			if(auto l = state.getStoredConstantValue(v.length))
+			{
+				ret = std::make_shared<CreateArray>(v.target, std::make_shared<Constant>(v.length->type, *l));
+			}
+		},
+		[&](const LoadElement& v)
+		{
+			if(auto i = state.getStoredConstantValue(v.index))
+			{
+				ret = std::make_shared<LoadElement>(v.target, v.array, std::make_shared<Constant>(v.index->type, *i));
+			}
+		},
+		[&](const StoreElement& v)
+		{
+			if(auto i = state.getStoredConstantValue(v.index))
+			{
+				ret = std::make_shared<StoreElement>(v.source, v.array, std::make_shared<Constant>(v.index->type, *i));
+			}
+		},
 		[&](const LoadField& v) {},
 		[&](const LoadGlobal& v) {},
-		[&](const Unary& v) { /* should be processed as constant already if its only arg is constant */ },
+		[&](const Unary& v)
+		{
+			if(const auto c = state.evaluateConstant(v.source))
+			{
+				if(const auto r = calculateUnary(v.op, *c))
+				{
+					ret = std::make_shared<Copy>(v.target, std::make_shared<Constant>(v.target->type, *r));
+				}
+			}
+		},
 		[&](const Call& v)
 		{
 			bool changed = false;
@@ -244,15 +219,23 @@ static inline std::shared_ptr<Operation> substituteOperation(const ConstnessAnal
 		},
 		[&](const Binary& v)
 		{
-			if(auto f = state.getStoredConstantValue(v.first))
+			// The result is known to the readers of the target already, but it may be live across a loop.
+			if(const auto f = state.evaluateConstant(v.first), s = state.evaluateConstant(v.second); f && s)
 			{
-				/* should be processed as constant already if both args are constant */
-				ret = std::make_shared<Binary>(v.target, std::make_shared<Constant>(v.first->type, *f), v.second, v.op);
+				if(const auto r = calculateBinary(v.op, *f, *s))
+				{
+					ret = std::make_shared<Copy>(v.target, std::make_shared<Constant>(v.target->type, *r));
+					return;
+				}
 			}
 
-			if(auto s = state.getStoredConstantValue(v.second))
+			const auto f = state.getStoredConstantValue(v.first), s = state.getStoredConstantValue(v.second);
+
+			if(f || s)
 			{
-				ret = std::make_shared<Binary>(v.target, v.first, std::make_shared<Constant>(v.first->type, *s), v.op);
+				ret = std::make_shared<Binary>(v.target,
+						f ? std::make_shared<Constant>(v.first->type, *f) : v.first,
+						s ? std::make_shared<Constant>(v.second->type, *s) : v.second, v.op);
 			}
 		},
 	});
@@ -267,6 +250,7 @@ static inline std::shared_ptr<Termination> substituteTermination(const Constness
 	t->accept(overloaded
 	{
 		[&](const Leave& v) {},
+		[&](const Throw& v) {},
 		[&](const Always& v) {},
 		[&](const Conditional& v)
 		{
@@ -304,11 +288,27 @@ static inline std::map<std::shared_ptr<BasicBlock>, ConstnessAnalysis> runAnalys
 		{
 			ConstnessAnalysis state = ret[bb];
 
-			std::for_each(bb->code.begin(), bb->code.end(), [&](const auto& o){ examineOperation(state, o); });
+			// The handler can be entered with the state from before any of the operations.
+			const auto mergeIntoHandler = [&]()
+			{
+				if(bb->handler)
+				{
+					changed = ret[bb->handler].mergeWith(state) || changed;
+				}
+			};
+
+			mergeIntoHandler();
+
+			std::for_each(bb->code.begin(), bb->code.end(), [&](const auto& o)
+			{
+				examineOperation(state, o);
+				mergeIntoHandler();
+			});
 
 			bb->termination->accept(overloaded
 			{
 				[&](const Leave& v){},
+				[&](const Throw& v){},
 				[&](const Always& v)
 				{
 					changed = changed || ret[v.continuation].mergeWith(state);
@@ -350,15 +350,16 @@ static inline bool substitute(const std::map<std::shared_ptr<BasicBlock>, Constn
 	{
 		ConstnessAnalysis state = anal.find(bb)->second;
 
+		// The operands are read before the operation writes its target, which may be one of them.
 		std::for_each(bb->code.begin(), bb->code.end(), [&](auto& o)
 		{
-			examineOperation(state, o);
-
 			if(auto s = substituteOperation(state, o))
 			{
 				o = s;
 				ret = true;
 			}
+
+			examineOperation(state, o);
 		});
 
 		if(auto s = substituteTermination(state, bb->termination))
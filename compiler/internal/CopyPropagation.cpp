@@ -0,0 +1,444 @@
+#include "Compiler.h"
+#include "Liveness.h"
+
+#include "compiler/ir/Temporary.h"
+#include "compiler/ir/Operations.h"
+#include "compiler/ir/Terminations.h"
+
+#include "Overloaded.h"
+
+#include <map>
+#include <set>
+#include <functional>
+
+using namespace comp;
+using namespace comp::ir;
+
+typedef std::function<std::shared_ptr<Variable>(const std::shared_ptr<Variable>&)> Renaming;
+
+/*
+ * Copying between variables of different types (another class or element type, or a different
+ * primitive) is left alone, as the variables can not simply stand in for each other.
+ */
+static inline bool isSameKind(const ast::ValueType& a, const ast::ValueType& b)
+{
+	if(a.kind != b.kind)
+	{
+		return false;
+	}
+
+	if(a.kind == ast::TypeKind::Value)
+	{
+		return a.primitiveType == b.primitiveType;
+	}
+
+	if(a.isArray() || b.isArray())
+	{
+		return a.isArray() && b.isArray() && isSameKind(*a.elementType, *b.elementType);
+	}
+
+	return a.referenceType == b.referenceType;
+}
+
+static inline std::shared_ptr<Variable> asCopiedVariable(const Copy& c)
+{
+	auto ret = std::dynamic_pointer_cast<Variable>(c.source);
+	return (ret && ret != c.target && isSameKind(ret->type, c.target->type)) ? ret : nullptr;
+}
+
+/*
+ * Rebuilds the operation with the variables read and the ones written mapped, null if none is changed.
+ */
+static inline std::shared_ptr<Operation> rename(const std::shared_ptr<Operation> &o, const Renaming& read, const Renaming& write)
+{
+	bool changed = false;
+
+	const auto map = [&](const Renaming& m, const auto& t)
+	{
+		std::decay_t<decltype(t)> ret = t;
+
+		if(auto v = std::dynamic_pointer_cast<Variable>(t))
+		{
+			ret = m(v);
+			changed = changed || ret != t;
+		}
+
+		return ret;
+	};
+
+	const auto r = [&](const auto& t){ return map(read, t); };
+	const auto w = [&](const auto& t){ return map(write, t); };
+
+	std::shared_ptr<Operation> ret;
+
+	o->accept(overloaded
+	{
+		[&](const Copy& v) { ret = std::make_shared<Copy>(w(v.target), r(v.source)); },
+		[&](const Unary& v) { ret = std::make_shared<Unary>(w(v.target), r(v.source), v.op); },
+		[&](const Create& v) { ret = std::make_shared<Create>(w(v.target), v.type); },
+		[&](const LoadField& v) { ret = std::make_shared<LoadField>(w(v.target), r(v.object), v.field); },
+		[&](const StoreField& v) { ret = std::make_shared<StoreField>(r(v.source), r(v.object), v.field); },
+		[&](const LoadGlobal& v) { ret = std::make_shared<LoadGlobal>(w(v.target), v.field); },
+		[&](const StoreGlobal& v) { ret = std::make_shared<StoreGlobal>(r(v.source), v.field); },
+		[&](const CreateArray& v) { ret = std::make_shared<CreateArray>(w(v.target), r(v.length)); },
+		[&](const LoadElement& v) { ret = std::make_shared<LoadElement>(w(v.target), r(v.array), r(v.index)); },
+		[&](const StoreElement& v) { ret = std::make_shared<StoreElement>(r(v.source), r(v.array), r(v.index)); },
+		[&](const ArrayLength& v) { ret = std::make_shared<ArrayLength>(w(v.target), r(v.array)); },
+		[&](const Binary& v) { ret = std::make_shared<Binary>(w(v.target), r(v.first), r(v.second), v.op); },
+		[&](const Call& v)
+		{
+			std::vector<std::shared_ptr<Temporary>> args;
+			std::vector<std::shared_ptr<Variable>> rets;
+			std::transform(v.arg.begin(), v.arg.end(), std::back_inserter(args), r);
+			std::transform(v.ret.begin(), v.ret.end(), std::back_inserter(rets), w);
+			ret = std::make_shared<Call>(args, rets, v.fn);
+		},
+		[&](const Catch& v) { ret = std::make_shared<Catch>(w(v.target)); },
+	});
+
+	return changed ? ret : nullptr;
+}
+
+static inline std::shared_ptr<Termination> rename(const std::shared_ptr<Termination> &t, const Renaming& read)
+{
+	bool changed = false;
+
+	const auto r = [&](const std::shared_ptr<Temporary>& t)
+	{
+		std::shared_ptr<Temporary> ret = t;
+
+		if(auto v = std::dynamic_pointer_cast<Variable>(t))
+		{
+			ret = read(v);
+			changed = changed || ret != t;
+		}
+
+		return ret;
+	};
+
+	std::shared_ptr<Termination> ret;
+
+	t->accept(overloaded
+	{
+		[&](const Always& v) {},
+		[&](const Conditional& v) { ret = std::make_shared<Conditional>(v.condition, r(v.first), r(v.second), v.then, v.otherwise); },
+		[&](const Leave& v)
+		{
+			std::vector<std::shared_ptr<Temporary>> rets;
+			std::transform(v.ret.begin(), v.ret.end(), std::back_inserter(rets), r);
+			ret = std::make_shared<Leave>(rets);
+		},
+		[&](const Throw& v) { ret = std::make_shared<Throw>(r(v.exception)); },
+	});
+
+	return changed ? ret : nullptr;
+}
+
+/*
+ * Copies between variables that hold on every path to a point: neither side was written since the
+ * copy was made. Kept by target, with the original source (the sources are never targets themselves).
+ */
+class AvailableCopies
+{
+	std::map<std::shared_ptr<Variable>, std::shared_ptr<Variable>> copies;
+	bool reached = false;
+
+	void kill(const std::shared_ptr<Variable>& v)
+	{
+		copies.erase(v);
+
+		for(auto it = copies.begin(); it != copies.end();)
+		{
+			it = (it->second == v) ? copies.erase(it) : std::next(it);
+		}
+	}
+
+public:
+	std::shared_ptr<Variable> resolve(const std::shared_ptr<Variable>& v) const
+	{
+		const auto it = copies.find(v);
+		return (it != copies.end()) ? it->second : v;
+	}
+
+	void apply(const std::shared_ptr<Operation>& o)
+	{
+		std::shared_ptr<Variable> target, source;
+
+		if(auto c = std::dynamic_pointer_cast<Copy>(o))
+		{
+			if(auto s = asCopiedVariable(*c))
+			{
+				target = c->target;
+				source = resolve(s);
+			}
+		}
+
+		const auto d = getDelta(o);
+		std::for_each(d.written.begin(), d.written.end(), [&](const auto& v){ kill(v); });
+
+		if(target && source != target)
+		{
+			copies[target] = source;
+		}
+	}
+
+	// Intersection of the copies available on the incoming paths.
+	bool mergeWith(const AvailableCopies& other)
+	{
+		if(!reached)
+		{
+			copies = other.copies;
+			reached = true;
+			return true;
+		}
+
+		bool ret = false;
+
+		for(auto it = copies.begin(); it != copies.end();)
+		{
+			if(const auto o = other.copies.find(it->first); o == other.copies.end() || o->second != it->second)
+			{
+				it = copies.erase(it);
+				ret = true;
+			}
+			else
+			{
+				it++;
+			}
+		}
+
+		return ret;
+	}
+};
+
+static inline std::map<std::shared_ptr<BasicBlock>, AvailableCopies> runAnalysis(const std::shared_ptr<ir::Function> &f)
+{
+	bool changed;
+	std::map<std::shared_ptr<BasicBlock>, AvailableCopies> ret;
+	ret[f->entry].mergeWith({});
+
+	do
+	{
+		changed = false;
+
+		f->traverse([&](std::shared_ptr<BasicBlock> bb)
+		{
+			AvailableCopies state = ret[bb];
+
+			// The handler can be entered with the state from before any of the operations.
+			const auto mergeIntoHandler = [&]()
+			{
+				if(bb->handler)
+				{
+					changed = ret[bb->handler].mergeWith(state) || changed;
+				}
+			};
+
+			mergeIntoHandler();
+
+			std::for_each(bb->code.begin(), bb->code.end(), [&](const auto& o)
+			{
+				state.apply(o);
+				mergeIntoHandler();
+			});
+
+			bb->termination->accept(overloaded
+			{
+				[&](const Leave& v){},
+				[&](const Throw& v){},
+				[&](const Always& v)
+				{
+					changed = ret[v.continuation].mergeWith(state) || changed;
+				},
+				[&](const Conditional& v)
+				{
+					changed = ret[v.then].mergeWith(state) || changed;
+					changed = ret[v.otherwise].mergeWith(state) || changed;
+				}
+			});
+		});
+	} while(changed);
+
+	return ret;
+}
+
+static inline bool substitute(const std::map<std::shared_ptr<BasicBlock>, AvailableCopies> &anal, const std::shared_ptr<ir::Function> &f)
+{
+	bool ret = false;
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		AvailableCopies state = anal.find(bb)->second;
+		const auto read = [&](const std::shared_ptr<Variable>& v){ return state.resolve(v); };
+		const auto same = [](const std::shared_ptr<Variable>& v){ return v; };
+
+		std::for_each(bb->code.begin(), bb->code.end(), [&](auto& o)
+		{
+			if(auto s = rename(o, read, same))
+			{
+				o = s;
+				ret = true;
+			}
+
+			state.apply(o);
+		});
+
+		if(auto s = rename(bb->termination, read))
+		{
+			bb->termination = s;
+			ret = true;
+		}
+	});
+
+	return ret;
+}
+
+/*
+ * Reads of the targets of copies are replaced with the sources, while both still hold the same
+ * value, which leaves the copies dead if all of them could be.
+ */
+bool Compiler::propagateCopies(std::shared_ptr<ir::Function> f)
+{
+	bool ret = false;
+
+	while(substitute(runAnalysis(f), f))
+	{
+		ret = true;
+	}
+
+	return ret;
+}
+
+/*
+ * Pairs of variables live at the same time, apart from the target of a copy and its source
+ * right after the copy, as they hold the same value there.
+ */
+static inline std::map<std::shared_ptr<Temporary>, std::set<std::shared_ptr<Temporary>>> findInterferences(const std::shared_ptr<ir::Function> &f)
+{
+	std::map<std::shared_ptr<Temporary>, std::set<std::shared_ptr<Temporary>>> ret;
+	const auto anal = analyzeLiveness(f);
+
+	const auto add = [&](const std::shared_ptr<Temporary>& a, const std::shared_ptr<Temporary>& b)
+	{
+		if(a != b)
+		{
+			ret[a].insert(b);
+			ret[b].insert(a);
+		}
+	};
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		LivenessAnalysis state = calculateAtExitPoint(anal, bb->termination);
+		keepHandlerInputs(anal, bb, state);
+
+		for(auto it = bb->code.rbegin(); it != bb->code.rend(); it++)
+		{
+			const auto d = getDelta(*it);
+			const auto c = std::dynamic_pointer_cast<Copy>(*it);
+			const auto source = c ? c->source : nullptr;
+
+			for(const auto& w: d.written)
+			{
+				std::for_each(state.liveVariables.begin(), state.liveVariables.end(), [&](const auto& l){ if(l != source) add(w, l); });
+				std::for_each(d.written.begin(), d.written.end(), [&](const auto& o){ add(w, o); });
+			}
+
+			state.apply(d);
+			keepHandlerInputs(anal, bb, state);
+		}
+	});
+
+	// The arguments and anything read before being written are all set at the entry.
+	std::set<std::shared_ptr<Temporary>> entry(f->args.begin(), f->args.end());
+
+	if(auto it = anal.find(f->entry); it != anal.end())
+	{
+		entry.insert(it->second.liveVariables.begin(), it->second.liveVariables.end());
+	}
+
+	for(const auto& a: entry)
+	{
+		std::for_each(entry.begin(), entry.end(), [&](const auto& b){ add(a, b); });
+	}
+
+	return ret;
+}
+
+/*
+ * The target and the source of a copy that do not interfere are merged into a single variable,
+ * which makes the copy a no-op. The arguments are kept as they are.
+ */
+bool Compiler::coalesceCopies(std::shared_ptr<ir::Function> f)
+{
+	auto interferences = findInterferences(f);
+	const std::set<std::shared_ptr<Variable>> args(f->args.begin(), f->args.end());
+	std::map<std::shared_ptr<Variable>, std::shared_ptr<Variable>> mergedInto;
+
+	const std::function<std::shared_ptr<Variable>(const std::shared_ptr<Variable>&)> find = [&](const auto& v)
+	{
+		const auto it = mergedInto.find(v);
+		return (it != mergedInto.end()) ? find(it->second) : v;
+	};
+
+	bool ret = false;
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		for(const auto& o: bb->code)
+		{
+			const auto c = std::dynamic_pointer_cast<Copy>(o);
+			const auto s = c ? asCopiedVariable(*c) : nullptr;
+
+			if(!s)
+			{
+				continue;
+			}
+
+			const auto a = find(c->target), b = find(s);
+
+			if(a == b)
+			{
+				ret = true;
+				continue;
+			}
+
+			auto &ia = interferences[a], &ib = interferences[b];
+			const auto interferes = [&](const auto& n){ return find(std::static_pointer_cast<Variable>(n)) == b; };
+
+			if((args.count(a) && args.count(b)) || std::any_of(ia.begin(), ia.end(), interferes))
+			{
+				continue;
+			}
+
+			const auto [kept, dropped] = args.count(a) ? std::make_pair(a, b) : std::make_pair(b, a);
+			mergedInto[dropped] = kept;
+			(kept == a ? ia : ib).insert((kept == a ? ib : ia).begin(), (kept == a ? ib : ia).end());
+			ret = true;
+		}
+	});
+
+	if(ret)
+	{
+		f->traverse([&](std::shared_ptr<BasicBlock> bb)
+		{
+			for(auto it = bb->code.begin(); it != bb->code.end();)
+			{
+				if(auto s = rename(*it, find, find))
+				{
+					*it = s;
+				}
+
+				const auto c = std::dynamic_pointer_cast<Copy>(*it);
+				it = (c && c->source == c->target) ? bb->code.erase(it) : std::next(it);
+			}
+
+			if(auto s = rename(bb->termination, find))
+			{
+				bb->termination = s;
+			}
+		});
+	}
+
+	return ret;
+}
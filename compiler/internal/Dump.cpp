@@ -3,6 +3,7 @@
 #include "compiler/ir/Function.h"
 
 #include <sstream>
+#include <iterator>
 #include <algorithm>
 
 using namespace comp;
@@ -36,15 +37,49 @@ std::string Compiler::dumpAst()
 
 std::string Compiler::dumpCfg(Options opt)
 {
-	std::vector<std::string> parts;
+	std::vector<Statistics> stats(gi.functions.size());
 
-	std::transform(gi.functions.begin(), gi.functions.end(), std::back_inserter(parts), [&](const auto &f)
+	const auto parts = forEachFunction([&](size_t idx)
 	{
-		auto ir = generateIr(f);
-		optimizeIr(ir, opt);
+		const auto key = cache ? getCacheKey(idx, opt) + ".cfg" : std::string();
+
+		if(cache)
+		{
+			if(const auto entry = cache->load(key))
+			{
+				std::stringstream ss(*entry);
+				std::string line, rule;
+				std::getline(ss, line);
+
+				std::stringstream header(line);
+				header >> stats[idx].eliminatedAllocations >> stats[idx].unrolledLoops >> stats[idx].partiallyUnrolledLoops;
+
+				for(size_t n; header >> rule >> n;)
+				{
+					stats[idx].simplifications[rule] = n;
+				}
+
+				return std::string(std::istreambuf_iterator<char>(ss), std::istreambuf_iterator<char>());
+			}
+		}
+
+		auto ir = generateIr(gi.functions[idx]);
+		optimizeIr(ir, opt, unrollBudget, stats[idx]);
+		auto ret = ir->dump(gi);
+
+		if(cache)
+		{
+			// The statistics are on the first line: the eliminated allocations, the unrolled loops, then the rules applied with their counts.
+			std::stringstream ss;
+			ss << stats[idx].eliminatedAllocations << " " << stats[idx].unrolledLoops << " " << stats[idx].partiallyUnrolledLoops;
+			std::for_each(stats[idx].simplifications.begin(), stats[idx].simplifications.end(), [&](const auto& p){ ss << " " << p.first << " " << p.second; });
+			ss << "\n" << ret;
+			cache->store(key, ss.str());
+		}
 
-		return ir->dump(gi);
+		return ret;
 	});
 
+	std::for_each(stats.begin(), stats.end(), [&](const auto& s){ statistics += s; });
 	return join(parts);
 }
@@ -0,0 +1,113 @@
+#include "Compiler.h"
+#include "Arithmetic.h"
+
+#include "compiler/ir/Function.h"
+#include "compiler/ir/BasicBlock.h"
+#include "compiler/ir/Operations.h"
+#include "compiler/ir/Terminations.h"
+
+#include "Overloaded.h"
+
+#include <map>
+
+using namespace comp;
+using namespace comp::ir;
+
+std::optional<Compiler::Execution> Compiler::execute(size_t functionIdx, const std::vector<int>& args, Options opt, size_t maxSteps) const
+{
+	auto ir = generateIr(gi.functions[functionIdx]);
+	Statistics stats;
+	optimizeIr(ir, opt, unrollBudget, stats);
+
+	if(args.size() != ir->args.size())
+	{
+		return {};
+	}
+
+	std::map<std::shared_ptr<Variable>, int> values;
+	std::map<std::pair<std::shared_ptr<ast::Class>, uint32_t>, int> statics; // Zero until stored
+
+	for(size_t i = 0; i < args.size(); i++)
+	{
+		values[ir->args[i]] = args[i];
+	}
+
+	const auto read = [&](const std::shared_ptr<Temporary>& t)
+	{
+		if(const auto c = std::dynamic_pointer_cast<Constant>(t))
+		{
+			return c->value;
+		}
+
+		return values[std::static_pointer_cast<Variable>(t)];
+	};
+
+	Execution ret;
+
+	for(auto bb = ir->entry; bb && ret.nOperations + ret.nBranches + ret.nJumps < maxSteps;)
+	{
+		for(const auto& o: bb->code)
+		{
+			bool ok = true;
+
+			o->accept(overloaded
+			{
+				[&](const Copy& v) { values[v.target] = read(v.source); },
+				[&](const Unary& v)
+				{
+					const auto r = calculateUnary(v.op, read(v.source));
+					ok = r.has_value();
+					values[v.target] = r.value_or(0);
+				},
+				[&](const Binary& v)
+				{
+					const auto r = calculateBinary(v.op, read(v.first), read(v.second));
+					ok = r.has_value();
+					values[v.target] = r.value_or(0);
+				},
+				[&](const LoadGlobal& v) { values[v.target] = statics[{v.field.type, v.field.index}]; },
+				[&](const StoreGlobal& v) { statics[{v.field.type, v.field.index}] = read(v.source); },
+				[&](const Operation&) { ok = false; },
+			});
+
+			if(!ok)
+			{
+				return {};
+			}
+
+			ret.nOperations++;
+		}
+
+		std::shared_ptr<BasicBlock> next;
+		bool done = false;
+
+		bb->termination->accept(overloaded
+		{
+			[&](const Always& t)
+			{
+				next = t.continuation;
+				ret.nJumps++;
+			},
+			[&](const Conditional& t)
+			{
+				next = calculateCondition(t.condition, read(t.first), read(t.second)) ? t.then : t.otherwise;
+				ret.nBranches++;
+			},
+			[&](const Leave& t)
+			{
+				std::transform(t.ret.begin(), t.ret.end(), std::back_inserter(ret.ret), read);
+				done = true;
+			},
+			[&](const Throw&) {},
+		});
+
+		if(done)
+		{
+			return ret;
+		}
+
+		bb = next;
+	}
+
+	return {};
+}
@@ -72,12 +72,118 @@ struct Context: IrBuilder
 		return args[idx];
 	}
 
-	inline std::shared_ptr<Variable> operator()(std::shared_ptr<const ast::RValue> val, std::shared_ptr<Variable> ret = {})
+	/*
+	 * Ends the current block with a jump to the first block if the logical value holds, to the
+	 * second otherwise. The comparisons are jumped on directly, negations by swapping the targets
+	 * and the operands of And and Or are tested one after the other, short-circuiting to either.
+	 */
+	void decide(std::shared_ptr<const ast::RValue> val, std::shared_ptr<BasicBlock> then, std::shared_ptr<BasicBlock> otherwise)
 	{
-		if(!ret)
+		const auto test = [&]()
 		{
-			ret = std::make_shared<Variable>(val->getType());
+			const auto v = (*this)(val);
+			jump(Conditional::Condition::Eq, v, std::make_shared<Constant>(ast::ValueType::logical(), 1), then, otherwise);
+		};
+
+		val->accept(overloaded
+		{
+			[&](const ast::Unary& v)
+			{
+				if(v.op == ast::Unary::Operation::Not)
+				{
+					decide(v.arg, otherwise, then);
+				}
+				else
+				{
+					test();
+				}
+			},
+			[&](const ast::Binary& v)
+			{
+				switch(v.op)
+				{
+					case ast::Binary::Operation::Eq:
+					case ast::Binary::Operation::Ne:
+					case ast::Binary::Operation::LtI:
+					case ast::Binary::Operation::GtI:
+					case ast::Binary::Operation::LeI:
+					case ast::Binary::Operation::GeI:
+					case ast::Binary::Operation::LtU:
+					case ast::Binary::Operation::GtU:
+					case ast::Binary::Operation::LeU:
+					case ast::Binary::Operation::GeU:
+					case ast::Binary::Operation::LtF:
+					case ast::Binary::Operation::GtF:
+					case ast::Binary::Operation::LeF:
+					case ast::Binary::Operation::GeF:
+					{
+						const auto first = (*this)(v.first);
+						jump(mapConditionalOp(v.op), first, (*this)(v.second), then, otherwise);
+						break;
+					}
+					case ast::Binary::Operation::And:
+					{
+						const auto next = block();
+						decide(v.first, next, otherwise);
+						enter(next);
+						decide(v.second, then, otherwise);
+						break;
+					}
+					case ast::Binary::Operation::Or:
+					{
+						const auto next = block();
+						decide(v.first, then, next);
+						enter(next);
+						decide(v.second, then, otherwise);
+						break;
+					}
+					default:
+						test();
+				}
+			},
+			[&](const ast::RValue&) { test(); }
+		});
+	}
+
+	inline auto decision(std::shared_ptr<const ast::RValue> val) {
+		return [this, val](auto then, auto otherwise){ decide(val, then, otherwise); };
+	}
+
+	// Logical values computed by the operators are only produced by branching on them.
+	void materialize(std::shared_ptr<const ast::RValue> val, std::shared_ptr<Variable> ret) {
+		branch(decision(val), [&](){ addLiteral(ret, 1); }, [&](){ addLiteral(ret, 0); });
+	}
+
+	/*
+	 * The statics are kept as full values, so the ones of a narrow type are truncated and extended
+	 * when stored, the same way as a packed field would do it.
+	 */
+	std::shared_ptr<Variable> narrow(std::shared_ptr<Variable> val, const ast::ValueType& type)
+	{
+		const auto binary = [&](Binary::Op op, int c)
+		{
+			const auto ret = std::make_shared<Variable>(ast::ValueType::integer());
+			addOp(std::make_shared<Binary>(ret, val, std::make_shared<Constant>(ast::ValueType::integer(), c), op));
+			return val = ret;
+		};
+
+		switch(type.primitiveType)
+		{
+			case ast::PrimitiveType::Uint8: return binary(Binary::Op::AndI, 0xff);
+			case ast::PrimitiveType::Uint16: return binary(Binary::Op::AndI, 0xffff);
+			case ast::PrimitiveType::Int8: binary(Binary::Op::ShlI, 24); return binary(Binary::Op::ShrI, 24);
+			case ast::PrimitiveType::Int16: binary(Binary::Op::ShlI, 16); return binary(Binary::Op::ShrI, 16);
+			default: return val;
 		}
+	}
+
+	/*
+	 * Evaluates the value into the given variable or a new one. The value of a local, argument or
+	 * assignment is in the variable already holding it, which is then copied into the one requested.
+	 */
+	inline std::shared_ptr<Variable> operator()(std::shared_ptr<const ast::RValue> val, std::shared_ptr<Variable> target = {})
+	{
+		auto ret = target ? target : std::make_shared<Variable>(val->getType());
 
 		val->accept(overloaded
 		{
@@ -87,11 +193,18 @@ struct Context: IrBuilder
 			[&](const ast::Create& v) { addOp(std::make_shared<Create>(ret, v.type)); },
 			[&](const ast::Literal& v) { addOp(std::make_shared<Copy>(ret, std::make_shared<Constant>(v.getType(), v.integer))); },
 			[&](const ast::Dereference& v) { addOp(std::make_shared<LoadField>(ret, (*this)(v.object), v.field)); },
+			[&](const ast::CreateArray& v) { addOp(std::make_shared<CreateArray>(ret, (*this)(v.length))); },
+			[&](const ast::Length& v) { addOp(std::make_shared<ArrayLength>(ret, (*this)(v.array))); },
+			[&](const ast::Element& v)
+			{
+				const auto array = (*this)(v.array);
+				addOp(std::make_shared<LoadElement>(ret, array, (*this)(v.index)));
+			},
 			[&](const ast::Unary& v)
 			{
 				if(v.op == ast::Unary::Operation::Not)
 				{
-					branch((*this)(v.arg), [&](){ addLiteral(ret, 0); }, [&](){ addLiteral(ret, 1); });
+					materialize(val, ret);
 				}
 				else
 				{
@@ -116,20 +229,16 @@ struct Context: IrBuilder
 					case ast::Binary::Operation::GtF:
 					case ast::Binary::Operation::LeF:
 					case ast::Binary::Operation::GeF:
-						condToBool(ret, mapConditionalOp(v.op), (*this)(v.first), (*this)(v.second));
-						break;
 					case ast::Binary::Operation::And:
-						branch((*this)(v.first), [&](){ addOp(std::make_shared<Copy>(ret, (*this)(v.second))); }, [&](){ addLiteral(ret, 0); });
-						break;
 					case ast::Binary::Operation::Or:
-						branch((*this)(v.first), [&](){ addLiteral(ret, 1); }, [&](){ addOp(std::make_shared<Copy>(ret, (*this)(v.second))); });
+						materialize(val, ret);
 						break;
 					default:
 						addOp(std::make_shared<Binary>(ret, (*this)(v.first), (*this)(v.second), mapBinaryOp(v.op)));
 				}
 			},
 			[&](const ast::Ternary& v) {
-				branch((*this)(v.condition), [&](){ addOp(std::make_shared<Copy>(ret, (*this)(v.then))); }, [&](){ addOp(std::make_shared<Copy>(ret, (*this)(v.otherwise))); });
+				branch(decision(v.condition), [&](){ (*this)(v.then, ret); }, [&](){ (*this)(v.otherwise, ret); });
 			},
 			[&](const ast::Call& v)
 			{
@@ -153,7 +262,7 @@ struct Context: IrBuilder
 					[&](const ast::Argument& d){ ret = (*this)(v.value, arg(d.idx)); },
 					[&](const ast::Global& d) {
 						ret = (*this)(v.value);
-						addOp(std::make_shared<StoreGlobal>(ret, d.field));
+						addOp(std::make_shared<StoreGlobal>(narrow(ret, d.field.getType()), d.field));
 					},
 					[&](const ast::Dereference& d)
 					{
@@ -161,11 +270,24 @@ struct Context: IrBuilder
 						ret = (*this)(v.value);
 						addOp(std::make_shared<StoreField>(ret, object, d.field));
 					},
+					[&](const ast::Element& d)
+					{
+						const auto array = (*this)(d.array);
+						const auto index = (*this)(d.index);
+						ret = (*this)(v.value);
+						addOp(std::make_shared<StoreElement>(ret, array, index));
+					},
 					[&](const ast::RValue& o){ assert(false); }
 				});
 			},
 		});
 
+		if(target && ret != target)
+		{
+			addOp(std::make_shared<Copy>(target, ret));
+			return target;
+		}
+
 		return ret;
 	}
 
@@ -177,7 +299,7 @@ struct Context: IrBuilder
 				(*this)(v.val);
 			},
 			[&](const ast::Declaration& v) {
-				addLocal(v.local, (*this)(v.initializer));
+				addLocal(v.local, (*this)(v.initializer, std::make_shared<Variable>(v.local->type)));
 			},
 			[&](const ast::Block& v)
 			{
@@ -194,7 +316,7 @@ struct Context: IrBuilder
 			},
 			[&](const ast::Conditional& v)
 			{
-				branch((*this)(v.condition),
+				branch(decision(v.condition),
 				[&](){ (*this)(v.then); },
 				[&](){ (*this)(v.otherwise); });
 			},
@@ -207,6 +329,16 @@ struct Context: IrBuilder
 			},
 			[&](const ast::Continue& v) { continueLoop(v.loop.get()); },
 			[&](const ast::Break& v) { breakLoop(v.loop.get()); },
+			[&](const ast::Throw& v) { raise((*this)(v.value)); },
+			[&](const ast::Try& v)
+			{
+				const auto exception = std::make_shared<Variable>(v.exception->type);
+				addLocal(v.exception, exception);
+
+				guard(exception,
+				[&](){ (*this)(v.body); },
+				[&](){ (*this)(v.handler); });
+			},
 		});
 	}
 };
@@ -21,9 +21,13 @@ bool Compiler::removeEmptyBasicBlocks(std::shared_ptr<Function> f)
 		bb->termination->accept(overloaded
 		{
 			[&](const Leave&){},
+			[&](const Throw&){},
 			[&](const Always &t)
 			{
-				if(t.continuation->code.empty() && !t.isBackEdge)
+				// A throw taken over would be caught by the handler of this block instead.
+				const bool isThrowMoved = t.continuation->handler != bb->handler && std::dynamic_pointer_cast<Throw>(t.continuation->termination);
+
+				if(t.continuation->code.empty() && !t.isBackEdge && !isThrowMoved)
 				{
 					bb->termination = t.continuation->termination;
 					ret = true;
@@ -71,9 +75,15 @@ bool Compiler::mergeBasicBlocks(std::shared_ptr<Function> f)
 
 	f->traverse([&](std::shared_ptr<BasicBlock> bb)
 	{
+		if(bb->handler)
+		{
+			consider(bb->handler);
+		}
+
 		bb->termination->accept(overloaded
 		{
 			[&](const Leave&){},
+			[&](const Throw&){},
 			[&](const Always &t) { consider(t.continuation); },
 			[&](const Conditional& t) { consider(t.then); consider(t.otherwise); },
 		});
@@ -88,16 +98,20 @@ bool Compiler::mergeBasicBlocks(std::shared_ptr<Function> f)
 			{
 				[&](const Conditional&) {},
 				[&](const Leave&) {},
+				[&](const Throw&) {},
 				[&](const Always &t)
 				{
-					if(ok.find(t.continuation) != ok.end())
+					// Kept, as the termination goes away when replaced.
+					const auto continuation = t.continuation;
+
+					if(ok.find(continuation) != ok.end() && continuation->handler == bb->handler)
 					{
-						std::copy(t.continuation->code.begin(), t.continuation->code.end(), std::back_inserter(bb->code));
-						bb->termination = t.continuation->termination;
+						std::copy(continuation->code.begin(), continuation->code.end(), std::back_inserter(bb->code));
+						bb->termination = continuation->termination;
 						ret = true;
 					}
 
-					consider(t.continuation);
+					consider(continuation);
 				},
 			});
 		});
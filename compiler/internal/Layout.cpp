@@ -0,0 +1,22 @@
+#include "Compiler.h"
+
+using namespace comp;
+
+/*
+ * The static object is accessed through global operands, which work on full values only,
+ * so only the fields of the instances get packed. The narrow statics are truncated on the
+ * stores instead (see IrGen), so they read back the same as the packed fields.
+ */
+std::vector<prog::TypeInfo> Compiler::generateTypes()
+{
+	std::vector<prog::TypeInfo> ret;
+
+	for(const auto &c: gi.classes)
+	{
+		const auto l = c->getLayout(c != gi.classes.front());
+		const auto baseIdx = c->base ? gi.getClassIndex(c->base.get()) : 0;
+		ret.push_back(prog::TypeInfo(baseIdx, l.nReferences, l.nScalars, l.nBytes));
+	}
+
+	return ret;
+}
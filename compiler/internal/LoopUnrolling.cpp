@@ -0,0 +1,402 @@
+#include "Compiler.h"
+#include "Liveness.h"
+#include "Arithmetic.h"
+
+#include "compiler/ir/Function.h"
+#include "compiler/ir/BasicBlock.h"
+#include "compiler/ir/Operations.h"
+#include "compiler/ir/Terminations.h"
+
+#include "Overloaded.h"
+
+#include <map>
+#include <set>
+#include <optional>
+#include <algorithm>
+#include <functional>
+
+using namespace comp;
+using namespace comp::ir;
+
+// Loops running longer than this are not considered, their trip count is found by stepping through them.
+static constexpr size_t maxTripCount = 1 << 16;
+
+/*
+ * A loop without branches inside, entered from a single block into the header, and left by a
+ * single test on an induction variable against a constant. Each iteration runs the operations
+ * before the test, then stays in the loop for the ones after it or goes to the exit block.
+ */
+struct CountedLoop
+{
+	std::shared_ptr<BasicBlock> header, exit;
+	std::shared_ptr<Conditional> test;
+	std::vector<std::shared_ptr<Operation>> pre, post;
+	size_t tripCount; // Times the test stays in the loop
+};
+
+static inline std::optional<int> constant(const std::shared_ptr<Temporary>& t)
+{
+	if(auto c = std::dynamic_pointer_cast<Constant>(t))
+	{
+		return c->value;
+	}
+
+	return {};
+}
+
+static inline bool writes(const std::shared_ptr<Operation>& o, const std::shared_ptr<Variable>& v)
+{
+	const auto w = getDelta(o).written;
+	return std::find(w.begin(), w.end(), v) != w.end();
+}
+
+// The step if the operation is v ← v + c or v ← v - c.
+static inline std::optional<int> step(const std::shared_ptr<Operation>& o, const std::shared_ptr<Variable>& v)
+{
+	if(const auto b = std::dynamic_pointer_cast<Binary>(o); b && b->target == v)
+	{
+		if(b->op == Binary::Op::AddI && b->first == v && constant(b->second))
+		{
+			return *constant(b->second);
+		}
+		else if(b->op == Binary::Op::AddI && b->second == v && constant(b->first))
+		{
+			return *constant(b->first);
+		}
+		else if(b->op == Binary::Op::SubI && b->first == v && constant(b->second))
+		{
+			return (int)(0u - (unsigned)*constant(b->second));
+		}
+	}
+
+	return {};
+}
+
+/*
+ * Value of the variable on entering the loop, if it is a constant set on the only way there.
+ */
+static inline std::optional<int> initialValue(std::shared_ptr<BasicBlock> bb, const std::shared_ptr<Variable>& v,
+		const std::map<std::shared_ptr<BasicBlock>, std::vector<std::shared_ptr<BasicBlock>>>& predecessors)
+{
+	for(std::set<std::shared_ptr<BasicBlock>> seen; seen.insert(bb).second;)
+	{
+		for(auto it = bb->code.rbegin(); it != bb->code.rend(); it++)
+		{
+			if(writes(*it, v))
+			{
+				const auto c = std::dynamic_pointer_cast<Copy>(*it);
+				return c ? constant(c->source) : std::nullopt;
+			}
+		}
+
+		const auto p = predecessors.find(bb);
+
+		// Not through the exceptions, as the rest of the block may not have been run.
+		if(p == predecessors.end() || p->second.size() != 1 || p->second.front()->handler == bb)
+		{
+			break;
+		}
+
+		bb = p->second.front();
+	}
+
+	return {};
+}
+
+static std::optional<CountedLoop> analyze(const std::shared_ptr<BasicBlock>& latch, const std::shared_ptr<BasicBlock>& header,
+		const std::map<std::shared_ptr<BasicBlock>, std::vector<std::shared_ptr<BasicBlock>>>& predecessors,
+		const std::set<std::shared_ptr<BasicBlock>>& handlers)
+{
+	// The blocks that reach the latch without going through the header.
+	std::set<std::shared_ptr<BasicBlock>> body{header};
+	std::vector<std::shared_ptr<BasicBlock>> toDo{latch};
+
+	while(!toDo.empty())
+	{
+		const auto bb = toDo.back();
+		toDo.pop_back();
+
+		if(body.insert(bb).second)
+		{
+			const auto& p = predecessors.at(bb);
+			std::copy(p.begin(), p.end(), std::back_inserter(toDo));
+		}
+	}
+
+	std::shared_ptr<BasicBlock> preheader;
+
+	for(const auto& bb: body)
+	{
+		if(bb->handler || handlers.count(bb))
+		{
+			return {};
+		}
+
+		for(const auto& p: predecessors.at(bb))
+		{
+			if(!body.count(p))
+			{
+				if(bb != header || preheader)
+				{
+					return {};
+				}
+
+				preheader = p;
+			}
+		}
+	}
+
+	if(!preheader)
+	{
+		return {};
+	}
+
+	CountedLoop ret{header};
+	auto bb = header;
+
+	for(size_t n = 0; ; n++)
+	{
+		if(n == body.size())
+		{
+			return {};
+		}
+
+		auto& code = ret.test ? ret.post : ret.pre;
+		std::copy(bb->code.begin(), bb->code.end(), std::back_inserter(code));
+
+		std::shared_ptr<BasicBlock> next;
+		bool ok = true;
+
+		bb->termination->accept(overloaded
+		{
+			[&](const Leave&) { ok = false; },
+			[&](const Throw&) { ok = false; },
+			[&](const Always& t) { next = t.continuation; },
+			[&](const Conditional& t)
+			{
+				const bool stayIfThen = body.count(t.then), stayOtherwise = body.count(t.otherwise);
+
+				if(ret.test || stayIfThen == stayOtherwise)
+				{
+					ok = false;
+					return;
+				}
+
+				ret.test = std::static_pointer_cast<Conditional>(bb->termination);
+				ret.exit = stayIfThen ? t.otherwise : t.then;
+				next = stayIfThen ? t.then : t.otherwise;
+			},
+		});
+
+		if(!ok)
+		{
+			return {};
+		}
+
+		if(next == header)
+		{
+			if(bb != latch || n + 1 != body.size())
+			{
+				return {};
+			}
+
+			break;
+		}
+
+		bb = next;
+	}
+
+	if(!ret.test)
+	{
+		return {};
+	}
+
+	// The induction variable is compared against the bound, and stepped by a constant once per iteration.
+	const auto first = constant(ret.test->first), second = constant(ret.test->second);
+
+	if(!first == !second)
+	{
+		return {};
+	}
+
+	const auto iv = std::dynamic_pointer_cast<Variable>(first ? ret.test->second : ret.test->first);
+	std::optional<int> stride;
+	bool isSteppedBeforeTest = false;
+
+	for(const auto* code: {&ret.pre, &ret.post})
+	{
+		for(const auto& o: *code)
+		{
+			if(writes(o, iv))
+			{
+				if(stride || !(stride = step(o, iv)))
+				{
+					return {};
+				}
+
+				isSteppedBeforeTest = code == &ret.pre;
+			}
+		}
+	}
+
+	auto value = initialValue(preheader, iv, predecessors);
+
+	if(!stride || !value)
+	{
+		return {};
+	}
+
+	const bool stayIfThen = ret.exit == ret.test->otherwise;
+	const auto next = [&](int v) { return (int)((unsigned)v + (unsigned)*stride); };
+
+	for(ret.tripCount = 0; ret.tripCount <= maxTripCount; ret.tripCount++)
+	{
+		if(isSteppedBeforeTest)
+		{
+			value = next(*value);
+		}
+
+		const auto a = first ? *first : *value, b = second ? *second : *value;
+
+		if(calculateCondition(ret.test->condition, a, b) != stayIfThen)
+		{
+			return ret;
+		}
+
+		if(!isSteppedBeforeTest)
+		{
+			value = next(*value);
+		}
+	}
+
+	return {};
+}
+
+/*
+ * Unrolls the loops with a trip count known at compile time, entirely if the straight code
+ * replacing the loop fits the budget (in operations), or else by the largest factor that fits,
+ * with the iterations left over by the factor peeled off in front of the loop. The unrolled
+ * loop tests once per its iteration, as the other tests are known to pass.
+ */
+bool Compiler::unrollLoops(std::shared_ptr<ir::Function> f, size_t budget, Statistics& stats)
+{
+	std::map<std::shared_ptr<BasicBlock>, std::vector<std::shared_ptr<BasicBlock>>> predecessors;
+	std::set<std::shared_ptr<BasicBlock>> handlers;
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		predecessors[bb];
+
+		if(bb->handler)
+		{
+			handlers.insert(bb->handler);
+			predecessors[bb->handler].push_back(bb);
+		}
+
+		bb->termination->accept(overloaded
+		{
+			[&](const Leave&) {},
+			[&](const Throw&) {},
+			[&](const Always& t) { predecessors[t.continuation].push_back(bb); },
+			[&](const Conditional& t)
+			{
+				predecessors[t.then].push_back(bb);
+				predecessors[t.otherwise].push_back(bb);
+			},
+		});
+	});
+
+	// The edges to a block on the way to the one they leave, the loops may end in either kind of termination.
+	std::vector<std::pair<std::shared_ptr<BasicBlock>, std::shared_ptr<BasicBlock>>> backEdges;
+	std::set<std::shared_ptr<BasicBlock>> visited, active;
+
+	const std::function<void(const std::shared_ptr<BasicBlock>&)> visit = [&](const auto& bb)
+	{
+		const auto follow = [&](const std::shared_ptr<BasicBlock>& next)
+		{
+			if(active.count(next))
+			{
+				backEdges.push_back({bb, next});
+			}
+			else if(visited.insert(next).second)
+			{
+				visit(next);
+			}
+		};
+
+		active.insert(bb);
+
+		bb->termination->accept(overloaded
+		{
+			[&](const Leave&) {},
+			[&](const Throw&) {},
+			[&](const Always& t) { follow(t.continuation); },
+			[&](const Conditional& t) { follow(t.then); follow(t.otherwise); },
+		});
+
+		if(bb->handler && visited.insert(bb->handler).second)
+		{
+			visit(bb->handler);
+		}
+
+		active.erase(bb);
+	};
+
+	visited.insert(f->entry);
+	visit(f->entry);
+
+	for(const auto& e: backEdges)
+	{
+		const auto l = analyze(e.first, e.second, predecessors, handlers);
+
+		if(!l)
+		{
+			continue;
+		}
+
+		const auto size = l->pre.size() + l->post.size();
+		const auto iterations = [&](auto& code, size_t n)
+		{
+			for(size_t i = 0; i < n; i++)
+			{
+				std::copy(l->post.begin(), l->post.end(), std::back_inserter(code));
+				std::copy(l->pre.begin(), l->pre.end(), std::back_inserter(code));
+			}
+		};
+
+		// The blocks of the other loops may be changed, so they are left to the next run.
+		if(l->tripCount * size + l->pre.size() <= budget)
+		{
+			l->header->code = l->pre;
+			iterations(l->header->code, l->tripCount);
+			l->header->termination = std::make_shared<Always>(l->exit);
+			stats.unrolledLoops++;
+			return true;
+		}
+
+		for(size_t k = std::min(l->tripCount, size ? budget / size : 0); k >= 2; k--)
+		{
+			const auto peeled = l->tripCount % k;
+
+			if((k + peeled) * size + l->pre.size() <= budget)
+			{
+				const auto body = std::make_shared<BasicBlock>(), test = std::make_shared<BasicBlock>();
+				iterations(body->code, k);
+				body->termination = std::make_shared<Always>(test, true);
+
+				const auto& t = l->test;
+				const bool stayIfThen = l->exit == t->otherwise;
+				test->termination = std::make_shared<Conditional>(t->condition, t->first, t->second,
+						stayIfThen ? body : t->then, stayIfThen ? t->otherwise : body);
+
+				l->header->code = l->pre;
+				iterations(l->header->code, peeled);
+				l->header->termination = std::make_shared<Always>(test);
+				stats.partiallyUnrolledLoops++;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
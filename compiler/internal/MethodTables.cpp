@@ -0,0 +1,26 @@
+#include "Compiler.h"
+
+using namespace comp;
+
+/*
+ * Every class gets a complete table with the inherited entries resolved, so that a virtual
+ * call is a single lookup by slot for the type of the receiver.
+ */
+std::vector<std::vector<uint32_t>> Compiler::generateMethodTables()
+{
+	std::vector<std::vector<uint32_t>> ret;
+
+	for(const auto &c: gi.classes)
+	{
+		std::vector<uint32_t> table;
+
+		for(auto i = 0u; i < c->getMethodCount(); i++)
+		{
+			table.push_back((uint32_t)gi.getFunctionIndex(c->getMethod(i).get()));
+		}
+
+		ret.push_back(table);
+	}
+
+	return ret;
+}
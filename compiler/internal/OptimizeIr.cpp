@@ -2,16 +2,22 @@
 
 using namespace comp;
 
-void Compiler::optimizeIr(std::shared_ptr<ir::Function> ir, Options opt)
+void Compiler::optimizeIr(std::shared_ptr<ir::Function> ir, Options opt, size_t unrollBudget, Statistics& stats)
 {
-	bool changed;
+	if(opt & Options::replaceScalars) stats.eliminatedAllocations += replaceScalars(ir);
+
+	bool changed = true;
 	while(changed)
 	{
 		changed = false;
 
 		if((opt & Options::propagateConstants) && (changed = propagateConstants(ir))) continue;
+		if((opt & Options::simplifyOperations) && (changed = simplifyOperations(ir, stats))) continue;
+		if((opt & Options::propagateCopies) && (changed = propagateCopies(ir))) continue;
 		if((opt & Options::doJumpOptimizations) && (changed = mergeBasicBlocks(ir))) continue;
 		if((opt & Options::doJumpOptimizations) && (changed = removeEmptyBasicBlocks(ir))) continue;
+		if((opt & Options::propagateCopies) && (changed = coalesceCopies(ir))) continue;
+		if((opt & Options::unrollLoops) && (changed = unrollLoops(ir, unrollBudget, stats))) continue;
 	}
 
 	if(opt & Options::eliminateDeadCode) eliminateDeadCode(ir);
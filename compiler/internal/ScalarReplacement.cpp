@@ -0,0 +1,205 @@
+#include "Compiler.h"
+
+#include "compiler/ir/Temporary.h"
+#include "compiler/ir/Operations.h"
+#include "compiler/ir/Terminations.h"
+
+#include "Overloaded.h"
+
+#include <map>
+#include <set>
+
+using namespace comp;
+using namespace comp::ir;
+
+typedef std::pair<const ast::Class*, uint32_t> FieldKey;
+
+/*
+ * An object created in the function that is only ever used as the object of field accesses.
+ */
+struct Candidate
+{
+	std::shared_ptr<ast::Class> type;
+	std::map<FieldKey, std::shared_ptr<Variable>> fields;
+	bool replaceable = true;
+
+	std::shared_ptr<Variable> field(const ast::Field& f)
+	{
+		auto &ret = fields[{f.type.get(), f.index}];
+
+		if(!ret)
+		{
+			ret = std::make_shared<Variable>(f.getType());
+		}
+
+		return ret;
+	}
+};
+
+/*
+ * Narrow fields are truncated when stored, which a plain variable would not do.
+ */
+static inline bool hasNarrowFields(std::shared_ptr<ast::Class> c)
+{
+	for(; c; c = c->base)
+	{
+		if(std::any_of(c->fieldTypes.begin(), c->fieldTypes.end(), [](const auto& t){ return t.isNarrow(); }))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Variables only ever assigned new objects of a single class (one at a time, so the object held
+ * before is lost at every assignment) and never read other than to access the fields. Anything else
+ * (passing it to a call, storing, returning, throwing or comparing it) lets the reference escape
+ * or depends on its identity.
+ */
+static inline std::map<std::shared_ptr<Temporary>, Candidate> findCandidates(const std::shared_ptr<ir::Function> &f)
+{
+	std::map<std::shared_ptr<Temporary>, Candidate> ret;
+	std::set<std::shared_ptr<Temporary>> excluded(f->args.begin(), f->args.end());
+
+	const auto exclude = [&](const std::shared_ptr<Temporary>& t) { excluded.insert(t); };
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		for(const auto& o: bb->code)
+		{
+			o->accept(overloaded
+			{
+				[&](const Create& v)
+				{
+					if(!v.type || hasNarrowFields(v.type))
+					{
+						exclude(v.target);
+					}
+					else if(auto &c = ret[v.target]; !c.type || c.type == v.type)
+					{
+						c.type = v.type;
+					}
+					else
+					{
+						exclude(v.target);
+					}
+				},
+				[&](const LoadField& v) { exclude(v.target); },
+				[&](const StoreField& v) { exclude(v.source); },
+				[&](const Copy& v) { exclude(v.target); exclude(v.source); },
+				[&](const Unary& v) { exclude(v.target); },
+				[&](const LoadGlobal& v) { exclude(v.target); },
+				[&](const StoreGlobal& v) { exclude(v.source); },
+				[&](const CreateArray& v) { exclude(v.target); },
+				[&](const LoadElement& v) { exclude(v.target); },
+				[&](const StoreElement& v) { exclude(v.source); exclude(v.array); },
+				[&](const ArrayLength& v) { exclude(v.target); },
+				[&](const Binary& v) { exclude(v.target); },
+				[&](const Call& v)
+				{
+					std::for_each(v.arg.begin(), v.arg.end(), exclude);
+					std::for_each(v.ret.begin(), v.ret.end(), exclude);
+				},
+				[&](const Catch& v) { exclude(v.target); },
+			});
+		}
+
+		bb->termination->accept(overloaded
+		{
+			[&](const Leave& v) { std::for_each(v.ret.begin(), v.ret.end(), exclude); },
+			[&](const Throw& v) { exclude(v.exception); },
+			[&](const Always& v) {},
+			[&](const Conditional& v) { exclude(v.first); exclude(v.second); },
+		});
+	});
+
+	for(const auto& t: excluded)
+	{
+		ret.erase(t);
+	}
+
+	return ret;
+}
+
+size_t Compiler::replaceScalars(std::shared_ptr<ir::Function> f)
+{
+	auto candidates = findCandidates(f);
+	size_t ret = 0;
+
+	const auto candidate = [&](const std::shared_ptr<Temporary> &t) -> Candidate*
+	{
+		const auto it = candidates.find(t);
+		return (it != candidates.end()) ? &it->second : nullptr;
+	};
+
+	// The fields are collected first, so that every creation can initialize all of them.
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		for(const auto& o: bb->code)
+		{
+			o->accept(overloaded
+			{
+				[&](const LoadField& v) { if(auto c = candidate(v.object)) c->field(v.field); },
+				[&](const StoreField& v) { if(auto c = candidate(v.object)) c->field(v.field); },
+				[&](const auto&) {},
+			});
+		}
+	});
+
+	f->traverse([&](std::shared_ptr<BasicBlock> bb)
+	{
+		std::vector<std::shared_ptr<Operation>> code;
+
+		for(const auto& o: bb->code)
+		{
+			std::shared_ptr<Operation> replacement = o;
+
+			o->accept(overloaded
+			{
+				[&](const Create& v)
+				{
+					if(auto c = candidate(v.target))
+					{
+						for(const auto &p: c->fields)
+						{
+							const auto &t = p.second->type;
+
+							code.push_back((t.kind == ast::TypeKind::Reference)
+									? std::static_pointer_cast<Operation>(std::make_shared<Create>(p.second, nullptr))
+									: std::static_pointer_cast<Operation>(std::make_shared<Copy>(p.second, std::make_shared<Constant>(t, 0))));
+						}
+
+						replacement = nullptr;
+						ret++;
+					}
+				},
+				[&](const LoadField& v)
+				{
+					if(auto c = candidate(v.object))
+					{
+						replacement = std::make_shared<Copy>(v.target, c->field(v.field));
+					}
+				},
+				[&](const StoreField& v)
+				{
+					if(auto c = candidate(v.object))
+					{
+						replacement = std::make_shared<Copy>(c->field(v.field), v.source);
+					}
+				},
+				[&](const auto&) {},
+			});
+
+			if(replacement)
+			{
+				code.push_back(replacement);
+			}
+		}
+
+		bb->code = std::move(code);
+	});
+
+	return ret;
+}
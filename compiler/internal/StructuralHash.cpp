@@ -0,0 +1,251 @@
+#include "Compiler.h"
+
+#include "compiler/ast/Statements.h"
+#include "compiler/ast/Values.h"
+
+#include "Overloaded.h"
+
+#include <map>
+#include <set>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+using namespace comp;
+using namespace comp::ast;
+
+/*
+ * Bumped whenever the output of the stages cached by the key changes for the same input, so
+ * that entries written by older versions of the compiler are not used.
+ */
+static constexpr uint64_t formatVersion = 6;
+
+/*
+ * Structural hash of a function, two independently seeded lanes of 64 bits.
+ *
+ * Everything that can influence the result of compiling the function is hashed: the nodes of
+ * the body with the literals by value, the locals and the loops by the order of their first
+ * appearance (as their identity is their address), and by index and signature the functions
+ * called. The classes are hashed by index, and the shape of each of them referenced (its base,
+ * field and static types) is appended at the end, as the field accesses and the optimizations
+ * depend on it.
+ */
+class StructuralHash
+{
+	const ProgramObjectSet &gi;
+
+	uint64_t lanes[2] = {0x9e3779b97f4a7c15, 0xc2b2ae3d27d4eb4f};
+
+	std::map<const Local*, uint64_t> locals;
+	std::map<const Loop*, uint64_t> loops;
+	std::set<size_t> classes;
+
+	static inline uint64_t mix(uint64_t x)
+	{
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccd;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53;
+		x ^= x >> 33;
+		return x;
+	}
+
+	template<class T>
+	static inline uint64_t ordinal(std::map<const T*, uint64_t> &m, const T* v) {
+		return m.emplace(v, m.size()).first->second;
+	}
+
+	inline void tag(const char* node) {
+		add(node[0] | node[1] << 8 | node[2] << 16);
+	}
+
+	void add(const ValueType& t)
+	{
+		add(t.kind);
+		add(t.primitiveType);
+
+		if(t.isArray())
+		{
+			tag("arr");
+			add(*t.elementType);
+		}
+		else if(t.kind == TypeKind::Reference)
+		{
+			add(t.referenceType.get());
+		}
+	}
+
+	void add(const std::vector<ValueType>& ts)
+	{
+		add(ts.size());
+		std::for_each(ts.begin(), ts.end(), [&](const auto& t){ add(t); });
+	}
+
+	void add(const Class* c)
+	{
+		if(!c)
+		{
+			add(-1ull);
+			return;
+		}
+
+		const auto idx = gi.getClassIndex(c);
+		classes.insert(idx);
+		add(idx);
+
+		// The base chain is hashed too, as the layout and the narrow fields come from it.
+		for(auto b = c->base.get(); b; b = b->base.get())
+		{
+			classes.insert(gi.getClassIndex(b));
+		}
+	}
+
+	void add(const Field& f)
+	{
+		add(f.type.get());
+		add(f.index);
+	}
+
+	void add(const Function* f)
+	{
+		add(gi.getFunctionIndex(f));
+		add(f->ret);
+		add(f->args);
+	}
+
+	void add(const std::shared_ptr<const RValue>& v)
+	{
+		v->accept(overloaded
+		{
+			[&](const Set& v) { tag("set"); add(v.target); add(v.value); },
+			[&](const Call& v)
+			{
+				tag("cal");
+				add(v.fn.get());
+				add(v.args.size());
+				std::for_each(v.args.begin(), v.args.end(), [&](const auto& a){ add(a); });
+			},
+			[&](const Local& v) { tag("loc"); add(ordinal(locals, &v)); add(v.type); },
+			[&](const Unary& v) { tag("una"); add(uint64_t(v.op)); add(v.arg); },
+			[&](const Binary& v) { tag("bin"); add(uint64_t(v.op)); add(v.first); add(v.second); },
+			[&](const Create& v) { tag("new"); add(v.type.get()); },
+			[&](const Length& v) { tag("len"); add(v.array); },
+			[&](const Element& v) { tag("elm"); add(v.array); add(v.index); },
+			[&](const Global& v) { tag("glb"); add(v.field); },
+			[&](const Literal& v)
+			{
+				tag("lit");
+				add(v.type);
+
+				uint32_t bits = 0;
+
+				switch(v.type.primitiveType)
+				{
+					case PrimitiveType::Floating: std::memcpy(&bits, &v.floating, sizeof(v.floating)); break;
+					case PrimitiveType::Logical: bits = v.logical; break;
+					default: bits = v.integer; break;
+				}
+
+				add(bits);
+			},
+			[&](const Ternary& v) { tag("ter"); add(v.condition); add(v.then); add(v.otherwise); },
+			[&](const CreateArray& v) { tag("nar"); add(v.elementType); add(v.length); },
+			[&](const Argument& v) { tag("arg"); add(v.idx); add(v.type); },
+			[&](const Dereference& v) { tag("drf"); add(v.field); add(v.object); },
+		});
+	}
+
+	void add(const Statement& s)
+	{
+		s.accept(overloaded
+		{
+			[&](const ExpressionStatement& v) { tag("exp"); add(v.val); },
+			[&](const Conditional& v) { tag("if_"); add(v.condition); add(*v.then); add(*v.otherwise); },
+			[&](const Declaration& v)
+			{
+				tag("dcl");
+				add(ordinal(locals, v.local.get()));
+				add(v.local->type);
+				add(v.initializer);
+			},
+			[&](const Continue& v) { tag("cnt"); add(ordinal(loops, v.loop.get())); },
+			[&](const Return& v)
+			{
+				tag("ret");
+				add(v.value.size());
+				std::for_each(v.value.begin(), v.value.end(), [&](const auto& r){ add(r); });
+			},
+			[&](const Block& v)
+			{
+				tag("blk");
+				add(v.stmts.size());
+				std::for_each(v.stmts.begin(), v.stmts.end(), [&](const auto& s){ add(*s); });
+			},
+			[&](const Break& v) { tag("brk"); add(ordinal(loops, v.loop.get())); },
+			[&](const Loop& v) { tag("lop"); add(ordinal(loops, &v)); add(*v.body); },
+			[&](const Throw& v) { tag("thr"); add(v.value); },
+			[&](const Try& v)
+			{
+				tag("try");
+				add(*v.body);
+				add(ordinal(locals, v.exception.get()));
+				add(v.exception->type);
+				add(*v.handler);
+			},
+		});
+	}
+
+public:
+	inline StructuralHash(const ProgramObjectSet &gi): gi(gi) {}
+
+	inline void add(uint64_t v)
+	{
+		lanes[0] = mix(lanes[0] ^ v);
+		lanes[1] = mix(lanes[1] + v * 0x9e3779b97f4a7c15 + 1);
+	}
+
+	std::string get(size_t functionIdx)
+	{
+		const auto &f = gi.functions[functionIdx];
+
+		add(functionIdx);
+		add(f.get());
+		add(*f->body);
+
+		// The set of classes grows while hashing their shapes (through the referenced types).
+		for(std::set<size_t> done; done != classes;)
+		{
+			const auto todo = classes;
+
+			for(const auto idx: todo)
+			{
+				if(done.insert(idx).second)
+				{
+					const auto &c = gi.classes[idx];
+
+					tag("cls");
+					add(idx);
+					add(c->base.get());
+					add(c->fieldTypes);
+					add(c->staticTypes);
+				}
+			}
+		}
+
+		std::stringstream ss;
+		ss << std::hex << std::setfill('0') << std::setw(16) << lanes[0] << std::setw(16) << lanes[1];
+		return ss.str();
+	}
+};
+
+/*
+ * Key of the results of the per function stages for a given function of the program.
+ */
+std::string Compiler::getCacheKey(size_t functionIdx, Options opt) const
+{
+	StructuralHash h(gi);
+	h.add(formatVersion);
+	h.add(std::underlying_type<Options>::type(opt));
+	h.add(uint64_t(unrollBudget));
+	return h.get(functionIdx);
+}
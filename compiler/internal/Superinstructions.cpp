@@ -0,0 +1,148 @@
+#include "Compiler.h"
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+
+using namespace comp;
+
+using Isn = prog::Instruction;
+using Op = prog::Instruction::Operation;
+
+static inline bool isTos(const Isn::Reg& r) {
+	return r.kind == Isn::Reg::Kind::Tos;
+}
+
+/*
+ * Returns the index of the immediate holding the jump target, if the instruction is a branch.
+ */
+static inline std::optional<uint32_t Isn::*> getTarget(const Isn& isn)
+{
+	switch(isn.op)
+	{
+	case Op::jNul: case Op::jNnl:
+	case Op::jEq: case Op::jNe:
+	case Op::jLtI: case Op::jGtI: case Op::jLeI: case Op::jGeI:
+	case Op::jLtU: case Op::jGtU: case Op::jLeU: case Op::jGeU:
+	case Op::jLtF: case Op::jGtF: case Op::jLeF: case Op::jGeF:
+	case Op::jump:
+		return &Isn::imm;
+	case Op::jEqL: case Op::jNeL: case Op::jLtIL:
+		return &Isn::imm2;
+	default:
+		return {};
+	}
+}
+
+/*
+ * The fused forms of a literal pushed onto the stack and consumed by the next instruction as its last operand.
+ */
+static inline std::optional<Isn> fuse(const Isn& first, const Isn& second)
+{
+	if(first.op != Op::lit || !isTos(first.x))
+	{
+		return {};
+	}
+
+	const auto k = first.imm;
+	const bool literalComparand = !isTos(second.x) && isTos(second.y);
+	const bool literalOperand = !isTos(second.y) && isTos(second.z);
+
+	switch(second.op)
+	{
+	case Op::jEq:
+		if(literalComparand) return Isn::jEqL(second.x, k, second.imm);
+		break;
+	case Op::jNe:
+		if(literalComparand) return Isn::jNeL(second.x, k, second.imm);
+		break;
+	case Op::jLtI:
+		if(literalComparand) return Isn::jLtIL(second.x, k, second.imm);
+		break;
+	case Op::addI:
+		if(literalOperand) return Isn::addIL(second.x, second.y, k);
+		break;
+	case Op::subI:
+		if(literalOperand) return Isn::subIL(second.x, second.y, k);
+		break;
+	case Op::call:
+		if(second.imm <= UINT16_MAX && second.imm2 <= UINT16_MAX) return Isn::callL(k, second.imm, second.imm2);
+		break;
+	default:
+		break;
+	}
+
+	return {};
+}
+
+/*
+ * Peephole pass of the bytecode emitter replacing instruction pairs with superinstructions.
+ *
+ * The candidates are the most frequent consecutively executed operation pairs, as reported
+ * by the execution profiler over the benchmark corpus. Pairs are only fused if the second
+ * instruction is not a jump target or handler range boundary, then the jump targets and
+ * the handler tables are remapped to the new offsets.
+ */
+prog::Program Compiler::fuseInstructions(const prog::Program& p)
+{
+	prog::Program ret = p;
+
+	for(auto &f: ret.functions)
+	{
+		std::vector<bool> isTarget(f.code.size() + 1);
+
+		for(const auto &isn: f.code)
+		{
+			if(const auto t = getTarget(isn))
+			{
+				isTarget[isn.*(*t)] = true;
+			}
+		}
+
+		// Handler ranges are not to be cut by fusion either.
+		for(const auto &h: f.handlers)
+		{
+			isTarget[h.begin] = isTarget[h.end] = isTarget[h.target] = true;
+		}
+
+		std::vector<uint32_t> newOffset(f.code.size() + 1);
+		decltype(f.code) code;
+
+		for(auto i = 0u; i < f.code.size(); i++)
+		{
+			newOffset[i] = (uint32_t)code.size();
+
+			if(i + 1 < f.code.size() && !isTarget[i + 1])
+			{
+				if(const auto fused = fuse(f.code[i], f.code[i + 1]))
+				{
+					code.push_back(*fused);
+					newOffset[i + 1] = newOffset[i];
+					i++;
+					continue;
+				}
+			}
+
+			code.push_back(f.code[i]);
+		}
+
+		newOffset[f.code.size()] = (uint32_t)code.size();
+
+		for(auto &isn: code)
+		{
+			if(const auto t = getTarget(isn))
+			{
+				isn.*(*t) = newOffset[isn.*(*t)];
+			}
+		}
+
+		for(auto &h: f.handlers)
+		{
+			h = {newOffset[h.begin], newOffset[h.end], newOffset[h.target], h.nRefs, h.nScalars};
+		}
+
+		f.code = std::move(code);
+	}
+
+	return ret;
+}
@@ -12,6 +12,8 @@
 #include "assert.h"
 
 #include <set>
+#include <deque>
+#include <cstring>
 #include <sstream>
 #include <algorithm>
 
@@ -21,8 +23,8 @@ using namespace comp::ir;
 static inline const std::map<Unary::Op, std::string> unaryOp =
 {
 	{Unary::Op::Neg, "~"},
-	{Unary::Op::I2F, "(int)"},
-	{Unary::Op::F2I, "(float)"},
+	{Unary::Op::I2F, "(float)"},
+	{Unary::Op::F2I, "(int)"},
 	{Unary::Op::Not, "!"},
 };
 
@@ -35,27 +37,35 @@ static inline const std::map<Binary::Op, std::string> binaryOp =
 
 void BasicBlock::traverse(std::shared_ptr<BasicBlock> entry, std::function<void(std::shared_ptr<BasicBlock>)> c)
 {
-	std::set<std::shared_ptr<BasicBlock>> toDo{entry}, done;
+	// In the order the blocks are reached, not by address, so that the dumps are reproducible.
+	std::deque<std::shared_ptr<BasicBlock>> toDo{entry};
+	std::set<std::shared_ptr<BasicBlock>> done;
 
 	while(!toDo.empty())
 	{
-		const auto current = *toDo.begin();
-		toDo.erase(current);
+		const auto current = toDo.front();
+		toDo.pop_front();
 		if(done.insert(current).second)
 		{
 			c(current);
 
+			if(current->handler)
+			{
+				toDo.push_back(current->handler);
+			}
+
 			current->termination->accept(overloaded
 			{
 				[&](const Leave &v){},
+				[&](const Throw &v){},
 				[&](const Always &v)
 				{
-					toDo.insert(v.continuation);
+					toDo.push_back(v.continuation);
 				},
 				[&](const Conditional &v)
 				{
-					toDo.insert(v.then);
-					toDo.insert(v.otherwise);
+					toDo.push_back(v.then);
+					toDo.push_back(v.otherwise);
 				},
 			});
 		}
@@ -73,7 +83,12 @@ std::string BasicBlock::DumpContext::nameOf(const std::shared_ptr<Temporary> &t)
 		switch(t->type.primitiveType)
 		{
 			case ast::PrimitiveType::Integer: return std::to_string(c->value);
-			case ast::PrimitiveType::Floating: return std::to_string(*reinterpret_cast<const float*>(&c->value));
+			case ast::PrimitiveType::Floating:
+			{
+				float f;
+				std::memcpy(&f, &c->value, sizeof(f));
+				return std::to_string(f);
+			}
 			case ast::PrimitiveType::Logical: return c->value ? "true" : "false";
 			default: break;
 		}
@@ -88,7 +103,7 @@ std::string BasicBlock::DumpContext::nameOf(const std::shared_ptr<Temporary> &t)
 	return "<< native >>";
 }
 
-std::string BasicBlock::dump(ast::ProgramObjectSet& gi, DumpContext& dc) const
+std::string BasicBlock::dump(const ast::ProgramObjectSet& gi, DumpContext& dc) const
 {
 	std::stringstream ss;
 
@@ -98,11 +113,15 @@ std::string BasicBlock::dump(ast::ProgramObjectSet& gi, DumpContext& dc) const
 		{
 			[&](const Copy& v) {ss << dc.nameOf(v.target) << " ← " << dc.nameOf(v.source);},
 			[&](const Unary& v) {ss << dc.nameOf(v.target) << " ← " << unaryOp.find(v.op)->second << dc.nameOf(v.source);},
-			[&](const Create& v) {ss << dc.nameOf(v.target) << " ← new " << v.type->getReferenceForDump(gi);},
+			[&](const Create& v) {ss << dc.nameOf(v.target) << " ← " << (v.type ? "new " + v.type->getReferenceForDump(gi) : "null");},
 			[&](const LoadField& v) {ss << dc.nameOf(v.target) << " ← " << dc.nameOf(v.object) << "." << v.field.getReferenceForDump(gi);},
 			[&](const StoreField& v) {ss << dc.nameOf(v.source) << " → " << dc.nameOf(v.object) << "." << v.field.getReferenceForDump(gi);},
 			[&](const LoadGlobal& v) {ss << dc.nameOf(v.target) << " ← " << v.field.getReferenceForDump(gi);},
 			[&](const StoreGlobal& v) {ss << dc.nameOf(v.source) << " → " << v.field.getReferenceForDump(gi);},
+			[&](const CreateArray& v) {ss << dc.nameOf(v.target) << " ← new " << v.target->type.elementType->getReferenceForDump(gi) << "[" << dc.nameOf(v.length) << "]";},
+			[&](const LoadElement& v) {ss << dc.nameOf(v.target) << " ← " << dc.nameOf(v.array) << "[" << dc.nameOf(v.index) << "]";},
+			[&](const StoreElement& v) {ss << dc.nameOf(v.source) << " → " << dc.nameOf(v.array) << "[" << dc.nameOf(v.index) << "]";},
+			[&](const ArrayLength& v) {ss << dc.nameOf(v.target) << " ← " << dc.nameOf(v.array) << ".length";},
 			[&](const Binary& v) {ss << dc.nameOf(v.target) << " ← " << dc.nameOf(v.first) << " " << binaryOp.find(v.op)->second << " " << dc.nameOf(v.second);},
 			[&](const Call& v)
 			{
@@ -119,7 +138,8 @@ std::string BasicBlock::dump(ast::ProgramObjectSet& gi, DumpContext& dc) const
 				}
 
 				ss << ")";
-			}
+			},
+			[&](const Catch& v) {ss << dc.nameOf(v.target) << " ← catch";}
 		});
 
 		for(const std::shared_ptr<Annotation> &a: o->annotations)
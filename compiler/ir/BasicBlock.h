@@ -23,6 +23,9 @@ struct BasicBlock
 {
 	std::vector<std::shared_ptr<Operation>> code;
 	std::shared_ptr<Termination> termination;
+
+	// Entered if an exception is raised by the operations or the termination of the block.
+	std::shared_ptr<BasicBlock> handler;
 	std::vector<std::shared_ptr<Annotation>> annotations;
 
 	static void traverse(std::shared_ptr<BasicBlock> entry, std::function<void(std::shared_ptr<BasicBlock>)> c);
@@ -33,7 +36,7 @@ struct BasicBlock
 		std::string nameOf(const std::shared_ptr<Temporary> &t);
 	};
 
-	std::string dump(ast::ProgramObjectSet& gi, DumpContext& dc) const;
+	std::string dump(const ast::ProgramObjectSet& gi, DumpContext& dc) const;
 };
 
 } // namespace ir
@@ -52,7 +52,7 @@ static inline Conditional::Condition inverse(Conditional::Condition c)
 	}
 }
 
-std::string ir::Function::dump(ast::ProgramObjectSet& gi) const
+std::string ir::Function::dump(const ast::ProgramObjectSet& gi) const
 {
 	std::map<std::shared_ptr<BasicBlock>, size_t> blocks;
 	auto getIdx = [&](auto i)
@@ -82,6 +82,11 @@ std::string ir::Function::dump(ast::ProgramObjectSet& gi) const
 		const auto idx =  getIdx(bb);
 		ss << "\t" << idx << "[shape=rect label=\"" << bb->dump(gi, dc) << "\"]" << std::endl;
 
+		if(bb->handler)
+		{
+			ss << "\t" << idx << " -> " << getIdx(bb->handler) << "[style=dashed]" << std::endl;
+		}
+
 		bb->termination->accept(overloaded
 		{
 			[&](const Always& v) {
@@ -104,6 +109,9 @@ std::string ir::Function::dump(ast::ProgramObjectSet& gi) const
 
 				ss << std::endl;
 			},
+			[&](const Throw& v) {
+				ss << "\t" << idx << " -> exit[label=\"throw " << dc.nameOf(v.exception) << "\" style=dashed]" << std::endl;
+			},
 		});
 	});
 
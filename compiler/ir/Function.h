@@ -17,7 +17,7 @@ struct Function
 
 	inline Function(decltype(args) args, decltype(entry) entry): args(args), entry(entry) {}
 
-	std::string dump(ast::ProgramObjectSet& gi) const;
+	std::string dump(const ast::ProgramObjectSet& gi) const;
 
 	void traverse(std::function<void(std::shared_ptr<BasicBlock>)> c) const;
 };
@@ -24,7 +24,7 @@ struct IrBuilder
 		inline LoopInfo(decltype(start) start): start(start) {}
 	};
 
-	std::shared_ptr<BasicBlock> entry, last;
+	std::shared_ptr<BasicBlock> entry, last, handler;
 	std::map<const void*, LoopInfo> loops;
 
 	inline IrBuilder(): entry(std::make_shared<BasicBlock>()), last(entry) {}
@@ -33,7 +33,7 @@ private:
 	std::pair<std::shared_ptr<BasicBlock>, std::shared_ptr<BasicBlock>> cut()
 	{
 		auto old = last;
-		last = std::make_shared<BasicBlock>();
+		last = block();
 		return {old, last};
 	}
 
@@ -57,36 +57,49 @@ public:
 		last->code.push_back(stmt);
 	}
 
-	void addLiteral(std::shared_ptr<Variable> target, int v)
+	// A new block covered by the current handler, to be entered later.
+	std::shared_ptr<BasicBlock> block()
 	{
-		addOp(std::make_shared<Copy>(target, std::make_shared<Constant>(target->type, v)));
+		auto ret = std::make_shared<BasicBlock>();
+		ret->handler = handler;
+		return ret;
 	}
 
-	void condToBool(std::shared_ptr<Variable> ret, Conditional::Condition condition, std::shared_ptr<Temporary> first, std::shared_ptr<Temporary> second)
+	void enter(std::shared_ptr<BasicBlock> bb) {
+		last = bb;
+	}
+
+	// Ends the current block, a block must be entered to continue.
+	void jump(Conditional::Condition condition, std::shared_ptr<Temporary> first, std::shared_ptr<Temporary> second,
+			std::shared_ptr<BasicBlock> then, std::shared_ptr<BasicBlock> otherwise)
 	{
-		auto ifThenPoint = cut();
-		addOp(std::make_shared<Copy>(ret, std::make_shared<Constant>(ast::ValueType::logical(), 1)));
-		auto thenElsePoint = cut();
-		addOp(std::make_shared<Copy>(ret, std::make_shared<Constant>(ast::ValueType::logical(), 0)));
-		auto endifPoint = cut();
+		join(last, condition, first, second, then, otherwise);
+	}
 
-		join(ifThenPoint.first, condition, first, second, ifThenPoint.second, thenElsePoint.second);
-		join(thenElsePoint.first, endifPoint.second);
-		join(endifPoint.first, endifPoint.second);
+	void addLiteral(std::shared_ptr<Variable> target, int v)
+	{
+		addOp(std::make_shared<Copy>(target, std::make_shared<Constant>(target->type, v)));
 	}
 
-	template<class T, class O>
-	void branch(std::shared_ptr<Variable> decisionInput, T&& then, O&& otherwise)
+	/*
+	 * The decision is called with the blocks to continue in if it holds and if it does not, and ends
+	 * the current block with jumps to them (possibly through further blocks of its own).
+	 */
+	template<class D, class T, class O>
+	void branch(D&& decide, T&& then, O&& otherwise)
 	{
-		auto ifThenPoint = cut();
+		const auto thenStart = block(), otherwiseStart = block(), end = block();
+		decide(thenStart, otherwiseStart);
+
+		last = thenStart;
 		then();
-		auto thenElsePoint = cut();
+		join(last, end);
+
+		last = otherwiseStart;
 		otherwise();
-		auto endifPoint = cut();
+		join(last, end);
 
-		join(ifThenPoint.first, Conditional::Condition::Eq, decisionInput, std::make_shared<Constant>(ast::ValueType::logical(), 1), ifThenPoint.second, thenElsePoint.second);
-		join(thenElsePoint.first, endifPoint.second);
-		join(endifPoint.first, endifPoint.second);
+		last = end;
 	}
 
 	template<class C>
@@ -135,6 +148,37 @@ public:
 		join(cut().first, retvals);
 	}
 
+	void raise(std::shared_ptr<Temporary> exception) {
+		cut().first->termination = std::make_shared<Throw>(exception);
+	}
+
+	/*
+	 * The blocks generated by the body are all covered by the handler, which starts with
+	 * taking the exception and continues after the body like it would if nothing was thrown.
+	 */
+	template<class B, class H>
+	void guard(std::shared_ptr<Variable> exception, B&& body, H&& otherwise)
+	{
+		const auto outer = handler;
+		const auto handlerEntry = std::make_shared<BasicBlock>();
+		handlerEntry->handler = outer;
+
+		handler = handlerEntry;
+		auto bodyPoint = cut();
+		join(bodyPoint.first, bodyPoint.second);
+		body();
+		handler = outer;
+
+		const auto bodyEnd = last;
+		last = handlerEntry;
+		addOp(std::make_shared<Catch>(exception));
+		otherwise();
+
+		auto endPoint = cut();
+		join(endPoint.first, endPoint.second);
+		join(bodyEnd, endPoint.second);
+	}
+
 	auto build()
 	{
 		assert(last->code.empty());
@@ -83,6 +83,40 @@ struct StoreGlobal: OperationBase<StoreGlobal>
 	inline StoreGlobal(decltype(source) source, decltype(field) field): source(source), field(field) {}
 };
 
+struct CreateArray: OperationBase<CreateArray>
+{
+	const std::shared_ptr<Variable> target;
+	const std::shared_ptr<Temporary> length;
+
+	inline CreateArray(decltype(target) target, decltype(length) length): target(target), length(length) {}
+};
+
+struct LoadElement: OperationBase<LoadElement>
+{
+	const std::shared_ptr<Variable> target;
+	const std::shared_ptr<Temporary> array, index;
+
+	inline LoadElement(decltype(target) target, decltype(array) array, decltype(index) index):
+		target(target), array(array), index(index) {}
+};
+
+struct StoreElement: OperationBase<StoreElement>
+{
+	const std::shared_ptr<Variable> source, array;
+	const std::shared_ptr<Temporary> index;
+
+	inline StoreElement(decltype(source) source, decltype(array) array, decltype(index) index):
+		source(source), array(array), index(index) {}
+};
+
+struct ArrayLength: OperationBase<ArrayLength>
+{
+	const std::shared_ptr<Variable> target;
+	const std::shared_ptr<Temporary> array;
+
+	inline ArrayLength(decltype(target) target, decltype(array) array): target(target), array(array) {}
+};
+
 struct Binary: OperationBase<Binary>
 {
 	enum class Op
@@ -109,6 +143,16 @@ struct Call: OperationBase<Call>
 	inline Call(decltype(arg) arg, decltype(ret) ret, decltype(fn) fn): arg(arg), ret(ret), fn(fn) {}
 };
 
+/*
+ * Takes the exception being handled, only at the start of a handler block.
+ */
+struct Catch: OperationBase<Catch>
+{
+	const std::shared_ptr<Variable> target;
+
+	inline Catch(decltype(target) target): target(target) {}
+};
+
 } // namespace ir
 } // namespace comp
 
@@ -47,6 +47,13 @@ struct Leave: TerminationBase<Leave>
 	inline Leave(decltype(ret) ret): ret(ret) {}
 };
 
+struct Throw: TerminationBase<Throw>
+{
+	const std::shared_ptr<Temporary> exception;
+
+	inline Throw(decltype(exception) exception): exception(exception) {}
+};
+
 } // namespace ir
 } // namespace comp
 
@@ -18,8 +18,13 @@ namespace ir {
 		X(StoreField) \
 		X(LoadGlobal) \
 		X(StoreGlobal) \
+		X(CreateArray) \
+		X(LoadElement) \
+		X(StoreElement) \
+		X(ArrayLength) \
 		X(Binary) \
 		X(Call) \
+		X(Catch) \
 
 #define X(n) class n;
 _OPERATION_TYPES()
@@ -10,6 +10,7 @@ namespace ir {
 		X(Always) \
 		X(Conditional) \
 		X(Leave) \
+		X(Throw) \
 
 #define X(n) class n;
 _TERMINATION_TYPES()
@@ -6,11 +6,25 @@
 #include <vector>
 
 namespace prog {
+
+/*
+ * Exceptions raised by the instructions in [begin, end) are caught at the target offset, with the
+ * operand stacks cut back to the given depths and the exception pushed onto the reference stack.
+ */
+struct ExceptionHandler
+{
+	uint32_t begin, end, target;
+	uint32_t nRefs, nScalars;
+};
+
 struct Function
 
 {
 	size_t nRefs, nScalars;
 	std::vector<Instruction> code;
+
+	// Innermost first, only looked up when an exception is raised.
+	std::vector<ExceptionHandler> handlers;
 };
 
 } //namespace prog
@@ -13,6 +13,9 @@ namespace prog {
 #define FMT3(n) static constexpr inline Instruction n(Reg x, Reg y, Reg z)          { return {Operation:: n, x, y, z}; }
 #define FMT4(n) static constexpr inline Instruction n(uint32_t imm)                 { return {Operation:: n, imm}; }
 #define FMT5(n) static constexpr inline Instruction n(uint32_t immM, uint32_t immN) { return {Operation:: n, immM, immN}; }
+#define FMT6(n) static constexpr inline Instruction n()                             { return {Operation:: n}; }
+#define FMT7(n) static constexpr inline Instruction n(Reg x, uint32_t immM, uint32_t immN) { return {Operation:: n, x, immM, immN}; }
+#define FMT8(n) static constexpr inline Instruction n(uint32_t imm, uint16_t immM, uint16_t immN) { return {Operation:: n, imm, (uint32_t)immM << 16 | immN}; }
 
 #define OPERATION_LIST(CONSUMER) \
 	CONSUMER(lit, FMT0) \
@@ -24,14 +27,25 @@ namespace prog {
 	CONSUMER(neg, FMT1) \
 	CONSUMER(i2f, FMT1) \
 	CONSUMER(f2i, FMT1) \
-	/*CONSUMER(x1i, FMT1)*/ \
-	/*CONSUMER(x1u, FMT1)*/ \
-	/*CONSUMER(x2i, FMT1)*/ \
-	/*CONSUMER(x2u, FMT1)*/ \
+	CONSUMER(x1i, FMT1) \
+	CONSUMER(x1u, FMT1) \
+	CONSUMER(x2i, FMT1) \
+	CONSUMER(x2u, FMT1) \
+	CONSUMER(news, FMT1) \
+	CONSUMER(newr, FMT1) \
+	CONSUMER(alen, FMT1) \
 	CONSUMER(getr, FMT2) \
 	CONSUMER(putr, FMT2) \
 	CONSUMER(gets, FMT2) \
 	CONSUMER(puts, FMT2) \
+	CONSUMER(gets1i, FMT2) \
+	CONSUMER(gets1u, FMT2) \
+	CONSUMER(gets2i, FMT2) \
+	CONSUMER(gets2u, FMT2) \
+	CONSUMER(gets4, FMT2) \
+	CONSUMER(puts1, FMT2) \
+	CONSUMER(puts2, FMT2) \
+	CONSUMER(puts4, FMT2) \
 	CONSUMER(jEq, FMT2) \
 	CONSUMER(jNe, FMT2) \
 	CONSUMER(jLtI, FMT2) \
@@ -61,10 +75,37 @@ namespace prog {
 	CONSUMER(mulF, FMT3) \
 	CONSUMER(subF, FMT3) \
 	CONSUMER(divF, FMT3) \
+	CONSUMER(agets, FMT3) \
+	CONSUMER(aputs, FMT3) \
+	CONSUMER(agetr, FMT3) \
+	CONSUMER(aputr, FMT3) \
+	CONSUMER(ld1i, FMT3) \
+	CONSUMER(ld1u, FMT3) \
+	CONSUMER(ld2i, FMT3) \
+	CONSUMER(ld2u, FMT3) \
+	CONSUMER(ld4, FMT3) \
+	CONSUMER(st1, FMT3) \
+	CONSUMER(st2, FMT3) \
+	CONSUMER(st4, FMT3) \
 	CONSUMER(jump, FMT4) \
+	CONSUMER(ncall, FMT4) \
 	CONSUMER(drop, FMT5) \
 	CONSUMER(call, FMT5) \
-	CONSUMER(ret, FMT5)
+	CONSUMER(ret, FMT5) \
+	CONSUMER(await, FMT5) \
+	CONSUMER(yield, FMT6) \
+	CONSUMER(raise, FMT6) \
+	CONSUMER(bcpy, FMT6) \
+	CONSUMER(bset, FMT6) \
+	CONSUMER(bcmp, FMT6) \
+	CONSUMER(jEqL, FMT7) \
+	CONSUMER(jNeL, FMT7) \
+	CONSUMER(jLtIL, FMT7) \
+	CONSUMER(addIL, FMT2) \
+	CONSUMER(subIL, FMT2) \
+	CONSUMER(callL, FMT8) \
+	CONSUMER(vcall, FMT8) \
+	CONSUMER(iof, FMT2)
 
 struct Instruction
 {
@@ -96,17 +137,35 @@ struct Instruction
 #undef X
 	};
 
+#define X(name, fmt) + 1
+	static constexpr inline size_t operationCount = 0 OPERATION_LIST(X);
+#undef X
+
+	static constexpr inline const char* getName(Operation op)
+	{
+		switch(op)
+		{
+#define X(name, fmt) case Operation:: name: return #name;
+			OPERATION_LIST(X)
+#undef X
+		}
+
+		return nullptr;
+	}
+
 	Operation op = Operation::lit;
 	Reg x, y, z;
 	uint32_t imm = 0, imm2 = 0;
 
 	inline constexpr Instruction() = default;
+	inline constexpr Instruction(Operation op): op(op) {}
 	inline constexpr Instruction(Operation op, Reg x, uint32_t imm): op(op), x(x), imm(imm) {}
 	inline constexpr Instruction(Operation op, Reg x, Reg y): op(op), x(x), y(y) {}
 	inline constexpr Instruction(Operation op, Reg x, Reg y, uint32_t imm): op(op), x(x), y(y), imm(imm) {}
 	inline constexpr Instruction(Operation op, Reg x, Reg y, Reg z): op(op), x(x), y(y), z(z) {}
 	inline constexpr Instruction(Operation op, uint32_t imm): op(op), imm(imm) {}
 	inline constexpr Instruction(Operation op, uint32_t imm, uint32_t imm2): op(op), imm(imm), imm2(imm2) {}
+	inline constexpr Instruction(Operation op, Reg x, uint32_t imm, uint32_t imm2): op(op), x(x), imm(imm), imm2(imm2) {}
 
 #define X(name, fmt) fmt(name)
 		OPERATION_LIST(X)
@@ -15,6 +15,9 @@ struct Program
 
 	// First entry is the entry point
 	std::vector<Function> functions;
+
+	// Virtual method table of each type by type index, complete with the inherited entries
+	std::vector<std::vector<uint32_t>> methods;
 };
 
 } //namespace prog
@@ -12,15 +12,18 @@ struct TypeInfo
 	size_t baseIdx;
 	size_t nReferences, nScalars;
 
-	inline TypeInfo(size_t baseIdx, size_t nReferences, size_t nScalars):
-		baseIdx(baseIdx), nReferences(nReferences), nScalars(nScalars) {}
+	// Packed area for the scalar fields narrower than a full value, accessed by byte offset.
+	size_t nBytes;
+
+	inline TypeInfo(size_t baseIdx, size_t nReferences, size_t nScalars, size_t nBytes = 0):
+		baseIdx(baseIdx), nReferences(nReferences), nScalars(nScalars), nBytes(nBytes) {}
 
 	inline bool operator==(const TypeInfo& o) const {
-		return baseIdx == o.baseIdx && nScalars == o.nScalars && nReferences == o.nReferences;
+		return baseIdx == o.baseIdx && nScalars == o.nScalars && nReferences == o.nReferences && nBytes == o.nBytes;
 	}
 };
 
-inline const TypeInfo TypeInfo::empty = { .baseIdx = 0, .nReferences = 0, .nScalars = 0 };
+inline const TypeInfo TypeInfo::empty = { .baseIdx = 0, .nReferences = 0, .nScalars = 0, .nBytes = 0 };
 
 } // namespace prog
 
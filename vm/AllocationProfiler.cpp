@@ -0,0 +1,83 @@
+#include "AllocationProfiler.h"
+
+#include "assert.h"
+
+#include <algorithm>
+
+using namespace vm;
+
+AllocationProfiler::AllocationProfiler(uint32_t interval): interval(interval)
+{
+	assert(interval);
+	countdown = next();
+}
+
+/*
+ * Uniformly distributed distance to the next sample with the interval as the mean, so that
+ * allocations repeating with the same period as the sampling are not always skipped.
+ */
+uint32_t AllocationProfiler::next()
+{
+	if(interval == 1)
+	{
+		return 1;
+	}
+
+	random ^= random << 13;
+	random ^= random >> 17;
+	random ^= random << 5;
+	return 1 + random % (2 * interval - 1);
+}
+
+void AllocationProfiler::sample(Reference ref, size_t size)
+{
+	auto &c = sites[site];
+	c.objects++;
+	c.bytes += size;
+
+	samples[ref] = {site, false};
+	countdown = next();
+}
+
+void AllocationProfiler::collected(const std::function<bool(Reference)> &isLive)
+{
+	for(auto it = samples.begin(); it != samples.end();)
+	{
+		auto &s = it->second;
+		const auto live = isLive(it->first);
+
+		if(!s.old)
+		{
+			(live ? sites[s.site].survived : sites[s.site].diedYoung)++;
+			s.old = true;
+		}
+
+		it = live ? std::next(it) : samples.erase(it);
+	}
+}
+
+void AllocationProfiler::write(std::ostream& out) const
+{
+	std::vector<std::pair<Site, Counter>> sorted(sites.begin(), sites.end());
+	std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b){ return a.second.bytes > b.second.bytes; });
+
+	out << "# site\tobjects\tbytes\tsurvival" << std::endl;
+
+	for(const auto &[s, c]: sorted)
+	{
+		if(s.first == none)
+		{
+			out << "vm";
+		}
+		else if(s.second == frame)
+		{
+			out << "fn" << s.first << ":frame";
+		}
+		else
+		{
+			out << "fn" << s.first << "+" << s.second;
+		}
+
+		out << "\t" << c.objects * interval << "\t" << c.bytes * interval << "\t" << c.getSurvivalRate() << std::endl;
+	}
+}
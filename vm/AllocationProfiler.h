@@ -0,0 +1,101 @@
+#ifndef VM_ALLOCATIONPROFILER_H_
+#define VM_ALLOCATIONPROFILER_H_
+
+#include "Reference.h"
+
+#include <map>
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+namespace vm {
+
+/*
+ * Allocation profile collected by the storage it is attached to.
+ *
+ * Allocations are attributed to the site set by the VM right before them, the function index
+ * and instruction offset of a make/news/newr, or the callee index and the frame marker for the
+ * frames. Everything else (like the static object or the coroutines) is accounted to no site.
+ *
+ * Only a random sample of the allocations is recorded, one in every interval on average, the
+ * reported counts are estimated from the sample. The sampled objects are followed through the
+ * collections to see which ones die young.
+ */
+class AllocationProfiler
+{
+public:
+	static constexpr uint32_t none = -1u;
+	static constexpr uint32_t frame = -2u;                 // Offset of the frame allocations
+
+	typedef std::pair<uint32_t, uint32_t> Site;             // Function index and offset
+
+	struct Counter
+	{
+		uint64_t objects = 0;
+		uint64_t bytes = 0;
+
+		uint64_t survived = 0;                              // Sampled objects surviving their first collection
+		uint64_t diedYoung = 0;                             // and the ones freed by it
+
+		inline double getSurvivalRate() const {
+			return (survived + diedYoung) ? (double)survived / (double)(survived + diedYoung) : 0.0;
+		}
+	};
+
+private:
+	struct Sample
+	{
+		Site site;
+		bool old;
+	};
+
+	const uint32_t interval;
+	uint32_t countdown;
+	uint32_t random = 0x2545f491;
+	Site site{none, none};
+
+	std::map<Site, Counter> sites;
+	std::map<Reference, Sample> samples;
+
+	uint32_t next();
+	void sample(Reference ref, size_t size);
+
+public:
+	AllocationProfiler(uint32_t interval = 1);
+
+	// The next allocation happens at the given site.
+	inline void at(uint32_t functionIndex, uint32_t offset) {
+		site = {functionIndex, offset};
+	}
+
+	inline void allocated(Reference ref, size_t size)
+	{
+		if(!--countdown)
+		{
+			sample(ref, size);
+		}
+
+		site = {none, none};
+	}
+
+	// After a collection, with whether an object is still allocated.
+	void collected(const std::function<bool(Reference)> &isLive);
+
+	inline uint32_t getInterval() const {
+		return interval;
+	}
+
+	// Sampled counts, not scaled by the interval.
+	inline const auto& getSites() const {
+		return sites;
+	}
+
+	// Estimated counts per site, the most bytes first.
+	void write(std::ostream& out) const;
+};
+
+} //namespace vm
+
+#endif /* VM_ALLOCATIONPROFILER_H_ */
@@ -0,0 +1,613 @@
+#include "ClosureTier.h"
+
+#include "Frame.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <cstring>
+
+using namespace vm;
+
+using Kind = prog::Instruction::Reg::Kind;
+using Op = prog::Instruction::Operation;
+
+static constexpr uint32_t leave = UINT32_MAX;
+
+struct ClosureTier::Context
+{
+	Vm& vm;
+	Vm::ExecutionState& es;
+	Vm::Results& results;
+	Reference& awaited;
+	Vm::Exit exit;
+
+	const decltype(prog::Function::code)::const_iterator begin;
+	Value* const scalars;
+	Reference* const references;
+	Value* const staticScalars;
+	Reference* const staticReferences;
+};
+
+/*
+ * Calls the continuation with the operand kind as a compile time constant.
+ */
+template<class C>
+static inline auto withKind(Kind k, C&& c)
+{
+	switch(k)
+	{
+	case Kind::Tos:
+		return c(std::integral_constant<Kind, Kind::Tos>());
+	case Kind::Local:
+		return c(std::integral_constant<Kind, Kind::Local>());
+	default:
+		return c(std::integral_constant<Kind, Kind::Global>());
+	}
+}
+
+static inline Value identity(Value v) { return v; }
+static inline Value neg(Value v) { return ~v.integer; }
+static inline Value i2f(Value v) { return (float)v.integer; }
+static inline Value f2i(Value v) { return (int)v.floating; }
+
+static inline Value addI(Value a, Value b) { return a.integer + b.integer; }
+static inline Value subI(Value a, Value b) { return a.integer - b.integer; }
+static inline Value mulI(Value a, Value b) { return a.integer * b.integer; }
+static inline Value andI(Value a, Value b) { return a.integer & b.integer; }
+static inline Value orI(Value a, Value b) { return a.integer | b.integer; }
+static inline Value xorI(Value a, Value b) { return a.integer ^ b.integer; }
+static inline Value addF(Value a, Value b) { return a.floating + b.floating; }
+static inline Value subF(Value a, Value b) { return a.floating - b.floating; }
+static inline Value mulF(Value a, Value b) { return a.floating * b.floating; }
+static inline Value divF(Value a, Value b) { return a.floating / b.floating; }
+
+static inline bool eq(Value a, Value b) { return a.integer == b.integer; }
+static inline bool ne(Value a, Value b) { return a.integer != b.integer; }
+static inline bool ltI(Value a, Value b) { return a.integer < b.integer; }
+static inline bool gtI(Value a, Value b) { return a.integer > b.integer; }
+static inline bool leI(Value a, Value b) { return a.integer <= b.integer; }
+static inline bool geI(Value a, Value b) { return a.integer >= b.integer; }
+static inline bool ltF(Value a, Value b) { return a.floating < b.floating; }
+static inline bool gtF(Value a, Value b) { return a.floating > b.floating; }
+static inline bool leF(Value a, Value b) { return a.floating <= b.floating; }
+static inline bool geF(Value a, Value b) { return a.floating >= b.floating; }
+
+/*
+ * Handlers, returning the index of the next one.
+ */
+struct ClosureTier::Handlers
+{
+	template<Kind k>
+	static inline Value reads(Context& c, uint16_t idx)
+	{
+		if constexpr(k == Kind::Tos)
+		{
+			return c.scalars[--c.es.scalarStackPointer];
+		}
+		else if constexpr(k == Kind::Local)
+		{
+			return c.scalars[idx];
+		}
+		else
+		{
+			return c.staticScalars[idx];
+		}
+	}
+
+	template<Kind k>
+	static inline void writes(Context& c, uint16_t idx, Value v)
+	{
+		if constexpr(k == Kind::Tos)
+		{
+			c.scalars[c.es.scalarStackPointer++] = v;
+		}
+		else if constexpr(k == Kind::Local)
+		{
+			c.scalars[idx] = v;
+		}
+		else
+		{
+			c.staticScalars[idx] = v;
+		}
+	}
+
+	template<Kind k>
+	static inline Reference readr(Context& c, uint16_t idx)
+	{
+		if constexpr(k == Kind::Tos)
+		{
+			auto &slot = c.references[--c.es.referenceStackPointer];
+			const auto ret = slot;
+			c.vm.storage.overwriting(ret);
+			storeReference(&slot, null);
+			return ret;
+		}
+		else if constexpr(k == Kind::Local)
+		{
+			return c.references[idx];
+		}
+		else
+		{
+			return c.staticReferences[idx];
+		}
+	}
+
+	template<Kind k>
+	static inline void writer(Context& c, uint16_t idx, Reference v)
+	{
+		if constexpr(k == Kind::Tos)
+		{
+			storeReference(&c.references[c.es.referenceStackPointer++], v);
+		}
+		else if constexpr(k == Kind::Local)
+		{
+			c.vm.storage.overwriting(c.references[idx]);
+			storeReference(&c.references[idx], v);
+		}
+		else
+		{
+			c.vm.storage.overwriting(c.staticReferences[idx]);
+			storeReference(&c.staticReferences[idx], v);
+		}
+	}
+
+	template<Kind x>
+	static uint32_t lit(Context& c, const Handler& h)
+	{
+		writes<x>(c, h.x, h.k);
+		return h.next;
+	}
+
+	template<Value (*op)(Value), Kind x, Kind y>
+	static uint32_t unary(Context& c, const Handler& h)
+	{
+		writes<x>(c, h.x, op(reads<y>(c, h.y)));
+		return h.next;
+	}
+
+	template<Value (*op)(Value, Value), Kind x, Kind y, Kind z>
+	static uint32_t binary(Context& c, const Handler& h)
+	{
+		const auto a = reads<y>(c, h.y);
+		const auto b = reads<z>(c, h.z);
+		writes<x>(c, h.x, op(a, b));
+		return h.next;
+	}
+
+	template<Value (*op)(Value, Value), Kind x, Kind y>
+	static uint32_t binaryLiteral(Context& c, const Handler& h)
+	{
+		writes<x>(c, h.x, op(reads<y>(c, h.y), h.k));
+		return h.next;
+	}
+
+	template<bool (*cond)(Value, Value), Kind x, Kind y>
+	static uint32_t conditional(Context& c, const Handler& h)
+	{
+		const auto a = reads<x>(c, h.x);
+		const auto b = reads<y>(c, h.y);
+		return cond(a, b) ? h.imm : h.next;
+	}
+
+	template<bool (*cond)(Value, Value), Kind x>
+	static uint32_t conditionalLiteral(Context& c, const Handler& h) {
+		return cond(reads<x>(c, h.x), h.k) ? h.imm : h.next;
+	}
+
+	template<bool isNull, Kind x>
+	static uint32_t nullCheck(Context& c, const Handler& h) {
+		return (readr<x>(c, h.x) == null) == isNull ? h.imm : h.next;
+	}
+
+	static uint32_t jump(Context& c, const Handler& h) {
+		return h.imm;
+	}
+
+	template<Kind x, Kind y>
+	static uint32_t movr(Context& c, const Handler& h)
+	{
+		writer<x>(c, h.x, readr<y>(c, h.y));
+		return h.next;
+	}
+
+	template<Kind x, Kind y>
+	static uint32_t gets(Context& c, const Handler& h)
+	{
+		writes<x>(c, h.x, c.vm.storage.reads(readr<y>(c, h.y), h.imm));
+		return h.next;
+	}
+
+	template<Kind x, Kind y>
+	static uint32_t puts(Context& c, const Handler& h)
+	{
+		const auto o = readr<y>(c, h.y);
+		c.vm.storage.writes(o, h.imm, reads<x>(c, h.x));
+		return h.next;
+	}
+
+	template<class T, Kind x, Kind y>
+	static uint32_t getPacked(Context& c, const Handler& h)
+	{
+		T v;
+		memcpy(&v, c.vm.storage.accessBytes(readr<y>(c, h.y), h.imm, sizeof(T)), sizeof(T));
+		writes<x>(c, h.x, (int)v);
+		return h.next;
+	}
+
+	template<class T, Kind x, Kind y>
+	static uint32_t putPacked(Context& c, const Handler& h)
+	{
+		const auto o = readr<y>(c, h.y);
+		const T v = (T)reads<x>(c, h.x).integer;
+		memcpy(c.vm.storage.accessBytes(o, h.imm, sizeof(T)), &v, sizeof(T));
+		return h.next;
+	}
+
+	template<Kind x, Kind y>
+	static uint32_t getr(Context& c, const Handler& h)
+	{
+		writer<x>(c, h.x, c.vm.storage.readr(readr<y>(c, h.y), h.imm));
+		return h.next;
+	}
+
+	template<Kind x, Kind y>
+	static uint32_t putr(Context& c, const Handler& h)
+	{
+		const auto o = readr<y>(c, h.y);
+		c.vm.storage.writer(o, h.imm, readr<x>(c, h.x));
+		return h.next;
+	}
+
+	static inline uint32_t call(Context& c, const Handler& h, const Vm::Callee& callee)
+	{
+		c.es.isnIt = c.begin + h.next;
+		c.exit = c.vm.invoke(c.es, callee, h.x, h.y);
+		return leave;
+	}
+
+	/*
+	 * Call with the target resolved at translation, the literal pushed for it is dropped unread.
+	 */
+	template<bool isPushed>
+	static uint32_t directCall(Context& c, const Handler& h)
+	{
+		if constexpr(isPushed)
+		{
+			c.es.scalarStackPointer--;
+		}
+
+		return call(c, h, *h.callee);
+	}
+
+	/*
+	 * Bound call made in place of pushing its target, the call instruction is skipped.
+	 */
+	static uint32_t fusedCall(Context& c, const Handler& h)
+	{
+		c.vm.statistics.instructions++;
+		return call(c, h, *h.callee);
+	}
+
+	/*
+	 * Call with the target taken from the stack, through the callee table decoded by the Vm.
+	 */
+	static uint32_t indirectCall(Context& c, const Handler& h)
+	{
+		const auto idx = (uint32_t)reads<Kind::Tos>(c, 0).integer;
+		assert(idx < c.vm.decoded.callees.size());
+		return call(c, h, c.vm.decoded.callees[idx]);
+	}
+
+	/*
+	 * Executes the instruction in the interpreter, leaves if it ended up in another frame.
+	 */
+	static uint32_t fallback(Context& c, const Handler& h)
+	{
+		const auto frame = c.es.frame;
+		c.es.isnIt = c.begin + h.next;
+		c.exit = c.vm.interpret(c.es, *h.isn, c.results, c.awaited);
+
+		if(c.exit != Vm::Exit::Continue || c.es.frame != frame)
+		{
+			if(c.exit == Vm::Exit::Continue)
+			{
+				c.exit = Vm::Exit::Transfer;
+			}
+
+			return leave;
+		}
+
+		return (uint32_t)(c.es.isnIt - c.begin);
+	}
+};
+
+ClosureTier::Fn ClosureTier::select(const prog::Instruction& isn)
+{
+	const auto x = isn.x.kind, y = isn.y.kind, z = isn.z.kind;
+
+	const auto unary = [&](auto op)
+	{
+		return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn {
+			return &Handlers::unary<decltype(op)::value, kx(), ky()>;
+		});});
+	};
+
+	const auto binary = [&](auto op)
+	{
+		return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky){ return withKind(z, [&](auto kz) -> Fn {
+			return &Handlers::binary<decltype(op)::value, kx(), ky(), kz()>;
+		});});});
+	};
+
+	const auto binaryLiteral = [&](auto op)
+	{
+		return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn {
+			return &Handlers::binaryLiteral<decltype(op)::value, kx(), ky()>;
+		});});
+	};
+
+	const auto conditional = [&](auto cond)
+	{
+		return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn {
+			return &Handlers::conditional<decltype(cond)::value, kx(), ky()>;
+		});});
+	};
+
+	const auto conditionalLiteral = [&](auto cond)
+	{
+		return withKind(x, [&](auto kx) -> Fn {
+			return &Handlers::conditionalLiteral<decltype(cond)::value, kx()>;
+		});
+	};
+
+#define UNARY(f) unary(std::integral_constant<Value (*)(Value), &f>())
+#define BINARY(f) binary(std::integral_constant<Value (*)(Value, Value), &f>())
+#define BINARY_LITERAL(f) binaryLiteral(std::integral_constant<Value (*)(Value, Value), &f>())
+#define CONDITIONAL(f) conditional(std::integral_constant<bool (*)(Value, Value), &f>())
+#define CONDITIONAL_LITERAL(f) conditionalLiteral(std::integral_constant<bool (*)(Value, Value), &f>())
+#define PACKED(f, T) withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn { return &Handlers::f<T, kx(), ky()>; }); })
+
+	switch(isn.op)
+	{
+	case Op::lit:   return withKind(x, [](auto kx) -> Fn { return &Handlers::lit<kx()>; });
+	case Op::mov:   return UNARY(identity);
+	case Op::neg:   return UNARY(neg);
+	case Op::i2f:   return UNARY(i2f);
+	case Op::f2i:   return UNARY(f2i);
+	case Op::addI:  return BINARY(addI);
+	case Op::subI:  return BINARY(subI);
+	case Op::mulI:  return BINARY(mulI);
+	case Op::andI:  return BINARY(andI);
+	case Op::orI:   return BINARY(orI);
+	case Op::xorI:  return BINARY(xorI);
+	case Op::addF:  return BINARY(addF);
+	case Op::subF:  return BINARY(subF);
+	case Op::mulF:  return BINARY(mulF);
+	case Op::divF:  return BINARY(divF);
+	case Op::addIL: return BINARY_LITERAL(addI);
+	case Op::subIL: return BINARY_LITERAL(subI);
+	case Op::jEq:   return CONDITIONAL(eq);
+	case Op::jNe:   return CONDITIONAL(ne);
+	case Op::jLtI:  return CONDITIONAL(ltI);
+	case Op::jGtI:  return CONDITIONAL(gtI);
+	case Op::jLeI:  return CONDITIONAL(leI);
+	case Op::jGeI:  return CONDITIONAL(geI);
+	case Op::jLtF:  return CONDITIONAL(ltF);
+	case Op::jGtF:  return CONDITIONAL(gtF);
+	case Op::jLeF:  return CONDITIONAL(leF);
+	case Op::jGeF:  return CONDITIONAL(geF);
+	case Op::jEqL:  return CONDITIONAL_LITERAL(eq);
+	case Op::jNeL:  return CONDITIONAL_LITERAL(ne);
+	case Op::jLtIL: return CONDITIONAL_LITERAL(ltI);
+	case Op::jNul:  return withKind(x, [](auto kx) -> Fn { return &Handlers::nullCheck<true, kx()>; });
+	case Op::jNnl:  return withKind(x, [](auto kx) -> Fn { return &Handlers::nullCheck<false, kx()>; });
+	case Op::jump:  return &Handlers::jump;
+	case Op::movr:  return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn { return &Handlers::movr<kx(), ky()>; }); });
+	case Op::gets:  return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn { return &Handlers::gets<kx(), ky()>; }); });
+	case Op::puts:  return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn { return &Handlers::puts<kx(), ky()>; }); });
+	case Op::gets1i: return PACKED(getPacked, int8_t);
+	case Op::gets1u: return PACKED(getPacked, uint8_t);
+	case Op::gets2i: return PACKED(getPacked, int16_t);
+	case Op::gets2u: return PACKED(getPacked, uint16_t);
+	case Op::gets4:  return PACKED(getPacked, int32_t);
+	case Op::puts1:  return PACKED(putPacked, uint8_t);
+	case Op::puts2:  return PACKED(putPacked, uint16_t);
+	case Op::puts4:  return PACKED(putPacked, uint32_t);
+	case Op::getr:  return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn { return &Handlers::getr<kx(), ky()>; }); });
+	case Op::putr:  return withKind(x, [&](auto kx){ return withKind(y, [&](auto ky) -> Fn { return &Handlers::putr<kx(), ky()>; }); });
+	default:        return &Handlers::fallback;
+	}
+
+#undef UNARY
+#undef BINARY
+#undef BINARY_LITERAL
+#undef CONDITIONAL
+#undef CONDITIONAL_LITERAL
+#undef PACKED
+}
+
+/*
+ * Checks that the local and global operands are within their frame or the static object.
+ */
+static bool isValid(const prog::Instruction& isn, const prog::Function& f, const prog::TypeInfo& statics)
+{
+	const auto scalar = [&](const prog::Instruction::Reg& r)
+	{
+		return r.kind == Kind::Tos
+			|| (r.kind == Kind::Local && r.index < f.nScalars)
+			|| (r.kind == Kind::Global && r.index < statics.nScalars);
+	};
+
+	const auto reference = [&](const prog::Instruction::Reg& r)
+	{
+		return r.kind == Kind::Tos
+			|| (r.kind == Kind::Local && r.index < f.nRefs)
+			|| (r.kind == Kind::Global && r.index < statics.nReferences);
+	};
+
+	switch(isn.op)
+	{
+	case Op::lit: case Op::jEqL: case Op::jNeL: case Op::jLtIL:
+		return scalar(isn.x);
+	case Op::jNul: case Op::jNnl:
+		return reference(isn.x);
+	case Op::movr: case Op::getr:
+		return reference(isn.x) && reference(isn.y);
+	case Op::putr: // Both from the stack would depend on the evaluation order of the interpreter.
+		return reference(isn.x) && reference(isn.y) && (isn.x.kind != Kind::Tos || isn.y.kind != Kind::Tos);
+	case Op::gets: case Op::puts:
+	case Op::gets1i: case Op::gets1u: case Op::gets2i: case Op::gets2u: case Op::gets4:
+	case Op::puts1: case Op::puts2: case Op::puts4:
+		return scalar(isn.x) && reference(isn.y);
+	case Op::jump: case Op::call: case Op::callL:
+		return true;
+	default:
+		return scalar(isn.x) && scalar(isn.y) && scalar(isn.z);
+	}
+}
+
+ClosureTier::ClosureTier(Vm& vm, uint32_t callThreshold, uint32_t backEdgeThreshold):
+	vm(vm),
+	callThreshold(callThreshold),
+	backEdgeThreshold(backEdgeThreshold),
+	calls(vm.program.functions.size()),
+	backEdges(vm.program.functions.size()),
+	compiled(vm.program.functions.size()) {}
+
+void ClosureTier::compile(uint32_t fnIdx)
+{
+	const auto &f = vm.program.functions[fnIdx];
+	auto &handlers = compiled[fnIdx];
+
+	std::vector<bool> isTarget(f.code.size());
+
+	const auto mark = [&](uint32_t target)
+	{
+		assert(target < isTarget.size());
+		isTarget[target] = true;
+	};
+
+	for(const auto &isn: f.code)
+	{
+		switch(isn.op)
+		{
+		case Op::jEqL: case Op::jNeL: case Op::jLtIL:
+			mark(isn.imm2);
+			break;
+		case Op::jNul: case Op::jNnl: case Op::jump:
+		case Op::jEq: case Op::jNe: case Op::jLtI: case Op::jGtI: case Op::jLeI: case Op::jGeI:
+		case Op::jLtU: case Op::jGtU: case Op::jLeU: case Op::jGeU: case Op::jLtF: case Op::jGtF: case Op::jLeF: case Op::jGeF:
+			mark(isn.imm);
+			break;
+		default:
+			break;
+		}
+	}
+
+	for(const auto &h: f.handlers)
+	{
+		mark(h.target);
+	}
+
+	for(auto i = 0u; i < f.code.size(); i++)
+	{
+		const auto &isn = f.code[i];
+
+		Handler h;
+		h.fn = isValid(isn, f, vm.program.types[0]) ? select(isn) : &Handlers::fallback;
+		h.x = isn.x.index;
+		h.y = isn.y.index;
+		h.z = isn.z.index;
+		h.k = (int)isn.imm;
+		h.next = i + 1;
+		h.imm = isn.imm;
+		h.isn = &isn;
+		h.callee = nullptr;
+
+		switch(isn.op)
+		{
+		case Op::jEqL: case Op::jNeL: case Op::jLtIL:
+			h.imm = isn.imm2;
+			break;
+		case Op::call: case Op::callL:
+			bind(handlers, h, f, i, isTarget);
+			break;
+		default:
+			break;
+		}
+
+		handlers.push_back(h);
+	}
+
+	vm.statistics.tierUps++;
+}
+
+/*
+ * Resolves the target of a call instruction, constant ones (callL or a call right after
+ * pushing a literal, if not jumped to in between) are bound directly, the rest look it up
+ * in the callee table. The literal pushed for a bound call is only needed if the call is
+ * entered directly, so its handler is replaced by one making the call right away.
+ */
+void ClosureTier::bind(std::vector<Handler>& handlers, Handler& h, const prog::Function& f, uint32_t offset, const std::vector<bool>& isTarget)
+{
+	const auto &isn = f.code[offset];
+
+	if(isn.op == Op::callL)
+	{
+		h.fn = &Handlers::directCall<false>;
+		h.callee = &vm.decoded.callees[isn.imm];
+		h.x = (uint16_t)(isn.imm2 >> 16);
+		h.y = (uint16_t)(isn.imm2 & 0xffff);
+		return;
+	}
+
+	h.x = (uint16_t)isn.imm;
+	h.y = (uint16_t)isn.imm2;
+
+	if(offset && !isTarget[offset])
+	{
+		const auto &prev = f.code[offset - 1];
+
+		if(prev.op == Op::lit && prev.x.kind == Kind::Tos && prev.imm < vm.decoded.callees.size())
+		{
+			h.fn = &Handlers::directCall<true>;
+			h.callee = &vm.decoded.callees[prev.imm];
+
+			auto &pushing = handlers.back();
+			pushing = h;
+			pushing.fn = &Handlers::fusedCall;
+			pushing.isn = &prev;
+			return;
+		}
+	}
+
+	h.fn = &Handlers::indirectCall;
+}
+
+size_t ClosureTier::getCompiledCount() const {
+	return std::count_if(compiled.begin(), compiled.end(), [](const auto& c){ return !c.empty(); });
+}
+
+Vm::Exit ClosureTier::run(Vm::ExecutionState& es, Vm::Results& results, Reference& awaited)
+{
+	const auto &handlers = compiled[es.functionIndex];
+	const auto begin = vm.program.functions[es.functionIndex].code.cbegin();
+
+	Context c
+	{
+		vm, es, results, awaited, Vm::Exit::Continue, begin,
+		vm.storage.accessScalars(es.frame) + Frame::Scalar::stackOffset,
+		vm.storage.accessReferences(es.frame) + Frame::Reference::stackOffset,
+		vm.storage.accessScalars(vm.staticObject),
+		vm.storage.accessReferences(vm.staticObject)
+	};
+
+	for(auto pc = (uint32_t)(es.isnIt - begin); pc != leave;)
+	{
+		vm.statistics.instructions++;
+		const auto &h = handlers[pc];
+		pc = h.fn(c, h);
+	}
+
+	return c.exit;
+}
@@ -0,0 +1,81 @@
+#ifndef VM_CLOSURETIER_H_
+#define VM_CLOSURETIER_H_
+
+#include "Vm.h"
+
+#include <vector>
+
+namespace vm {
+
+/*
+ * Second execution tier, hot functions are translated into arrays of pre-bound handlers.
+ *
+ * Every instruction is turned into a handler specialized for its operation and operand
+ * kinds, with the operands decoded in advance and working on the raw frame contents. The
+ * rest of the instructions are passed back to the interpreter one by one. Handlers map one
+ * to one to the instructions, so execution can switch tiers at any instruction boundary.
+ *
+ * Operand indices are checked at translation, but unlike the interpreter the depth of the
+ * operand stacks is not, so the code is expected to be already proven by the interpreter.
+ */
+class ClosureTier
+{
+	struct Context;
+	struct Handler;
+	struct Handlers;
+	typedef uint32_t (*Fn)(Context& c, const Handler& h);
+
+	struct Handler
+	{
+		Fn fn;
+		uint16_t x, y, z;
+		Value k;
+		uint32_t next, imm;
+		const prog::Instruction* isn;
+
+		// Target of a call bound at translation.
+		const Vm::Callee* callee;
+	};
+
+	Vm& vm;
+	const uint32_t callThreshold, backEdgeThreshold;
+	std::vector<uint32_t> calls, backEdges;
+	std::vector<std::vector<Handler>> compiled;
+
+	static Fn select(const prog::Instruction& isn);
+	void bind(std::vector<Handler>& handlers, Handler& h, const prog::Function& f, uint32_t offset, const std::vector<bool>& isTarget);
+	void compile(uint32_t fnIdx);
+
+public:
+	ClosureTier(Vm& vm, uint32_t callThreshold, uint32_t backEdgeThreshold);
+
+	inline bool isCompiled(uint32_t fnIdx) const {
+		return !compiled[fnIdx].empty();
+	}
+
+	inline void countCall(uint32_t fnIdx)
+	{
+		if(++calls[fnIdx] == callThreshold)
+		{
+			compile(fnIdx);
+		}
+	}
+
+	inline bool countBackEdge(uint32_t fnIdx)
+	{
+		if(++backEdges[fnIdx] == backEdgeThreshold)
+		{
+			compile(fnIdx);
+		}
+
+		return isCompiled(fnIdx);
+	}
+
+	size_t getCompiledCount() const;
+
+	Vm::Exit run(Vm::ExecutionState& es, Vm::Results& results, Reference& awaited);
+};
+
+} //namespace vm
+
+#endif /* VM_CLOSURETIER_H_ */
@@ -0,0 +1,28 @@
+#ifndef VM_FRAME_H_
+#define VM_FRAME_H_
+
+namespace vm {
+
+/*
+ * Layout of the frame objects, the operand stacks start after the bookkeeping fields.
+ */
+struct Frame
+{
+	struct Scalar
+	{
+		static constexpr auto scalarTosIndexOffset = 0;
+		static constexpr auto referenceTosIndexOffset = 1;
+		static constexpr auto stackOffset = 2;
+		static constexpr auto extra = 2;
+	};
+
+	struct Reference
+	{
+		static constexpr auto callerFrameReferenceOffset = 0;
+		static constexpr auto stackOffset = 1;
+	};
+};
+
+} //namespace vm
+
+#endif /* VM_FRAME_H_ */
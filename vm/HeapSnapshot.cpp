@@ -0,0 +1,231 @@
+#include "HeapSnapshot.h"
+
+#include "assert.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace vm;
+
+/*
+ * Iterative dominator calculation (Cooper, Harvey, Kennedy) with a virtual node above the roots,
+ * then the retained sizes are summed up the dominator tree in reverse postorder.
+ */
+void HeapSnapshot::analyze()
+{
+	const auto n = (uint32_t)objects.size(), top = n;
+
+	const auto successors = [&](uint32_t i) -> std::vector<uint32_t>
+	{
+		if(i == top)
+		{
+			std::vector<uint32_t> ret(nRoots);
+			std::iota(ret.begin(), ret.end(), 0);
+			return ret;
+		}
+
+		return objects[i].edges;
+	};
+
+	std::vector<uint32_t> postorder, order(n + 1, none);
+	std::vector<std::pair<uint32_t, std::vector<uint32_t>>> stack{{top, successors(top)}};
+	order[top] = 0;
+
+	while(!stack.empty())
+	{
+		auto &s = stack.back();
+
+		if(s.second.empty())
+		{
+			order[s.first] = (uint32_t)postorder.size();
+			postorder.push_back(s.first);
+			stack.pop_back();
+		}
+		else
+		{
+			const auto next = s.second.back();
+			s.second.pop_back();
+
+			if(order[next] == none)
+			{
+				order[next] = 0;
+				stack.push_back({next, successors(next)});
+			}
+		}
+	}
+
+	assert(postorder.size() == n + 1);
+
+	std::vector<std::vector<uint32_t>> predecessors(n);
+	for(auto i = 0u; i < n; i++)
+	{
+		std::for_each(objects[i].edges.begin(), objects[i].edges.end(), [&](auto e){ predecessors[e].push_back(i); });
+	}
+
+	for(auto i = 0u; i < nRoots; i++)
+	{
+		predecessors[i].push_back(top);
+	}
+
+	std::vector<uint32_t> idom(n + 1, none);
+	idom[top] = top;
+
+	const auto intersect = [&](uint32_t a, uint32_t b)
+	{
+		while(a != b)
+		{
+			while(order[a] < order[b]) a = idom[a];
+			while(order[b] < order[a]) b = idom[b];
+		}
+
+		return a;
+	};
+
+	for(bool changed = true; changed;)
+	{
+		changed = false;
+
+		for(auto it = postorder.rbegin() + 1; it != postorder.rend(); it++)
+		{
+			auto d = none;
+
+			for(const auto p: predecessors[*it])
+			{
+				if(idom[p] != none)
+				{
+					d = (d == none) ? p : intersect(p, d);
+				}
+			}
+
+			if(idom[*it] != d)
+			{
+				idom[*it] = d;
+				changed = true;
+			}
+		}
+	}
+
+	for(auto i = 0u; i < n; i++)
+	{
+		objects[i].dominator = (idom[i] == top) ? none : idom[i];
+		objects[i].retained = objects[i].size;
+	}
+
+	for(const auto i: postorder)
+	{
+		if(i != top && objects[i].dominator != none)
+		{
+			objects[objects[i].dominator].retained += objects[i].retained;
+		}
+	}
+
+	analyzed = true;
+}
+
+uint64_t HeapSnapshot::getTotalSize() const {
+	return std::accumulate(objects.begin(), objects.end(), (uint64_t)0, [](auto acc, const auto& o){ return acc + o.size; });
+}
+
+std::map<uint32_t, HeapSnapshot::TypeStatistics> HeapSnapshot::getTypeStatistics() const
+{
+	assert(analyzed);
+
+	std::map<uint32_t, TypeStatistics> ret;
+	std::vector<std::vector<uint32_t>> children(objects.size());
+	std::vector<uint32_t> tops;
+
+	for(auto i = 0u; i < objects.size(); i++)
+	{
+		auto &s = ret[objects[i].typeIdx];
+		s.count++;
+		s.bytes += objects[i].size;
+
+		(objects[i].dominator == none ? tops : children[objects[i].dominator]).push_back(i);
+	}
+
+	// Walks the dominator tree counting the instances of each type on the path from the top.
+	std::map<uint32_t, size_t> active;
+	std::vector<std::pair<uint32_t, bool>> toDo;
+	std::transform(tops.begin(), tops.end(), std::back_inserter(toDo), [](auto i){ return std::make_pair(i, true); });
+
+	while(!toDo.empty())
+	{
+		const auto [i, isEnter] = toDo.back();
+		toDo.pop_back();
+
+		const auto &o = objects[i];
+
+		if(isEnter)
+		{
+			if(active[o.typeIdx]++ == 0)
+			{
+				ret[o.typeIdx].retained += o.retained;
+			}
+
+			toDo.push_back({i, false});
+			std::transform(children[i].begin(), children[i].end(), std::back_inserter(toDo), [](auto c){ return std::make_pair(c, true); });
+		}
+		else
+		{
+			active[o.typeIdx]--;
+		}
+	}
+
+	return ret;
+}
+
+/*
+ * Dominators retain at least as much as the objects they dominate, so the candidates not listed for
+ * being dominated by another one are the ones with a dominator other than a root.
+ */
+std::vector<uint32_t> HeapSnapshot::getLeakSuspects(double minShare, size_t limit) const
+{
+	assert(analyzed);
+
+	const auto threshold = minShare * (double)getTotalSize();
+
+	std::vector<uint32_t> ret;
+	for(auto i = (uint32_t)nRoots; i < objects.size(); i++)
+	{
+		const auto &o = objects[i];
+
+		if((double)o.retained >= threshold && (o.dominator == none || o.dominator < nRoots))
+		{
+			ret.push_back(i);
+		}
+	}
+
+	std::stable_sort(ret.begin(), ret.end(), [&](auto a, auto b){ return objects[a].retained > objects[b].retained; });
+	ret.resize(std::min(ret.size(), limit));
+	return ret;
+}
+
+void HeapSnapshot::write(std::ostream& out) const
+{
+	assert(analyzed);
+
+	out << "heap " << objects.size() << " " << getTotalSize() << " " << nRoots << std::endl;
+
+	for(const auto& [idx, s]: getTypeStatistics())
+	{
+		out << "type " << idx << " " << s.count << " " << s.bytes << " " << s.retained << std::endl;
+	}
+
+	for(auto i = 0u; i < objects.size(); i++)
+	{
+		const auto &o = objects[i];
+		out << "object " << i << " " << o.typeIdx << " " << o.size << " " << o.retained << " ";
+
+		if(o.dominator == none)
+		{
+			out << "-";
+		}
+		else
+		{
+			out << o.dominator;
+		}
+
+		std::for_each(o.edges.begin(), o.edges.end(), [&](auto e){ out << " " << e; });
+		out << std::endl;
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef VM_HEAPSNAPSHOT_H_
+#define VM_HEAPSNAPSHOT_H_
+
+#include "Reference.h"
+
+#include <map>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+namespace vm {
+
+/*
+ * Copy of the object graph reachable from a set of roots, taken by Storage::snapshot.
+ *
+ * Taking it is a single traversal like the marking of a collection, everything else is done on
+ * the copy without accessing the storage, so it can be analyzed while the VM keeps running.
+ *
+ * Objects are numbered in breadth first order from the roots, so the snapshots of deterministic
+ * programs are comparable between runs. An object is dominated by another one if every path from
+ * the roots to it goes through the other one, the retained size is what would be freed with it.
+ */
+class HeapSnapshot
+{
+public:
+	static constexpr uint32_t none = -1u;
+
+	struct Object
+	{
+		Reference ref;
+		uint32_t typeIdx;
+		uint32_t size;                      // Bytes of the fields and the byte area
+		std::vector<uint32_t> edges;        // Referenced objects, by index in the snapshot
+
+		uint32_t dominator = none;          // Immediate dominator, none if only the roots dominate it
+		uint64_t retained = 0;
+	};
+
+	struct TypeStatistics
+	{
+		size_t count = 0;
+		uint64_t bytes = 0;
+
+		// Not counting instances dominated by another one of the same type, to avoid counting twice.
+		uint64_t retained = 0;
+	};
+
+private:
+	friend struct Storage;
+
+	std::vector<Object> objects;
+	size_t nRoots = 0;                      // The roots are the first objects
+	bool analyzed = false;
+
+public:
+	// Computes the dominators and the retained sizes, can be done on any thread.
+	void analyze();
+
+	inline const std::vector<Object>& getObjects() const {
+		return objects;
+	}
+
+	inline size_t getRootCount() const {
+		return nRoots;
+	}
+
+	uint64_t getTotalSize() const;
+	std::map<uint32_t, TypeStatistics> getTypeStatistics() const;
+
+	/*
+	 * Objects retaining at least the given share of the heap, the most retaining first. The roots are
+	 * not listed, neither are the objects dominated by one already listed (like the rest of a list).
+	 */
+	std::vector<uint32_t> getLeakSuspects(double minShare = 0.1, size_t limit = 10) const;
+
+	// Text format, one line per type and then per object, to be compared with generic diff tools.
+	void write(std::ostream& out) const;
+};
+
+} //namespace vm
+
+#endif /* VM_HEAPSNAPSHOT_H_ */
@@ -0,0 +1,36 @@
+#ifndef VM_NATIVE_H_
+#define VM_NATIVE_H_
+
+#include "Value.h"
+#include "Reference.h"
+
+#include <cstdint>
+
+namespace vm {
+
+struct Storage;
+
+/*
+ * Direct view of the argument slots of a native call, located on the operand stack of the caller.
+ *
+ * Arguments are in push order (the first argument is at index zero), results are to be written
+ * in place starting from index zero as well. The pointers are valid only during the call, the
+ * references are to be written with storeReference.
+ */
+struct NativeFrame
+{
+	Storage& storage;
+	Reference* const references;
+	Value* const scalars;
+};
+
+struct NativeFunction
+{
+	void (*fn)(NativeFrame& frame);
+	uint16_t nArgReferences, nArgScalars;
+	uint16_t nRetReferences, nRetScalars;
+};
+
+} //namespace vm
+
+#endif /* VM_NATIVE_H_ */
@@ -0,0 +1,178 @@
+#include "Profiler.h"
+
+#include <algorithm>
+
+using namespace vm;
+
+Profiler::Counter& Profiler::function(uint32_t idx)
+{
+	if(functions.size() <= idx)
+	{
+		functions.resize(idx + 1);
+	}
+
+	return functions[idx];
+}
+
+Profiler::Counter& Profiler::offset(uint32_t functionIndex, uint32_t offset)
+{
+	if(offsets.size() <= functionIndex)
+	{
+		offsets.resize(functionIndex + 1);
+	}
+
+	auto &f = offsets[functionIndex];
+
+	if(f.size() <= offset)
+	{
+		f.resize(offset + 1);
+	}
+
+	return f[offset];
+}
+
+void Profiler::account()
+{
+	if(running)
+	{
+		charge(now());
+		running = false;
+	}
+}
+
+void Profiler::record(prog::Instruction::Operation op)
+{
+	if(history.empty())
+	{
+		history.push_back(current.op);
+	}
+
+	history.push_back(op);
+
+	if(history.size() > maxSequenceLength)
+	{
+		history.erase(history.begin());
+	}
+
+	for(auto it = history.begin(); it + 1 != history.end(); it++)
+	{
+		sequences[Sequence(it, history.end())]++;
+	}
+}
+
+void Profiler::flush()
+{
+	if(stackCycles)
+	{
+		stacks[stack] += stackCycles;
+		stackCycles = 0;
+	}
+}
+
+void Profiler::enter(std::vector<uint32_t> callStack)
+{
+	history.clear();
+	stack = std::move(callStack);
+}
+
+void Profiler::call(uint32_t calleeIndex)
+{
+	account();
+	flush();
+	history.clear();
+
+	edges[{stack.back(), calleeIndex}]++;
+	function(calleeIndex).count++;
+	stack.push_back(calleeIndex);
+}
+
+void Profiler::ret()
+{
+	account();
+	flush();
+	history.clear();
+	stack.pop_back();
+}
+
+void Profiler::leave()
+{
+	account();
+	flush();
+}
+
+void Profiler::writeFlat(std::ostream& out) const
+{
+	out << "# kind\tname\tcount\tcycles" << std::endl;
+
+	for(auto i = 0u; i < operations.size(); i++)
+	{
+		if(const auto &c = operations[i]; c.count)
+		{
+			out << "op\t" << prog::Instruction::getName((prog::Instruction::Operation)i) << "\t" << c.count << "\t" << c.cycles << std::endl;
+		}
+	}
+
+	for(auto i = 0u; i < functions.size(); i++)
+	{
+		if(const auto &c = functions[i]; c.count || c.cycles)
+		{
+			out << "fn\tfn" << i << "\t" << c.count << "\t" << c.cycles << std::endl;
+		}
+	}
+
+	for(auto i = 0u; i < offsets.size(); i++)
+	{
+		for(auto j = 0u; j < offsets[i].size(); j++)
+		{
+			if(const auto &c = offsets[i][j]; c.count)
+			{
+				out << "pc\tfn" << i << "+" << j << "\t" << c.count << "\t" << c.cycles << std::endl;
+			}
+		}
+	}
+
+	for(const auto &e: edges)
+	{
+		out << "call\tfn" << e.first.first << "->fn" << e.first.second << "\t" << e.second << "\t0" << std::endl;
+	}
+}
+
+void Profiler::writeFolded(std::ostream& out) const
+{
+	for(const auto &s: stacks)
+	{
+		const char* separator = "";
+
+		for(const auto f: s.first)
+		{
+			out << separator << "fn" << f;
+			separator = ";";
+		}
+
+		out << " " << s.second << std::endl;
+	}
+}
+
+void Profiler::writeSequences(std::ostream& out, size_t limit) const
+{
+	std::vector<std::pair<Sequence, uint64_t>> sorted(sequences.begin(), sequences.end());
+	std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b){ return a.second > b.second; });
+
+	if(sorted.size() > limit)
+	{
+		sorted.resize(limit);
+	}
+
+	for(const auto &s: sorted)
+	{
+		const char* separator = "";
+
+		for(const auto op: s.first)
+		{
+			out << separator << prog::Instruction::getName(op);
+			separator = ",";
+		}
+
+		out << "\t" << s.second << std::endl;
+	}
+}
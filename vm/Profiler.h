@@ -0,0 +1,148 @@
+#ifndef VM_PROFILER_H_
+#define VM_PROFILER_H_
+
+#include "program/Instruction.h"
+
+#include <array>
+#include <map>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace vm {
+
+/*
+ * Execution profile collected by the interpreter if built with VM_PROFILE defined.
+ *
+ * The time spent between two consecutive instructions is accounted to the former one,
+ * per operation, per function and per instruction offset. Counts are executions for
+ * operations and offsets and the number of calls for functions. Self time is also
+ * recorded per call stack (outermost function first) for flame graph generation.
+ *
+ * Sequences of operations executed at consecutive offsets are counted up to the length
+ * of maxSequenceLength, as candidates for superinstructions.
+ */
+class Profiler
+{
+public:
+	struct Counter
+	{
+		uint64_t count = 0;
+		uint64_t cycles = 0;
+	};
+
+	static constexpr size_t maxSequenceLength = 3;
+	typedef std::vector<prog::Instruction::Operation> Sequence;
+
+private:
+	struct Location
+	{
+		uint32_t functionIndex, offset;
+		prog::Instruction::Operation op;
+	};
+
+	std::array<Counter, prog::Instruction::operationCount> operations;
+	std::vector<Counter> functions;
+	std::vector<std::vector<Counter>> offsets;
+	std::map<std::pair<uint32_t, uint32_t>, uint64_t> edges;
+	std::map<std::vector<uint32_t>, uint64_t> stacks;
+	std::map<Sequence, uint64_t> sequences;
+
+	Sequence history;
+	std::vector<uint32_t> stack;
+	uint64_t stackCycles = 0;
+	uint64_t last = 0;
+	bool running = false;
+	Location current;
+
+	static inline uint64_t now()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	Counter& function(uint32_t idx);
+	Counter& offset(uint32_t functionIndex, uint32_t offset);
+	void account();
+	void flush();
+	void record(prog::Instruction::Operation op);
+
+	inline void charge(uint64_t t)
+	{
+		const auto d = t - last;
+		auto &o = operations[(size_t)current.op];
+		o.count++;
+		o.cycles += d;
+		stackCycles += d;
+
+		offset(current.functionIndex, current.offset).cycles += d;
+		function(current.functionIndex).cycles += d;
+	}
+
+public:
+	// Execution started or resumed with the given call stack.
+	void enter(std::vector<uint32_t> callStack);
+
+	inline void step(uint32_t functionIndex, uint32_t offset, prog::Instruction::Operation op)
+	{
+		const auto t = now();
+
+		if(running)
+		{
+			charge(t);
+
+			if(current.functionIndex == functionIndex && current.offset + 1 == offset)
+			{
+				record(op);
+			}
+			else
+			{
+				history.clear();
+			}
+		}
+
+		this->offset(functionIndex, offset).count++;
+		current = {functionIndex, offset, op};
+		running = true;
+		last = t;
+	}
+
+	void call(uint32_t calleeIndex);
+	void ret();
+
+	// Execution returned, yielded or is awaiting.
+	void leave();
+
+	inline const Counter& getOperation(prog::Instruction::Operation op) const {
+		return operations[(size_t)op];
+	}
+
+	inline const auto& getFunctions() const {
+		return functions;
+	}
+
+	inline const auto& getEdges() const {
+		return edges;
+	}
+
+	inline const auto& getSequences() const {
+		return sequences;
+	}
+
+	void writeFlat(std::ostream& out) const;
+	void writeFolded(std::ostream& out) const;
+	void writeSequences(std::ostream& out, size_t limit = SIZE_MAX) const;
+};
+
+} //namespace vm
+
+#endif /* VM_PROFILER_H_ */
@@ -8,6 +8,36 @@ namespace vm {
 typedef uint32_t Reference;
 static constexpr Reference null = 0;
 
+/*
+ * The reference fields of the objects may be read by the marker of a background collection while
+ * they are written, so the writes through raw pointers go through these. Relaxed is enough, as
+ * the barrier records the previous values and the ordering of the collection is by its locks.
+ */
+static inline Reference loadReference(const Reference* slot) {
+	return __atomic_load_n(slot, __ATOMIC_RELAXED);
+}
+
+static inline void storeReference(Reference* slot, Reference value) {
+	__atomic_store_n(slot, value, __ATOMIC_RELAXED);
+}
+
+template<class It>
+static inline void copyReferences(It begin, It end, Reference* to)
+{
+	for(auto it = begin; it != end; it++)
+	{
+		storeReference(to++, *it);
+	}
+}
+
+static inline void fillReferences(Reference* begin, Reference* end, Reference value)
+{
+	for(auto it = begin; it != end; it++)
+	{
+		storeReference(it, value);
+	}
+}
+
 } //namespace vm
 
 #endif /* OBJECT_REFERENCE_H_ */
@@ -0,0 +1,121 @@
+#include "Runtime.h"
+
+#include <thread>
+
+using namespace vm;
+
+Runtime::Runtime(const prog::Program &p, size_t nThreads, size_t timeSlice): decoded(p), timeSlice(timeSlice)
+{
+	assert(nThreads > 0 && timeSlice > 0);
+
+	for(auto i = 0u; i < nThreads; i++)
+	{
+		workers.push_back(std::make_unique<Worker>());
+	}
+}
+
+Runtime::Instance& Runtime::add()
+{
+	instances.push_back(std::make_unique<Instance>(decoded));
+	return *instances.back();
+}
+
+Runtime::Instance* Runtime::take(size_t workerIdx)
+{
+	for(auto i = 0u; i < workers.size(); i++)
+	{
+		auto& w = *workers[(workerIdx + i) % workers.size()];
+
+		std::lock_guard<std::mutex> l(w.lock);
+
+		if(!w.queue.empty())
+		{
+			if(i == 0)
+			{
+				const auto ret = w.queue.front();
+				w.queue.pop_front();
+				return ret;
+			}
+
+			const auto ret = w.queue.back();
+			w.queue.pop_back();
+			return ret;
+		}
+	}
+
+	return nullptr;
+}
+
+void Runtime::put(size_t workerIdx, Instance* instance)
+{
+	auto& w = *workers[workerIdx];
+	std::lock_guard<std::mutex> l(w.lock);
+	w.queue.push_back(instance);
+}
+
+size_t Runtime::work(size_t workerIdx)
+{
+	size_t ret = 0;
+
+	while(pending.load(std::memory_order_acquire))
+	{
+		if(const auto instance = take(workerIdx))
+		{
+			ret += instance->scheduler.run(timeSlice);
+
+			if(instance->scheduler.hasReady())
+			{
+				put(workerIdx, instance);
+			}
+			else
+			{
+				pending.fetch_sub(1, std::memory_order_release);
+			}
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	return ret;
+}
+
+size_t Runtime::run()
+{
+	size_t n = 0;
+
+	for(const auto& i: instances)
+	{
+		if(i->scheduler.hasReady())
+		{
+			workers[n++ % workers.size()]->queue.push_back(i.get());
+		}
+	}
+
+	pending = n;
+
+	std::vector<size_t> counts(workers.size());
+	std::vector<std::thread> threads;
+
+	for(auto i = 1u; i < workers.size(); i++)
+	{
+		threads.emplace_back([this, i, &counts](){ counts[i] = work(i); });
+	}
+
+	counts[0] = work(0);
+
+	for(auto& t: threads)
+	{
+		t.join();
+	}
+
+	size_t ret = 0;
+
+	for(const auto c: counts)
+	{
+		ret += c;
+	}
+
+	return ret;
+}
@@ -0,0 +1,70 @@
+#ifndef VM_RUNTIME_H_
+#define VM_RUNTIME_H_
+
+#include "Scheduler.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <vector>
+
+namespace vm {
+
+/*
+ * Independent VM instances sharing the same immutable program, executed by a pool of host threads.
+ * The program is decoded once, the instances all run from the same decoded tables.
+ *
+ * Every instance has its own storage and scheduler and is run by a single thread at a time, for a
+ * time slice of a bounded number of context switches. Threads cycle through the instances of their own
+ * queue round-robin, idle threads steal from the back of the queues of the others.
+ */
+class Runtime
+{
+public:
+	struct Instance
+	{
+		Storage storage;
+		Vm vm;
+		Scheduler scheduler;
+
+		inline Instance(const Vm::Decoded &d): vm(storage, d), scheduler(vm) {}
+	};
+
+private:
+	struct Worker
+	{
+		std::mutex lock;
+		std::deque<Instance*> queue;
+	};
+
+	const Vm::Decoded decoded;
+	const size_t timeSlice;
+	std::vector<std::unique_ptr<Instance>> instances;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<size_t> pending;
+
+	Instance* take(size_t workerIdx);
+	void put(size_t workerIdx, Instance* instance);
+	size_t work(size_t workerIdx);
+
+public:
+	Runtime(const prog::Program &p, size_t nThreads, size_t timeSlice = 64);
+
+	Instance& add();
+
+	inline size_t getInstanceCount() const {
+		return instances.size();
+	}
+
+	inline Instance& getInstance(size_t idx) {
+		return *instances[idx];
+	}
+
+	// Runs until every instance is finished or blocked, returns the total number of context switches.
+	size_t run();
+};
+
+} //namespace vm
+
+#endif /* VM_RUNTIME_H_ */
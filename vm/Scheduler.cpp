@@ -0,0 +1,58 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+
+using namespace vm;
+
+Reference Scheduler::spawn(uint32_t fnIdx, std::vector<Reference> rargs, std::vector<Value> sargs)
+{
+	const auto ret = vm.startCoroutine(fnIdx, rargs, sargs);
+	ready.push_back(ret);
+	return ret;
+}
+
+size_t Scheduler::run(size_t limit)
+{
+	size_t ret = 0;
+
+	while(!ready.empty() && ret < limit)
+	{
+		const auto co = ready.front();
+		ready.pop_front();
+		ret++;
+
+		switch(vm.resumeCoroutine(co))
+		{
+		case Vm::CoroutineState::Yielded:
+			ready.push_back(co);
+			break;
+		case Vm::CoroutineState::Awaiting:
+			waiting.insert({vm.getAwaited(co), co});
+			break;
+		case Vm::CoroutineState::Finished:
+			{
+				const auto woken = waiting.equal_range(co);
+				std::transform(woken.first, woken.second, std::back_inserter(ready), [](const auto& p){ return p.second; });
+				waiting.erase(woken.first, woken.second);
+			}
+			break;
+		}
+	}
+
+	return ret;
+}
+
+std::vector<Reference> Scheduler::addRoots(std::vector<Reference> roots) const
+{
+	std::copy(ready.begin(), ready.end(), std::back_inserter(roots));
+	std::transform(waiting.begin(), waiting.end(), std::back_inserter(roots), [](const auto& p){ return p.second; });
+	return roots;
+}
+
+size_t Scheduler::gc(std::vector<Reference> roots) {
+	return vm.gc(addRoots(roots));
+}
+
+HeapSnapshot Scheduler::snapshot(std::vector<Reference> roots) const {
+	return vm.snapshot(addRoots(roots));
+}
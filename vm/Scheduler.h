@@ -0,0 +1,49 @@
+#ifndef VM_SCHEDULER_H_
+#define VM_SCHEDULER_H_
+
+#include "Vm.h"
+
+#include <deque>
+#include <map>
+#include <cstdint>
+
+namespace vm {
+
+/*
+ * Co-operative round-robin scheduler of coroutines running on a single VM instance.
+ */
+class Scheduler
+{
+	Vm& vm;
+	std::deque<Reference> ready;
+	std::multimap<Reference, Reference> waiting;
+
+	std::vector<Reference> addRoots(std::vector<Reference> roots) const;
+
+public:
+	inline Scheduler(Vm& vm): vm(vm) {}
+
+	Reference spawn(uint32_t fnIdx, std::vector<Reference> rargs, std::vector<Value> sargs);
+
+	/*
+	 * Runs until all the coroutines are finished or blocked or the switch limit is reached, returns the number of context switches.
+	 * A coroutine ended by an exception keeps it (see Vm::getException), it is raised again in the ones awaiting it.
+	 */
+	size_t run(size_t limit = SIZE_MAX);
+
+	// Only between runs, finished coroutines are kept if listed in the additional roots.
+	size_t gc(std::vector<Reference> roots = {});
+	HeapSnapshot snapshot(std::vector<Reference> roots = {}) const;
+
+	inline bool hasReady() const {
+		return !ready.empty();
+	}
+
+	inline size_t getSuspendedCount() const {
+		return ready.size() + waiting.size();
+	}
+};
+
+} //namespace vm
+
+#endif /* VM_SCHEDULER_H_ */
@@ -1,105 +1,625 @@
 #include "Storage.h"
 
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+
 using namespace vm;
 
-Reference Storage::create(const prog::TypeInfo& typeInfo)
+Reference Storage::create(const prog::TypeInfo& typeInfo, uint32_t typeIdx) {
+	return allocate(typeInfo, typeIdx, typeInfo.nBytes);
+}
+
+Reference Storage::allocate(const prog::TypeInfo& typeInfo, uint32_t typeIdx, size_t nBytes)
 {
 	auto ret = lastRef++;
 
-	auto it = records.emplace(std::make_pair(ret, Record
+	if((ret >> chunkBits) == chunks.size())
+	{
+		chunks.push_back(std::make_unique<Chunk>());
+	}
+
+	auto &chunk = *chunks[ret >> chunkBits];
+	auto &record = chunk.records[ret & (chunkSize - 1)];
+
+	// Marked already if allocated during a background collection.
+	record.reset(new Record
 	{
-		mark,
+		collection ? !mark : mark,
 		typeInfo,
-		std::unique_ptr<Value[]>(new Value[typeInfo.nScalars]),
-		std::unique_ptr<Reference[]>(new Reference[typeInfo.nReferences])
-	}));
+		typeIdx,
+		std::unique_ptr<Value[]>(typeInfo.nScalars ? new Value[typeInfo.nScalars] : nullptr),
+		std::unique_ptr<Reference[]>(typeInfo.nReferences ? new Reference[typeInfo.nReferences] : nullptr),
+		nBytes,
+		std::unique_ptr<uint8_t[]>(nBytes ? new uint8_t[nBytes]() : nullptr)
+	});
 
+	chunk.count++;
+	objectCount++;
 
-	for(auto i = 0u; i < it.first->second.typeInfo.nReferences; i++)
+	for(auto i = 0u; i < record->typeInfo.nReferences; i++)
 	{
-		it.first->second.references[i] = null;
+		record->references[i] = null;
+	}
+
+	if(allocationProfiler)
+	{
+		allocationProfiler->allocated(ret, record->getSize());
 	}
 
 	return ret;
 }
 
+/*
+ * Arrays are objects with a per instance type, holding only scalars or references.
+ */
+Reference Storage::createArray(size_t nReferences, size_t nScalars)
+{
+	assert(!nReferences || !nScalars);
+	return create(prog::TypeInfo(0, nReferences, nScalars));
+}
+
+Reference Storage::createBuffer(size_t size) {
+	return allocate(prog::TypeInfo::empty, 0, size);
+}
+
 const prog::TypeInfo& Storage::getType(Reference ref) const
 {
-	auto it = records.find(ref);
-	assert(it != records.end());
-	return it->second.typeInfo;
+	const auto &record = lookup(ref);
+	return record.typeInfo;
+}
+
+uint32_t Storage::getTypeIndex(Reference ref) const
+{
+	const auto &record = lookup(ref);
+	return record.typeIdx;
+}
+
+size_t Storage::getLength(Reference ref) const
+{
+	const auto &type = getType(ref);
+	return type.nReferences + type.nScalars;
 }
 
 Value Storage::reads(Reference ref, size_t index) const
 {
-	auto it = records.find(ref);
-	assert(it != records.end());
-	assert(index < it->second.typeInfo.nScalars);
-	return it->second.scalars[index];
+	const auto &record = lookup(ref);
+	assert(index < record.typeInfo.nScalars);
+	return record.scalars[index];
 }
 
 Reference Storage::readr(Reference ref, size_t index) const
 {
-	auto it = records.find(ref);
-	assert(it != records.end());
-	assert(index < it->second.typeInfo.nReferences);
-	return it->second.references[index];
+	const auto &record = lookup(ref);
+	assert(index < record.typeInfo.nReferences);
+	return record.references[index];
 }
 
 void Storage::writes(Reference ref, size_t index, Value value) const
 {
-	auto it = records.find(ref);
-	assert(it != records.end());
-	assert(index < it->second.typeInfo.nScalars);
-	it->second.scalars[index] = value;
+	const auto &record = lookup(ref);
+	assert(index < record.typeInfo.nScalars);
+	record.scalars[index] = value;
 }
 
 void Storage::writer(Reference ref, size_t index, Reference value) const
 {
-	auto it = records.find(ref);
-	assert(it != records.end());
-	assert(index < it->second.typeInfo.nReferences);
-	it->second.references[index] = value;
+	const auto &record = lookup(ref);
+	assert(index < record.typeInfo.nReferences);
+	overwriting(record.references[index]);
+	storeReference(&record.references[index], value);
+}
+
+Value* Storage::accessScalars(Reference ref) const
+{
+	const auto &record = lookup(ref);
+	return record.scalars.get();
+}
+
+Reference* Storage::accessReferences(Reference ref) const
+{
+	const auto &record = lookup(ref);
+	return record.references.get();
+}
+
+size_t Storage::getBufferSize(Reference ref) const
+{
+	const auto &record = lookup(ref);
+	return record.nBytes;
 }
 
-void Storage::markWorker(Reference ref, bool mark)
+uint8_t* Storage::accessBytes(Reference ref, size_t offset, size_t length) const
+{
+	const auto &record = lookup(ref);
+	assert(offset <= record.nBytes && length <= record.nBytes - offset);
+	return record.bytes.get() + offset;
+}
+
+void Storage::markWorker(Reference root, bool mark)
+{
+	std::vector<Reference> toDo{root};
+
+	while(!toDo.empty())
+	{
+		const auto ref = toDo.back();
+		toDo.pop_back();
+
+		Storage::Record &record = lookup(ref);
+
+		if(record.mark.load(std::memory_order_relaxed) != mark)
+		{
+			record.mark.store(mark, std::memory_order_relaxed);
+
+			const auto rs = record.references.get();
+			std::copy_if(rs, rs + record.typeInfo.nReferences, std::back_inserter(toDo), [](auto r){ return r != null; });
+		}
+	}
+}
+
+/*
+ * Shared end of the mark stack of a marker, the others steal from it when they run out of work.
+ */
+struct MarkQueue
+{
+	std::mutex lock;
+	std::deque<Reference> refs;
+	std::atomic<size_t> size = 0;
+
+	template<class It>
+	inline void put(It begin, It end)
+	{
+		std::lock_guard _(lock);
+		refs.insert(refs.end(), begin, end);
+		size = refs.size();
+	}
+
+	// The owner takes the newest entries, the thieves half of the oldest ones.
+	inline bool take(std::vector<Reference> &out, bool steal)
+	{
+		if(!size.load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+
+		std::lock_guard _(lock);
+		const auto n = steal ? (refs.size() + 1) / 2 : refs.size();
+
+		if(steal)
+		{
+			out.insert(out.end(), refs.begin(), refs.begin() + n);
+			refs.erase(refs.begin(), refs.begin() + n);
+		}
+		else
+		{
+			out.insert(out.end(), refs.end() - n, refs.end());
+			refs.erase(refs.end() - n, refs.end());
+		}
+
+		size = refs.size();
+		return n != 0;
+	}
+};
+
+/*
+ * Each marker traces from a private stack, and moves half of it to its shared queue whenever that
+ * is found empty. Out of work, a marker takes back its own queue or steals from the others, and
+ * finishes when all of them are idle with every queue empty.
+ */
+void Storage::markParallel(const std::vector<Reference> &roots, bool mark)
 {
-	auto it = records.find(ref);
-	assert(it != records.end());
-	Storage::Record &record = it->second;
+	const auto n = nMarkers;
+	std::unique_ptr<MarkQueue[]> queues(new MarkQueue[n]);
+	std::atomic<size_t> idle = 0;
+
+	for(auto i = 0u; i < roots.size(); i++)
+	{
+		queues[i % n].put(roots.begin() + i, roots.begin() + i + 1);
+	}
+
+	const auto allEmpty = [&]()
+	{
+		return std::all_of(queues.get(), queues.get() + n, [](const auto& q){ return !q.size; });
+	};
 
-	if(record.mark != mark)
+	const auto worker = [&](size_t self)
 	{
-		record.mark = mark;
+		std::vector<Reference> stack;
 
-		for(auto i = 0u; i < record.typeInfo.nReferences; i++)
+		for(;;)
 		{
-			if(const auto r = record.references[i]; r != null)
+			while(!stack.empty())
+			{
+				const auto ref = stack.back();
+				stack.pop_back();
+
+				Storage::Record &record = lookup(ref);
+
+				if(record.mark.load(std::memory_order_relaxed) != mark && record.mark.exchange(mark, std::memory_order_relaxed) != mark)
+				{
+					const auto rs = record.references.get();
+					std::copy_if(rs, rs + record.typeInfo.nReferences, std::back_inserter(stack), [](auto r){ return r != null; });
+				}
+
+				if(stack.size() > 1 && !queues[self].size.load(std::memory_order_relaxed))
+				{
+					const auto half = stack.begin() + stack.size() / 2;
+					queues[self].put(stack.begin(), half);
+					stack.erase(stack.begin(), half);
+				}
+			}
+
+			if(queues[self].take(stack, false))
+			{
+				continue;
+			}
+
+			bool stolen = false;
+			for(auto i = 1u; !stolen && i < n; i++)
+			{
+				stolen = queues[(self + i) % n].take(stack, true);
+			}
+
+			if(stolen)
 			{
-				markWorker(r, mark);
+				continue;
+			}
+
+			// Only markers holding work can put more in the queues, so this state is final.
+			idle++;
+
+			for(;;)
+			{
+				if(!allEmpty())
+				{
+					idle--;
+					break;
+				}
+
+				if(idle == n)
+				{
+					return;
+				}
+
+				std::this_thread::yield();
 			}
 		}
+	};
+
+	if(!markers)
+	{
+		markers = std::make_unique<MarkerPool>();
 	}
+
+	markers->start(n - 1, [&](size_t idx){ worker(idx + 1); });
+	worker(0);
+	markers->wait();
 }
 
-size_t Storage::gc(Reference root)
+/*
+ * Runs the task on the first n helpers, starting the ones missing. The ones started now see the
+ * current generation as already passed, so they take part in the next one like the parked ones.
+ */
+void Storage::MarkerPool::start(size_t n, std::function<void(size_t)> f)
 {
-	markWorker(root, !mark);
+	std::lock_guard<std::mutex> l(lock);
 
-	size_t count = 0;
-	for(auto it = records.begin(); it != records.end();)
+	while(threads.size() < n)
 	{
-		if(it->second.mark == mark)
+		threads.emplace_back(&MarkerPool::loop, this, threads.size(), generation);
+	}
+
+	task = std::move(f);
+	nParticipants = nRunning = n;
+	generation++;
+	wake.notify_all();
+}
+
+void Storage::MarkerPool::wait()
+{
+	std::unique_lock<std::mutex> l(lock);
+	done.wait(l, [this](){ return !nRunning; });
+}
+
+void Storage::MarkerPool::loop(size_t idx, uint64_t seen)
+{
+	std::unique_lock<std::mutex> l(lock);
+
+	for(;;)
+	{
+		wake.wait(l, [&](){ return stopping || generation != seen; });
+
+		if(stopping)
 		{
-			it = records.erase(it);
-			count++;
+			return;
 		}
-		else
+
+		seen = generation;
+
+		// Not needed with fewer markers set since it was started.
+		if(idx < nParticipants)
 		{
-			++it;
+			l.unlock();
+			task(idx);
+			l.lock();
+
+			if(!--nRunning)
+			{
+				done.notify_all();
+			}
 		}
 	}
+}
+
+Storage::MarkerPool::~MarkerPool()
+{
+	{
+		std::lock_guard<std::mutex> l(lock);
+		stopping = true;
+		wake.notify_all();
+	}
+
+	std::for_each(threads.begin(), threads.end(), [](auto& t){ t.join(); });
+}
+
+size_t Storage::gc(Reference root) {
+	return gc(std::vector<Reference>{root});
+}
+
+size_t Storage::gc(const std::vector<Reference> &roots)
+{
+	waitForCollection();
 
+	if(nMarkers > 1)
+	{
+		markParallel(roots, !mark);
+	}
+	else
+	{
+		std::for_each(roots.begin(), roots.end(), [this](auto r){ markWorker(r, !mark); });
+	}
+
+	size_t count = 0;
+	for(auto i = 0u; i < chunks.size(); i++)
+	{
+		if(chunks[i])
+		{
+			count += sweep(*chunks[i], chunkSize, mark);
+
+			// Those below the next allocation are not going to be filled again.
+			if(!chunks[i]->count && i < (lastRef >> chunkBits))
+			{
+				chunks[i].reset();
+			}
+		}
+	}
+
+	objectCount -= count;
 	mark = !mark;
+
+	if(allocationProfiler)
+	{
+		allocationProfiler->collected([this](auto r){ return isAllocated(r); });
+	}
+
+	return count;
+}
+
+/*
+ * Frees the records of the chunk up to the given index with the given value of the mark bit,
+ * returns their number.
+ */
+size_t Storage::sweep(Chunk &chunk, uint32_t end, bool unmarked)
+{
+	size_t count = 0;
+
+	for(auto r = chunk.records; r != chunk.records + end; r++)
+	{
+		if(*r && (*r)->mark.load(std::memory_order_relaxed) == unmarked)
+		{
+			r->reset();
+			count++;
+		}
+	}
+
+	chunk.count -= count;
 	return count;
 }
+
+void Storage::startCollection(const std::vector<Reference> &roots)
+{
+	waitForCollection();
+
+	collection = std::make_unique<Collection>();
+	auto &c = *collection;
+
+	std::transform(chunks.begin(), chunks.end(), std::back_inserter(c.chunks), [](const auto &p){ return p.get(); });
+	c.limit = lastRef;
+	c.mark = !mark;
+
+	barrier = true;
+	c.thread = std::thread([this, &c, roots](){ collect(c, roots); });
+}
+
+/*
+ * The remark pause, the roots and the last of the overwritten references are handed over to
+ * the marker, which is waited for.
+ */
+void Storage::finishCollection(const std::vector<Reference> &roots)
+{
+	assert(collection && barrier);
+	auto &c = *collection;
+
+	std::unique_lock l(c.lock);
+	c.toMark.insert(c.toMark.end(), overwritten.begin(), overwritten.end());
+	c.toMark.insert(c.toMark.end(), roots.begin(), roots.end());
+	c.finishing = true;
+	c.wake.notify_all();
+	c.wake.wait(l, [&](){ return c.marked; });
+
+	overwritten.clear();
+	barrier = false;
+}
+
+size_t Storage::waitForCollection()
+{
+	if(!collection)
+	{
+		return 0;
+	}
+
+	if(barrier)
+	{
+		finishCollection({});
+	}
+
+	collection->thread.join();
+
+	for(const auto i: collection->emptied)
+	{
+		chunks[i].reset();
+	}
+
+	const auto ret = collection->count;
+	collection.reset();
+	mark = !mark;
+
+	if(allocationProfiler)
+	{
+		allocationProfiler->collected([this](auto r){ return isAllocated(r); });
+	}
+
+	return ret;
+}
+
+/*
+ * Slow path of the barrier, the overwritten reference is kept for the marker unless it is
+ * marked already or was allocated after the start.
+ */
+void Storage::record(Reference old) const
+{
+	auto &c = *collection;
+
+	if(old < c.limit && lookup(old).mark.load(std::memory_order_relaxed) != c.mark)
+	{
+		overwritten.push_back(old);
+
+		if(overwritten.size() >= 256)
+		{
+			{
+				std::lock_guard _(c.lock);
+				c.toMark.insert(c.toMark.end(), overwritten.begin(), overwritten.end());
+			}
+
+			overwritten.clear();
+			c.wake.notify_all();
+		}
+	}
+}
+
+/*
+ * Body of the background thread, marks from the roots and the references handed over, until
+ * finished with none left. Then sweeps the objects that existed at the start.
+ *
+ * The fields of the objects may be written by the mutator while they are read here (atomically,
+ * see loadReference), either value is fine: the previous one is recorded by the barrier, the new
+ * one is a new object or one reachable at the start.
+ */
+void Storage::collect(Collection &c, std::vector<Reference> toDo)
+{
+	for(;;)
+	{
+		while(!toDo.empty())
+		{
+			const auto ref = toDo.back();
+			toDo.pop_back();
+
+			if(ref == null || ref >= c.limit)
+			{
+				continue;
+			}
+
+			Storage::Record &record = *c.chunks[ref >> chunkBits]->records[ref & (chunkSize - 1)];
+
+			if(record.mark.load(std::memory_order_relaxed) != c.mark)
+			{
+				record.mark.store(c.mark, std::memory_order_relaxed);
+
+				const auto rs = record.references.get();
+				std::for_each(rs, rs + record.typeInfo.nReferences, [&](const auto& slot)
+				{
+					if(const auto r = loadReference(&slot); r != null)
+					{
+						toDo.push_back(r);
+					}
+				});
+			}
+		}
+
+		std::unique_lock l(c.lock);
+		c.wake.wait(l, [&](){ return !c.toMark.empty() || c.finishing; });
+
+		if(c.toMark.empty())
+		{
+			c.marked = true;
+			c.wake.notify_all();
+			break;
+		}
+
+		toDo.swap(c.toMark);
+	}
+
+	for(auto i = 0u; i < c.chunks.size(); i++)
+	{
+		if(c.chunks[i])
+		{
+			// The last one is shared with the mutator, which allocates after the limit.
+			const auto full = uint64_t(i + 1) << chunkBits <= c.limit;
+			c.count += sweep(*c.chunks[i], full ? chunkSize : c.limit & (chunkSize - 1), !c.mark);
+
+			if(full && !c.chunks[i]->count)
+			{
+				c.emptied.push_back(i);
+			}
+		}
+	}
+
+	objectCount -= c.count;
+}
+
+HeapSnapshot Storage::snapshot(const std::vector<Reference> &roots) const
+{
+	HeapSnapshot ret;
+	std::unordered_map<Reference, uint32_t> indices;
+
+	const auto add = [&](Reference ref)
+	{
+		const auto it = indices.emplace(ref, (uint32_t)ret.objects.size());
+
+		if(it.second)
+		{
+			const auto &record = lookup(ref);
+			ret.objects.push_back({ref, record.typeIdx, (uint32_t)record.getSize()});
+		}
+
+		return it.first->second;
+	};
+
+	std::for_each(roots.begin(), roots.end(), [&](auto r){ if(r != null) add(r); });
+	ret.nRoots = ret.objects.size();
+
+	for(auto i = 0u; i < ret.objects.size(); i++)
+	{
+		const auto &record = lookup(ret.objects[i].ref);
+		const auto rs = record.references.get();
+		std::vector<uint32_t> edges;
+
+		std::for_each(rs, rs + record.typeInfo.nReferences, [&](auto r){ if(r != null) edges.push_back(add(r)); });
+		ret.objects[i].edges = std::move(edges);
+	}
+
+	return ret;
+}
@@ -3,6 +3,8 @@
 
 #include "Value.h"
 #include "Reference.h"
+#include "HeapSnapshot.h"
+#include "AllocationProfiler.h"
 
 #include "program/TypeInfo.h"
 
@@ -11,36 +13,208 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <memory>
-#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
 
 namespace vm {
 
 struct Storage
 {
-	Reference create(const prog::TypeInfo &typeInfo);
+	Reference create(const prog::TypeInfo &typeInfo, uint32_t typeIdx = 0);
+	Reference createArray(size_t nReferences, size_t nScalars);
+	Reference createBuffer(size_t size);
 	size_t gc(Reference root);
+	size_t gc(const std::vector<Reference> &roots);
+
+	/*
+	 * Collection on a background thread, the objects can be used and allocated meanwhile. It is
+	 * started with the roots gc would be called with, and finished with the ones at that point,
+	 * which only waits for the marking to complete (the remark pause). The sweep goes on until
+	 * waited for (by the next collection, or explicitly to get the number of objects freed).
+	 *
+	 * The references overwritten while marking are recorded (snapshot-at-the-beginning), so
+	 * every object reachable at the start is kept, and the new objects are allocated marked.
+	 * Writes through the raw accessors must call overwriting with the previous value.
+	 */
+	void startCollection(const std::vector<Reference> &roots);
+	void finishCollection(const std::vector<Reference> &roots);
+	size_t waitForCollection();
+
+	inline void overwriting(Reference old) const
+	{
+		if(barrier && old != null)
+		{
+			record(old);
+		}
+	}
+
+	inline void overwriting(const Reference* begin, const Reference* end) const
+	{
+		if(barrier)
+		{
+			std::for_each(begin, end, [this](auto r){ if(r != null) record(r); });
+		}
+	}
+
+	inline ~Storage() {
+		waitForCollection();
+	}
+
+	// Copies the graph of the objects reachable from the roots, to be analyzed separately.
+	HeapSnapshot snapshot(const std::vector<Reference> &roots) const;
 
 	const prog::TypeInfo& getType(Reference ref) const;
+	uint32_t getTypeIndex(Reference ref) const;
+	size_t getLength(Reference ref) const;
 
 	Value reads(Reference ref, size_t index) const;
 	Reference readr(Reference ref, size_t index) const;
 	void writes(Reference ref, size_t index, Value value) const;
 	void writer(Reference ref, size_t index, Reference value) const;
 
+	// Raw access to the fields of an object, valid until the next gc. The references are written with storeReference.
+	Value* accessScalars(Reference ref) const;
+	Reference* accessReferences(Reference ref) const;
+
+	// Buffer contents or the packed fields of an object.
+	size_t getBufferSize(Reference ref) const;
+	uint8_t* accessBytes(Reference ref, size_t offset, size_t length) const;
+
+	inline size_t getObjectCount() const {
+		return objectCount;
+	}
+
+	inline size_t getAllocationCount() const {
+		return lastRef - 1;
+	}
+
+	// Records the allocations and follows them through the collections, if set.
+	inline void setAllocationProfiler(AllocationProfiler* p) {
+		allocationProfiler = p;
+	}
+
+	inline AllocationProfiler* getAllocationProfiler() const {
+		return allocationProfiler;
+	}
+
+	// The objects are marked by up to this many threads during the collections.
+	inline void setMarkerCount(size_t n) {
+		nMarkers = std::max<size_t>(n, 1);
+	}
+
 private:
-	void markWorker(Reference ref, bool mark);
+	Reference allocate(const prog::TypeInfo &typeInfo, uint32_t typeIdx, size_t nBytes);
+	void markWorker(Reference root, bool mark);
+	void markParallel(const std::vector<Reference> &roots, bool mark);
+	void record(Reference old) const;
+
+	/*
+	 * Set by several markers concurrently, only copied when the record is created.
+	 */
+	struct MarkBit: std::atomic<bool>
+	{
+		inline MarkBit(bool v): std::atomic<bool>(v) {}
+		inline MarkBit(const MarkBit& o): std::atomic<bool>(o.load(std::memory_order_relaxed)) {}
+	};
 
 	struct Record
 	{
-		bool mark;
+		MarkBit mark;
 		const prog::TypeInfo typeInfo;
+		const uint32_t typeIdx; // Index in the program, zero for frames, arrays and buffers.
 		std::unique_ptr<Value[]> scalars;
 		std::unique_ptr<Reference[]> references;
+		size_t nBytes = 0;
+		std::unique_ptr<uint8_t[]> bytes;
+
+		inline size_t getSize() const {
+			return typeInfo.nScalars * sizeof(Value) + typeInfo.nReferences * sizeof(Reference) + nBytes;
+		}
 	};
 
+	static constexpr uint32_t chunkBits = 12;
+	static constexpr uint32_t chunkSize = 1 << chunkBits;
+
+	/*
+	 * The records are kept by reference in chunks that do not move when more are added, so the
+	 * background collection can look them up while objects are allocated.
+	 */
+	struct Chunk
+	{
+		std::unique_ptr<Record> records[chunkSize];
+		std::atomic<uint32_t> count = 0;
+	};
+
+	/*
+	 * State shared with the thread of a background collection.
+	 */
+	struct Collection
+	{
+		std::vector<Chunk*> chunks;                         // As they were at the start
+		Reference limit;                                    // The objects allocated since then are kept
+		bool mark;                                          // Value of the mark bit of the reachable objects
+
+		std::mutex lock;
+		std::condition_variable wake;
+		std::vector<Reference> toMark;                      // Overwritten references and the roots at the remark
+		bool finishing = false, marked = false;
+
+		std::vector<uint32_t> emptied;                      // Chunks to be freed by the mutator
+		size_t count = 0;
+		std::thread thread;
+	};
+
+	inline Record& lookup(Reference ref) const
+	{
+		assert(ref != null && (ref >> chunkBits) < chunks.size() && chunks[ref >> chunkBits]);
+		const auto &r = chunks[ref >> chunkBits]->records[ref & (chunkSize - 1)];
+		assert(r);
+		return *r;
+	}
+
+	inline bool isAllocated(Reference ref) const {
+		return (ref >> chunkBits) < chunks.size() && chunks[ref >> chunkBits] && chunks[ref >> chunkBits]->records[ref & (chunkSize - 1)];
+	}
+
+	/*
+	 * Helper threads of the parallel marking, kept across the collections and parked on the
+	 * condition variable between them. Started as needed, stopped with the storage.
+	 */
+	struct MarkerPool
+	{
+		std::mutex lock;
+		std::condition_variable wake, done;
+		std::function<void(size_t)> task;                  // Run by the helpers with their index
+		size_t nParticipants = 0, nRunning = 0;
+		uint64_t generation = 0;
+		bool stopping = false;
+		std::vector<std::thread> threads;
+
+		void start(size_t n, std::function<void(size_t)> f);
+		void wait();
+		void loop(size_t idx, uint64_t seen);
+		~MarkerPool();
+	};
+
+	void collect(Collection &c, std::vector<Reference> roots);
+	static size_t sweep(Chunk &chunk, uint32_t end, bool unmarked);
+
 	uint32_t lastRef = 1;
 	bool mark = false;
-	std::map<Reference, Record> records;
+	std::vector<std::unique_ptr<Chunk>> chunks;
+	std::atomic<size_t> objectCount = 0;
+	AllocationProfiler* allocationProfiler = nullptr;
+	size_t nMarkers = 1;
+	std::unique_ptr<MarkerPool> markers;
+
+	std::unique_ptr<Collection> collection;
+	bool barrier = false;
+	mutable std::vector<Reference> overwritten;             // Flushed to the collection in batches
 };
 
 } //namespace vm
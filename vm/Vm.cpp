@@ -1,59 +1,85 @@
 #include "Vm.h"
 
 #include "Value.h"
+#include "Frame.h"
+#include "ClosureTier.h"
 
 #include <algorithm>
+#include <cstring>
 
 using namespace vm;
 
-struct Frame
-{
-	struct Scalar
-	{
-		static constexpr auto scalarTosIndexOffset = 0;
-		static constexpr auto referenceTosIndexOffset = 1;
-		static constexpr auto stackOffset = 2;
-		static constexpr auto extra = 2;
-	};
+#ifdef VM_PROFILE
+#define PROFILE(x) if(profiler) profiler->x
+#else
+#define PROFILE(x)
+#endif
 
+/*
+ * Handle of a coroutine, it refers to the top frame while it is not finished, after
+ * that it holds the returned values instead.
+ */
+struct Coroutine
+{
 	struct Reference
 	{
-		static constexpr auto callerFrameReferenceOffset = 0;
-		static constexpr auto stackOffset = 1;
+		static constexpr auto frameOffset = 0;
+		static constexpr auto awaitedOffset = 1;
+		static constexpr auto resultReferencesOffset = 2;
+		static constexpr auto resultScalarsOffset = 3;
+		static constexpr auto exceptionOffset = 4;
+		static constexpr auto count = 5;
 	};
+
+	static inline const prog::TypeInfo type = prog::TypeInfo(0, Reference::count, 0);
 };
 
-inline Vm::ExecutionState Vm::enter(uint32_t fnIdx, Reference caller)
+inline Vm::ExecutionState Vm::enter(const Callee& callee, Reference caller)
 {
-	assert(fnIdx < program.functions.size());
-	const auto &fun = program.functions[fnIdx];
-
 	Vm::ExecutionState ret;
 
-	ret.frame = storage.create(prog::TypeInfo(
-		/* base idx */   0,
-		/* references */ Frame::Reference::stackOffset + fun.nRefs,
-		/* scalars */    Frame::Scalar::stackOffset + fun.nScalars + Frame::Scalar::extra
-	)),
+	if(const auto p = storage.getAllocationProfiler())
+	{
+		p->at(callee.index, AllocationProfiler::frame);
+	}
 
-	ret.functionIndex = fnIdx,
-	ret.isnIt = fun.code.cbegin(),
-	ret.end = fun.code.cend(),
+	ret.frame = storage.create(callee.frameType),
+	ret.functionIndex = callee.index,
+	ret.isnIt = callee.begin,
+	ret.end = callee.end,
 
-	storage.writer(ret.frame, Frame::Reference::callerFrameReferenceOffset, caller);
+	storeReference(storage.accessReferences(ret.frame) + Frame::Reference::callerFrameReferenceOffset, caller);
 
 	return ret;
 }
 
+/*
+ * Attributes the next allocation to the instruction being executed.
+ */
+inline void Vm::allocating(const ExecutionState& es)
+{
+	if(const auto p = storage.getAllocationProfiler())
+	{
+		p->at(es.functionIndex, (uint32_t)(es.isnIt - program.functions[es.functionIndex].code.cbegin() - 1));
+	}
+}
+
+inline Vm::ExecutionState Vm::enter(uint32_t fnIdx, Reference caller)
+{
+	assert(fnIdx < decoded.callees.size());
+	return enter(decoded.callees[fnIdx], caller);
+}
+
 inline Reference Vm::suspend(ExecutionState& es)
 {
 	const auto offset = es.isnIt - program.functions[es.functionIndex].code.cbegin();
 
 	assert(es.scalarStackPointer < program.functions[es.functionIndex].nScalars);
-	storage.writes(es.frame, Frame::Scalar::stackOffset + es.scalarStackPointer + 0, (int)offset);
-	storage.writes(es.frame, Frame::Scalar::stackOffset + es.scalarStackPointer + 1, (int)es.functionIndex);
-	storage.writes(es.frame, Frame::Scalar::scalarTosIndexOffset, (int)es.scalarStackPointer);
-	storage.writes(es.frame, Frame::Scalar::referenceTosIndexOffset, (int)es.referenceStackPointer);
+	const auto ss = storage.accessScalars(es.frame);
+	ss[Frame::Scalar::stackOffset + es.scalarStackPointer + 0] = (int)offset;
+	ss[Frame::Scalar::stackOffset + es.scalarStackPointer + 1] = (int)es.functionIndex;
+	ss[Frame::Scalar::scalarTosIndexOffset] = (int)es.scalarStackPointer;
+	ss[Frame::Scalar::referenceTosIndexOffset] = (int)es.referenceStackPointer;
 
 	return es.frame;
 }
@@ -62,15 +88,16 @@ inline Vm::ExecutionState Vm::resume(Reference frame)
 {
 	Vm::ExecutionState ret;
 
+	const auto ss = storage.accessScalars(frame);
 	ret.frame = frame;
-	ret.scalarStackPointer = (uint32_t)storage.reads(frame, Frame::Scalar::scalarTosIndexOffset).integer;
-	ret.referenceStackPointer = (uint32_t)storage.reads(frame, Frame::Scalar::referenceTosIndexOffset).integer;
-	const auto offset = storage.reads(ret.frame, Frame::Scalar::stackOffset + ret.scalarStackPointer + 0).integer;
-	ret.functionIndex = storage.reads(ret.frame, Frame::Scalar::stackOffset + ret.scalarStackPointer + 1).integer;
+	ret.scalarStackPointer = (uint32_t)ss[Frame::Scalar::scalarTosIndexOffset].integer;
+	ret.referenceStackPointer = (uint32_t)ss[Frame::Scalar::referenceTosIndexOffset].integer;
+	const auto offset = ss[Frame::Scalar::stackOffset + ret.scalarStackPointer + 0].integer;
+	ret.functionIndex = ss[Frame::Scalar::stackOffset + ret.scalarStackPointer + 1].integer;
 
-	const auto& fun = program.functions[ret.functionIndex];
-	ret.isnIt = fun.code.cbegin() + offset;
-	ret.end = fun.code.cend();
+	const auto& callee = decoded.callees[ret.functionIndex];
+	ret.isnIt = callee.begin + offset;
+	ret.end = callee.end;
 
 	return ret;
 }
@@ -201,6 +228,7 @@ inline bool Vm::fetch(ExecutionState& es, prog::Instruction& isn)
 {
 	if(es.isnIt != es.end)
 	{
+		statistics.instructions++;
 		isn = *es.isnIt++;
 		return true;
 	}
@@ -217,12 +245,195 @@ inline void Vm::jump(ExecutionState& es, uint32_t offset)
 	es.isnIt = fun.code.begin() + offset;
 }
 
-Vm::Vm(Storage& storage, const prog::Program &p): storage(storage), program(p)
+Vm::Decoded::Decoded(const prog::Program &p): program(p)
 {
 	assert(!p.types.empty());
+
+	for(auto i = 0u; i < p.functions.size(); i++)
+	{
+		const auto &fun = p.functions[i];
+
+		callees.push_back(Callee{
+			prog::TypeInfo(
+				/* base idx */   0,
+				/* references */ Frame::Reference::stackOffset + fun.nRefs,
+				/* scalars */    Frame::Scalar::stackOffset + fun.nScalars + Frame::Scalar::extra
+			),
+			i, (uint32_t)fun.nRefs, (uint32_t)fun.nScalars, fun.code.cbegin(), fun.code.cend()
+		});
+	}
+
+	// Constant call targets are checked once here instead of at every call.
+	for(const auto &fun: p.functions)
+	{
+		for(const auto &isn: fun.code)
+		{
+			assert(isn.op != prog::Instruction::Operation::callL || isn.imm < p.functions.size());
+			assert(isn.op != prog::Instruction::Operation::iof || isn.imm < p.types.size());
+		}
+	}
+
+	decodeTypes();
+}
+
+/*
+ * Binds the method tables to the callees and numbers the types in preorder of the inheritance
+ * tree, where types with the (otherwise non-inheritable) global type as base are the roots.
+ */
+void Vm::Decoded::decodeTypes()
+{
+	assert(program.methods.size() <= program.types.size());
+	methods.resize(program.types.size());
+
+	for(auto i = 0u; i < program.methods.size(); i++)
+	{
+		for(const auto fnIdx: program.methods[i])
+		{
+			assert(fnIdx < callees.size());
+			methods[i].push_back(&callees[fnIdx]);
+		}
+	}
+
+	std::vector<std::vector<uint32_t>> derived(program.types.size());
+
+	for(auto i = 1u; i < program.types.size(); i++)
+	{
+		assert(program.types[i].baseIdx < program.types.size());
+		derived[program.types[i].baseIdx].push_back(i);
+	}
+
+	typeRanges.assign(program.types.size(), TypeRange{0, 0});
+	uint32_t position = 1;
+
+	const auto number = [&](uint32_t typeIdx, const auto& self) -> void
+	{
+		typeRanges[typeIdx].begin = position++;
+
+		for(const auto d: derived[typeIdx])
+		{
+			self(d, self);
+		}
+
+		typeRanges[typeIdx].end = position;
+	};
+
+	for(const auto root: derived[0])
+	{
+		number(root, number);
+	}
+
+	assert(position == program.types.size()); // No cycles
+}
+
+Vm::Vm(Storage& storage, const prog::Program &p):
+	storage(storage), program(p), ownDecoded(std::make_unique<const Decoded>(p)), decoded(*ownDecoded)
+{
 	staticObject = storage.create(p.types[0]);
 }
 
+Vm::Vm(Storage& storage, const Decoded &d): storage(storage), program(d.program), decoded(d)
+{
+	staticObject = storage.create(program.types[0]);
+}
+
+Vm::~Vm() = default;
+
+void Vm::enableClosureTier(uint32_t callThreshold, uint32_t backEdgeThreshold) {
+	tier = std::make_unique<ClosureTier>(*this, callThreshold, backEdgeThreshold);
+}
+
+uint32_t Vm::addNative(const NativeFunction& fn)
+{
+	natives.push_back(fn);
+	return (uint32_t)(natives.size() - 1);
+}
+
+inline void Vm::callNative(ExecutionState& es, uint32_t nativeIdx)
+{
+	assert(nativeIdx < natives.size());
+	const auto &n = natives[nativeIdx];
+	statistics.calls++;
+	const auto &fun = program.functions[es.functionIndex];
+
+	assert(n.nArgReferences <= es.referenceStackPointer);
+	assert(n.nArgScalars <= es.scalarStackPointer);
+	const auto rBase = es.referenceStackPointer - n.nArgReferences;
+	const auto sBase = es.scalarStackPointer - n.nArgScalars;
+
+	assert(rBase + n.nRetReferences <= fun.nRefs);
+	assert(sBase + n.nRetScalars <= fun.nScalars);
+	const auto rs = storage.accessReferences(es.frame) + Frame::Reference::stackOffset;
+	const auto ss = storage.accessScalars(es.frame) + Frame::Scalar::stackOffset;
+
+	// The natives may overwrite any of the arguments with the results.
+	storage.overwriting(rs + rBase, rs + es.referenceStackPointer);
+
+	NativeFrame frame{storage, rs + rBase, ss + sBase};
+	n.fn(frame);
+
+	fillReferences(rs + rBase + n.nRetReferences, rs + es.referenceStackPointer, null);
+
+	es.referenceStackPointer = rBase + n.nRetReferences;
+	es.scalarStackPointer = sBase + n.nRetScalars;
+}
+
+inline bool Vm::isInstance(Reference ref, uint32_t typeIdx)
+{
+	if(ref == null)
+	{
+		return false;
+	}
+
+	const auto &actual = decoded.typeRanges[storage.getTypeIndex(ref)];
+	const auto &expected = decoded.typeRanges[typeIdx];
+	return expected.begin <= actual.begin && actual.begin < expected.end;
+}
+
+/*
+ * Unwinds the frames until a handler covering the current instruction (or the call the frame
+ * is suspended at) is found, nothing is spent on handlers until an exception is raised.
+ */
+inline Vm::Exit Vm::raise(ExecutionState& es, Reference exception)
+{
+	assert(exception != null);
+
+	for(bool unwound = false;; unwound = true)
+	{
+		const auto &fun = program.functions[es.functionIndex];
+		const auto offset = (uint32_t)(es.isnIt - fun.code.cbegin() - 1);
+
+		for(const auto &h: fun.handlers)
+		{
+			if(h.begin <= offset && offset < h.end)
+			{
+				assert(h.nRefs <= es.referenceStackPointer && h.nScalars <= es.scalarStackPointer);
+
+				const auto rs = storage.accessReferences(es.frame) + Frame::Reference::stackOffset;
+				storage.overwriting(rs + h.nRefs, rs + es.referenceStackPointer);
+				fillReferences(rs + h.nRefs, rs + es.referenceStackPointer, null);
+
+				es.referenceStackPointer = h.nRefs;
+				es.scalarStackPointer = h.nScalars;
+				writer(es, {}, exception);
+				jump(es, h.target);
+				return (unwound && tier) ? Exit::Transfer : Exit::Continue;
+			}
+		}
+
+		const auto caller = getCallerFrame(es);
+
+		if(caller == staticObject)
+		{
+			uncaught = exception;
+			PROFILE(leave());
+			return Exit::Raised;
+		}
+
+		es = resume(caller);
+		PROFILE(ret());
+	}
+}
+
 template<class C> inline void Vm::unary(ExecutionState& es, const prog::Instruction& isn, C&& c) {
 	this->writes(es, isn.x, c(this->reads(es, isn.y)));
 }
@@ -245,201 +456,681 @@ template<class C> inline void Vm::binary(ExecutionState& es, const prog::Instruc
 	this->writes(es, isn.x, c(a, b));
 }
 
-std::pair<std::vector<Reference>, std::vector<Value>> Vm::run(std::vector<Reference> rargs, std::vector<Value> sargs)
+template<class T> inline void Vm::load(ExecutionState& es, const prog::Instruction& isn)
 {
-	assert(!program.functions.empty());
+	const auto buffer = this->readr(es, isn.y);
+	const auto offset = (uint32_t)this->reads(es, isn.z).integer;
 
-	auto es = enter(0, staticObject);
-	puts(es, sargs);
-	putr(es, rargs);
+	T v;
+	memcpy(&v, storage.accessBytes(buffer, offset, sizeof(T)), sizeof(T));
+	this->writes(es, isn.x, (int)v);
+}
 
-	while(true)
+template<class T> inline void Vm::store(ExecutionState& es, const prog::Instruction& isn)
+{
+	const auto buffer = this->readr(es, isn.y);
+	const T v = (T)this->reads(es, isn.x).integer;
+	const auto offset = (uint32_t)this->reads(es, isn.z).integer;
+
+	memcpy(storage.accessBytes(buffer, offset, sizeof(T)), &v, sizeof(T));
+}
+
+/*
+ * Packed fields are naturally aligned at the offsets given by the compiler, which is only
+ * checked here, the value is extended to a full one on the way in.
+ */
+template<class T> inline void Vm::getPacked(ExecutionState& es, const prog::Instruction& isn)
+{
+	assert(isn.imm % sizeof(T) == 0);
+
+	T v;
+	memcpy(&v, storage.accessBytes(this->readr(es, isn.y), isn.imm, sizeof(T)), sizeof(T));
+	this->writes(es, isn.x, (int)v);
+}
+
+template<class T> inline void Vm::putPacked(ExecutionState& es, const prog::Instruction& isn)
+{
+	assert(isn.imm % sizeof(T) == 0);
+
+	const auto object = this->readr(es, isn.y);
+	const T v = (T)this->reads(es, isn.x).integer;
+	memcpy(storage.accessBytes(object, isn.imm, sizeof(T)), &v, sizeof(T));
+}
+
+/*
+ * The arguments are moved from the top of the operand stacks of the caller directly to
+ * the bottom of the ones of the callee, keeping their order.
+ */
+inline Vm::Exit Vm::call(ExecutionState& es, const Callee& callee, uint32_t nReferences, uint32_t nScalars)
+{
+	assert(nReferences <= es.referenceStackPointer && nReferences <= callee.nRefs);
+	assert(nScalars <= es.scalarStackPointer && nScalars <= callee.nScalars);
+
+	es.referenceStackPointer -= nReferences;
+	es.scalarStackPointer -= nScalars;
+
+	auto next = enter(callee, es.frame);
+	const auto rs = storage.accessReferences(es.frame) + Frame::Reference::stackOffset + es.referenceStackPointer;
+	const auto ss = storage.accessScalars(es.frame) + Frame::Scalar::stackOffset + es.scalarStackPointer;
+	copyReferences(rs, rs + nReferences, storage.accessReferences(next.frame) + Frame::Reference::stackOffset);
+	std::copy(ss, ss + nScalars, storage.accessScalars(next.frame) + Frame::Scalar::stackOffset);
+	storage.overwriting(rs, rs + nReferences);
+	fillReferences(rs, rs + nReferences, null);
+
+	next.referenceStackPointer = nReferences;
+	next.scalarStackPointer = nScalars;
+	suspend(es);
+	es = next;
+
+	statistics.calls++;
+	PROFILE(call(callee.index));
+
+	if(tier)
+	{
+		tier->countCall(callee.index);
+		return Exit::Transfer;
+	}
+
+	return Exit::Continue;
+}
+
+/*
+ * The results are moved from the top of the operand stacks of the callee directly to the
+ * ones of the caller, the frame of the callee is left for the gc.
+ */
+inline void Vm::ret(ExecutionState& es, Reference callerFrame, uint32_t nReferences, uint32_t nScalars)
+{
+	assert(nReferences <= es.referenceStackPointer && nScalars <= es.scalarStackPointer);
+	const auto rs = storage.accessReferences(es.frame) + Frame::Reference::stackOffset + es.referenceStackPointer - nReferences;
+	const auto ss = storage.accessScalars(es.frame) + Frame::Scalar::stackOffset + es.scalarStackPointer - nScalars;
+
+	es = resume(callerFrame);
+	assert(es.referenceStackPointer + nReferences <= program.functions[es.functionIndex].nRefs);
+	assert(es.scalarStackPointer + nScalars <= program.functions[es.functionIndex].nScalars);
+	copyReferences(rs, rs + nReferences, storage.accessReferences(es.frame) + Frame::Reference::stackOffset + es.referenceStackPointer);
+	std::copy(ss, ss + nScalars, storage.accessScalars(es.frame) + Frame::Scalar::stackOffset + es.scalarStackPointer);
+	es.referenceStackPointer += nReferences;
+	es.scalarStackPointer += nScalars;
+}
+
+Vm::Exit Vm::invoke(ExecutionState& es, const Callee& callee, uint32_t nReferences, uint32_t nScalars) {
+	return call(es, callee, nReferences, nScalars);
+}
+
+#ifdef VM_PROFILE
+std::vector<uint32_t> Vm::getCallStack(const ExecutionState& es)
+{
+	std::vector<uint32_t> ret{es.functionIndex};
+
+	for(auto frame = storage.readr(es.frame, Frame::Reference::callerFrameReferenceOffset); frame != staticObject;)
 	{
-		prog::Instruction isn;
-		auto fetchOk = fetch(es, isn);
-		assert(fetchOk);
+		const auto sp = storage.reads(frame, Frame::Scalar::scalarTosIndexOffset).integer;
+		ret.push_back(storage.reads(frame, Frame::Scalar::stackOffset + sp + 1).integer);
+		frame = storage.readr(frame, Frame::Reference::callerFrameReferenceOffset);
+	}
+
+	std::reverse(ret.begin(), ret.end());
+	return ret;
+}
+#endif
 
-		switch(isn.op)
+inline Vm::Exit Vm::step(ExecutionState& es, const prog::Instruction& isn, Results& results, Reference& awaited)
+{
+	switch(isn.op)
+	{
+	case prog::Instruction::Operation::lit:
+		this->writes(es, isn.x, (int)isn.imm);
+		break;
+	case prog::Instruction::Operation::make:
+		assert(isn.imm < program.types.size());
+		allocating(es);
+		this->writer(es, isn.x, isn.imm ? storage.create(program.types[isn.imm], isn.imm) : null);
+		break;
+	case prog::Instruction::Operation::jNul:
+		if(readr(es, isn.x) == null)
+		{
+			jump(es, isn.imm);
+		}
+		break;
+	case prog::Instruction::Operation::jNnl:
+		if(readr(es, isn.x) != null)
+		{
+			jump(es, isn.imm);
+		}
+		break;
+	case prog::Instruction::Operation::movr:
+		this->writer(es, isn.x, this->readr(es, isn.y));
+		break;
+	case prog::Instruction::Operation::mov:
+		unary(es, isn, [](const auto& v){ return v; });
+		break;
+	case prog::Instruction::Operation::neg:
+		unary(es, isn, [](const auto& v){ return ~v.integer; });
+		break;
+	case prog::Instruction::Operation::i2f:
+		unary(es, isn, [](const auto& v){ return (float)(v.integer); });
+		break;
+	case prog::Instruction::Operation::f2i:
+		unary(es, isn, [](const auto& v){ return (int)(v.floating); });
+		break;
+	case prog::Instruction::Operation::x1i:
+		unary(es, isn, [](const auto& v){ return (int)(int32_t)((int8_t)v.integer); });
+		break;
+	case prog::Instruction::Operation::x1u:
+		unary(es, isn, [](const auto& v){ return (int)(uint32_t)((uint8_t)v.integer); });
+		break;
+	case prog::Instruction::Operation::x2i:
+		unary(es, isn, [](const auto& v){ return (int)(int32_t)((int16_t)v.integer); });
+		break;
+	case prog::Instruction::Operation::x2u:
+		unary(es, isn, [](const auto& v){ return (int)(uint32_t)((uint16_t)v.integer); });
+		break;
+	case prog::Instruction::Operation::news:
+		{
+			allocating(es);
+			const auto length = this->reads(es, isn.y).integer;
+			assert(length >= 0);
+			this->writer(es, isn.x, storage.createArray(0, (uint32_t)length));
+		}
+		break;
+	case prog::Instruction::Operation::newr:
+		{
+			allocating(es);
+			const auto length = this->reads(es, isn.y).integer;
+			assert(length >= 0);
+			this->writer(es, isn.x, storage.createArray((uint32_t)length, 0));
+		}
+		break;
+	case prog::Instruction::Operation::alen:
+		this->writes(es, isn.x, (int)storage.getLength(this->readr(es, isn.y)));
+		break;
+	case prog::Instruction::Operation::getr:
+		this->writer(es, isn.x, storage.readr(this->readr(es, isn.y), isn.imm));
+		break;
+	case prog::Instruction::Operation::putr:
+		storage.writer(this->readr(es, isn.y), isn.imm, this->readr(es, isn.x));
+		break;
+	case prog::Instruction::Operation::gets:
+		this->writes(es, isn.x, storage.reads(this->readr(es, isn.y), isn.imm));
+		break;
+	case prog::Instruction::Operation::puts:
+		storage.writes(this->readr(es, isn.y), isn.imm, this->reads(es, isn.x));
+		break;
+	case prog::Instruction::Operation::gets1i:
+		getPacked<int8_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::gets1u:
+		getPacked<uint8_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::gets2i:
+		getPacked<int16_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::gets2u:
+		getPacked<uint16_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::gets4:
+		getPacked<int32_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::puts1:
+		putPacked<uint8_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::puts2:
+		putPacked<uint16_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::puts4:
+		putPacked<uint32_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::jEq:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.integer == b.integer; });
+		break;
+	case prog::Instruction::Operation::jNe:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.integer != b.integer; });
+		break;
+	case prog::Instruction::Operation::jLtI:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.integer < b.integer; });
+		break;
+	case prog::Instruction::Operation::jGtI:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.integer > b.integer; });
+		break;
+	case prog::Instruction::Operation::jLeI:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.integer <= b.integer; });
+		break;
+	case prog::Instruction::Operation::jGeI:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.integer >= b.integer; });
+		break;
+	case prog::Instruction::Operation::jLtU:
+		conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer < (uint32_t)b.integer; });break;
+		break;
+	case prog::Instruction::Operation::jGtU:
+		conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer > (uint32_t)b.integer; });break;
+		break;
+	case prog::Instruction::Operation::jLeU:
+		conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer <= (uint32_t)b.integer; });break;
+		break;
+	case prog::Instruction::Operation::jGeU:
+		conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer >= (uint32_t)b.integer; });break;
+		break;
+	case prog::Instruction::Operation::jLtF:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.floating < b.floating; });
+		break;
+	case prog::Instruction::Operation::jGtF:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.floating > b.floating; });
+		break;
+	case prog::Instruction::Operation::jLeF:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.floating <= b.floating; });
+		break;
+	case prog::Instruction::Operation::jGeF:
+		conditional(es, isn, [](const auto& a, const auto& b){ return a.floating >= b.floating; });
+		break;
+	case prog::Instruction::Operation::addI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer + b.integer; });
+		break;
+	case prog::Instruction::Operation::mulI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer * b.integer; });
+		break;
+	case prog::Instruction::Operation::subI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer - b.integer; });
+		break;
+	case prog::Instruction::Operation::divI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer / b.integer; });
+		break;
+	case prog::Instruction::Operation::mod:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer % b.integer; });
+		break;
+	case prog::Instruction::Operation::shlI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer << b.integer; });
+		break;
+	case prog::Instruction::Operation::shrI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer >> b.integer; });
+		break;
+	case prog::Instruction::Operation::shrU:
+		binary(es, isn, [](const auto& a, const auto& b){ return (int)(((uint32_t)a.integer) >> b.integer); });
+		break;
+	case prog::Instruction::Operation::andI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer & b.integer; });
+		break;
+	case prog::Instruction::Operation::orI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer | b.integer; });
+		break;
+	case prog::Instruction::Operation::xorI:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.integer ^ b.integer; });
+		break;
+	case prog::Instruction::Operation::addF:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.floating + b.floating; });
+		break;
+	case prog::Instruction::Operation::mulF:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.floating * b.floating; });
+		break;
+	case prog::Instruction::Operation::subF:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.floating - b.floating; });
+		break;
+	case prog::Instruction::Operation::divF:
+		binary(es, isn, [](const auto& a, const auto& b){ return a.floating / b.floating; });
+		break;
+	case prog::Instruction::Operation::agets:
 		{
-		case prog::Instruction::Operation::lit:
-			this->writes(es, isn.x, (int)isn.imm);
-			break;
-		case prog::Instruction::Operation::make:
-			assert(isn.imm < program.types.size());
-			this->writer(es, isn.x, isn.imm ? storage.create(program.types[isn.imm]) : null);
-			break;
-		case prog::Instruction::Operation::jNul:
-			if(readr(es, isn.x) == null)
+			const auto array = this->readr(es, isn.y);
+			this->writes(es, isn.x, storage.reads(array, (uint32_t)this->reads(es, isn.z).integer));
+		}
+		break;
+	case prog::Instruction::Operation::aputs:
+		{
+			const auto array = this->readr(es, isn.y);
+			const auto value = this->reads(es, isn.x);
+			storage.writes(array, (uint32_t)this->reads(es, isn.z).integer, value);
+		}
+		break;
+	case prog::Instruction::Operation::agetr:
+		{
+			const auto array = this->readr(es, isn.y);
+			this->writer(es, isn.x, storage.readr(array, (uint32_t)this->reads(es, isn.z).integer));
+		}
+		break;
+	case prog::Instruction::Operation::aputr:
+		{
+			const auto array = this->readr(es, isn.y);
+			const auto value = this->readr(es, isn.x);
+			storage.writer(array, (uint32_t)this->reads(es, isn.z).integer, value);
+		}
+		break;
+	case prog::Instruction::Operation::ld1i:
+		load<int8_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::ld1u:
+		load<uint8_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::ld2i:
+		load<int16_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::ld2u:
+		load<uint16_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::ld4:
+		load<int32_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::st1:
+		store<uint8_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::st2:
+		store<uint16_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::st4:
+		store<uint32_t>(es, isn);
+		break;
+	case prog::Instruction::Operation::jump:
+		if(tier && isn.imm < es.isnIt - program.functions[es.functionIndex].code.cbegin())
+		{
+			jump(es, isn.imm);
+
+			if(tier->countBackEdge(es.functionIndex))
 			{
-				jump(es, isn.imm);
+				return Exit::Transfer;
 			}
-			break;
-		case prog::Instruction::Operation::jNnl:
-			if(readr(es, isn.x) != null)
+		}
+		else
+		{
+			jump(es, isn.imm);
+		}
+		break;
+	case prog::Instruction::Operation::ncall:
+		callNative(es, isn.imm);
+		break;
+	case prog::Instruction::Operation::drop:
+		taker(es, isn.imm);
+		takes(es, isn.imm2);
+		break;
+	case prog::Instruction::Operation::call:
+		{
+			const auto calleeIdx = (uint32_t)reads(es, {}).integer;
+			assert(calleeIdx < decoded.callees.size());
+			return call(es, decoded.callees[calleeIdx], isn.imm, isn.imm2);
+		}
+	case prog::Instruction::Operation::ret:
+		if(auto prevFrame = getCallerFrame(es); prevFrame != staticObject)
+		{
+			ret(es, prevFrame, isn.imm, isn.imm2);
+			PROFILE(ret());
+
+			if(tier)
 			{
-				jump(es, isn.imm);
+				return Exit::Transfer;
 			}
-			break;
-		case prog::Instruction::Operation::movr:
-			this->writer(es, isn.x, this->readr(es, isn.y));
-			break;
-		case prog::Instruction::Operation::mov:
-			unary(es, isn, [](const auto& v){ return v; });
-			break;
-		case prog::Instruction::Operation::neg:
-			unary(es, isn, [](const auto& v){ return ~v.integer; });
-			break;
-		case prog::Instruction::Operation::i2f:
-			unary(es, isn, [](const auto& v){ return (float)(v.integer); });
-			break;
-		case prog::Instruction::Operation::f2i:
-			unary(es, isn, [](const auto& v){ return (int)(v.floating); });
-			break;
-//		case prog::Instruction::Operation::x1i:
-//			unary(es, isn, [](const auto& v){ return (int)(int32_t)((int8_t)v.integer); });
-//			break;
-//		case prog::Instruction::Operation::x1u:
-//			unary(es, isn, [](const auto& v){ return (int)(uint32_t)((uint8_t)v.integer); });
-//			break;
-//		case prog::Instruction::Operation::x2i:
-//			unary(es, isn, [](const auto& v){ return (int)(int32_t)((int16_t)v.integer); });
-//			break;
-//		case prog::Instruction::Operation::x2u:
-//			unary(es, isn, [](const auto& v){ return (int)(uint32_t)((uint16_t)v.integer); });
-//			break;
-		case prog::Instruction::Operation::getr:
-			this->writer(es, isn.x, storage.readr(this->readr(es, isn.y), isn.imm));
-			break;
-		case prog::Instruction::Operation::putr:
-			storage.writer(this->readr(es, isn.y), isn.imm, this->readr(es, isn.x));
-			break;
-		case prog::Instruction::Operation::gets:
-			this->writes(es, isn.x, storage.reads(this->readr(es, isn.y), isn.imm));
-			break;
-		case prog::Instruction::Operation::puts:
-			storage.writes(this->readr(es, isn.y), isn.imm, this->reads(es, isn.x));
-			break;
-		case prog::Instruction::Operation::jEq:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.integer == b.integer; });
-			break;
-		case prog::Instruction::Operation::jNe:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.integer != b.integer; });
-			break;
-		case prog::Instruction::Operation::jLtI:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.integer < b.integer; });
-			break;
-		case prog::Instruction::Operation::jGtI:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.integer > b.integer; });
-			break;
-		case prog::Instruction::Operation::jLeI:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.integer <= b.integer; });
-			break;
-		case prog::Instruction::Operation::jGeI:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.integer >= b.integer; });
-			break;
-		case prog::Instruction::Operation::jLtU:
-			conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer < (uint32_t)b.integer; });break;
-			break;
-		case prog::Instruction::Operation::jGtU:
-			conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer > (uint32_t)b.integer; });break;
-			break;
-		case prog::Instruction::Operation::jLeU:
-			conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer <= (uint32_t)b.integer; });break;
-			break;
-		case prog::Instruction::Operation::jGeU:
-			conditional(es, isn, [](const auto& a, const auto& b){ return (uint32_t)a.integer >= (uint32_t)b.integer; });break;
-			break;
-		case prog::Instruction::Operation::jLtF:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.floating < b.floating; });
-			break;
-		case prog::Instruction::Operation::jGtF:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.floating > b.floating; });
-			break;
-		case prog::Instruction::Operation::jLeF:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.floating <= b.floating; });
-			break;
-		case prog::Instruction::Operation::jGeF:
-			conditional(es, isn, [](const auto& a, const auto& b){ return a.floating >= b.floating; });
-			break;
-		case prog::Instruction::Operation::addI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer + b.integer; });
-			break;
-		case prog::Instruction::Operation::mulI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer * b.integer; });
-			break;
-		case prog::Instruction::Operation::subI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer - b.integer; });
-			break;
-		case prog::Instruction::Operation::divI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer / b.integer; });
-			break;
-		case prog::Instruction::Operation::mod:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer % b.integer; });
-			break;
-		case prog::Instruction::Operation::shlI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer << b.integer; });
-			break;
-		case prog::Instruction::Operation::shrI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer >> b.integer; });
-			break;
-		case prog::Instruction::Operation::shrU:
-			binary(es, isn, [](const auto& a, const auto& b){ return (int)(((uint32_t)a.integer) >> b.integer); });
-			break;
-		case prog::Instruction::Operation::andI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer & b.integer; });
-			break;
-		case prog::Instruction::Operation::orI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer | b.integer; });
-			break;
-		case prog::Instruction::Operation::xorI:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.integer ^ b.integer; });
-			break;
-		case prog::Instruction::Operation::addF:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.floating + b.floating; });
-			break;
-		case prog::Instruction::Operation::mulF:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.floating * b.floating; });
-			break;
-		case prog::Instruction::Operation::subF:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.floating - b.floating; });
-			break;
-		case prog::Instruction::Operation::divF:
-			binary(es, isn, [](const auto& a, const auto& b){ return a.floating / b.floating; });
-			break;
-		case prog::Instruction::Operation::jump:
-			jump(es, isn.imm);
-			break;
-		case prog::Instruction::Operation::drop:
-			taker(es, isn.imm);
-			takes(es, isn.imm2);
-			break;
-		case prog::Instruction::Operation::call:
+		}
+		else
+		{
+			results = std::make_pair(taker(es, isn.imm), takes(es, isn.imm2));
+			PROFILE(leave());
+			return Exit::Returned;
+		}
+		break;
+	case prog::Instruction::Operation::raise:
+		return raise(es, readr(es, {}));
+	case prog::Instruction::Operation::yield:
+		suspend(es);
+		PROFILE(leave());
+		return Exit::Yielded;
+	case prog::Instruction::Operation::await:
+		if(const auto co = readr(es, {}); storage.readr(co, Coroutine::Reference::frameOffset) == null)
+		{
+			// Raised again in the awaiting one if ended by an exception.
+			if(const auto e = getException(co); e != null)
 			{
-				const auto calleeIdx = (uint32_t)reads(es, {}).integer;
-				const auto rs = taker(es, isn.imm);
-				const auto ss = takes(es, isn.imm2);
-				es = enter(calleeIdx, suspend(es));
-				putr(es, rs);
-				puts(es, ss);
+				return raise(es, e);
 			}
-			// TODO
-			break;
-		case prog::Instruction::Operation::ret:
-			if(auto prevFrame = getCallerFrame(es); prevFrame != staticObject)
+
+			const auto r = getResults(co);
+			assert(r.first.size() == isn.imm && r.second.size() == isn.imm2);
+			putr(es, r.first);
+			puts(es, r.second);
+		}
+		else
+		{
+			// Re-executed upon resumption, when the awaited one is already finished.
+			writer(es, {}, co);
+			es.isnIt--;
+			suspend(es);
+			awaited = co;
+			PROFILE(leave());
+			return Exit::Awaiting;
+		}
+		break;
+	case prog::Instruction::Operation::bcpy: // (dst, src) (dstOffset, srcOffset, length)
+		{
+			const auto length = (uint32_t)reads(es, {}).integer;
+			const auto srcOffset = (uint32_t)reads(es, {}).integer;
+			const auto dstOffset = (uint32_t)reads(es, {}).integer;
+			const auto src = readr(es, {});
+			const auto dst = readr(es, {});
+			const auto to = storage.accessBytes(dst, dstOffset, length), from = storage.accessBytes(src, srcOffset, length);
+
+			// The empty buffers have no bytes allocated, which the library functions must not be given.
+			if(length)
 			{
-				const auto rs = taker(es, isn.imm);
-				const auto ss = takes(es, isn.imm2);
-				es = resume(prevFrame);
-				putr(es, rs);
-				puts(es, ss);
+				memmove(to, from, length);
 			}
-			else
+		}
+		break;
+	case prog::Instruction::Operation::bset: // (dst) (offset, value, length)
+		{
+			const auto length = (uint32_t)reads(es, {}).integer;
+			const auto value = reads(es, {}).integer;
+			const auto offset = (uint32_t)reads(es, {}).integer;
+			const auto dst = readr(es, {});
+			const auto to = storage.accessBytes(dst, offset, length);
+
+			if(length)
 			{
-				return std::make_pair(taker(es, isn.imm), takes(es, isn.imm2));
+				memset(to, value, length);
 			}
-			break;
 		}
+		break;
+	case prog::Instruction::Operation::bcmp: // (a, b) (aOffset, bOffset, length) -> sign
+		{
+			const auto length = (uint32_t)reads(es, {}).integer;
+			const auto bOffset = (uint32_t)reads(es, {}).integer;
+			const auto aOffset = (uint32_t)reads(es, {}).integer;
+			const auto b = readr(es, {});
+			const auto a = readr(es, {});
+			const auto first = storage.accessBytes(a, aOffset, length), second = storage.accessBytes(b, bOffset, length);
+			const auto r = length ? memcmp(first, second, length) : 0;
+			writes(es, {}, (r > 0) - (r < 0));
+		}
+		break;
+	case prog::Instruction::Operation::jEqL:
+		if(reads(es, isn.x).integer == (int)isn.imm)
+		{
+			jump(es, isn.imm2);
+		}
+		break;
+	case prog::Instruction::Operation::jNeL:
+		if(reads(es, isn.x).integer != (int)isn.imm)
+		{
+			jump(es, isn.imm2);
+		}
+		break;
+	case prog::Instruction::Operation::jLtIL:
+		if(reads(es, isn.x).integer < (int)isn.imm)
+		{
+			jump(es, isn.imm2);
+		}
+		break;
+	case prog::Instruction::Operation::addIL:
+		writes(es, isn.x, reads(es, isn.y).integer + (int)isn.imm);
+		break;
+	case prog::Instruction::Operation::subIL:
+		writes(es, isn.x, reads(es, isn.y).integer - (int)isn.imm);
+		break;
+	case prog::Instruction::Operation::callL:
+		return call(es, decoded.callees[isn.imm], isn.imm2 >> 16, isn.imm2 & 0xffff);
+	case prog::Instruction::Operation::vcall: // Dispatched on the first reference argument
+		{
+			const auto nReferences = isn.imm2 >> 16;
+			assert(0 < nReferences && nReferences <= es.referenceStackPointer);
+			const auto receiver = storage.readr(es.frame, Frame::Reference::stackOffset + es.referenceStackPointer - nReferences);
+			const auto &table = decoded.methods[storage.getTypeIndex(receiver)];
+			assert(isn.imm < table.size());
+			return call(es, *table[isn.imm], nReferences, isn.imm2 & 0xffff);
+		}
+	case prog::Instruction::Operation::iof:
+		this->writes(es, isn.x, (int)isInstance(this->readr(es, isn.y), isn.imm));
+		break;
 	}
 
-	return {};
+	return Exit::Continue;
+}
+
+Vm::Exit Vm::interpret(ExecutionState& es, const prog::Instruction& isn, Results& results, Reference& awaited) {
+	return step(es, isn, results, awaited);
+}
+
+inline Vm::Exit Vm::execute(ExecutionState& es, Results& results, Reference& awaited)
+{
+	PROFILE(enter(getCallStack(es)));
+
+	while(true)
+	{
+		Exit exit;
+
+		if(tier && tier->isCompiled(es.functionIndex))
+		{
+			exit = tier->run(es, results, awaited);
+		}
+		else
+		{
+			do
+			{
+				prog::Instruction isn;
+				auto fetchOk = fetch(es, isn);
+				assert(fetchOk);
+
+				PROFILE(step(es.functionIndex, (uint32_t)(es.isnIt - program.functions[es.functionIndex].code.begin() - 1), isn.op));
+				exit = step(es, isn, results, awaited);
+			}
+			while(exit == Exit::Continue);
+		}
+
+		if(exit != Exit::Transfer)
+		{
+			return exit;
+		}
+	}
+
+	return Exit::Returned; // GCOV_EXCL_LINE
+}
+
+std::pair<std::vector<Reference>, std::vector<Value>> Vm::run(std::vector<Reference> rargs, std::vector<Value> sargs)
+{
+	assert(!program.functions.empty());
+
+	auto es = enter(0, staticObject);
+	puts(es, sargs);
+	putr(es, rargs);
+
+	Results ret;
+	Reference awaited = null;
+	uncaught = null;
+	const auto exit = execute(es, ret, awaited);
+	assert(exit == Exit::Returned || exit == Exit::Raised); // Suspension is only allowed in coroutines
+
+	return ret;
+}
+
+Reference Vm::startCoroutine(uint32_t fnIdx, std::vector<Reference> rargs, std::vector<Value> sargs)
+{
+	auto es = enter(fnIdx, staticObject);
+	puts(es, sargs);
+	putr(es, rargs);
+
+	const auto ret = storage.create(Coroutine::type);
+	storage.writer(ret, Coroutine::Reference::frameOffset, suspend(es));
+	return ret;
+}
+
+Vm::CoroutineState Vm::resumeCoroutine(Reference co)
+{
+	const auto frame = storage.readr(co, Coroutine::Reference::frameOffset);
+	assert(frame != null); // Already finished
+
+	auto es = resume(frame);
+
+	Results results;
+	Reference awaited = null;
+	uncaught = null;
+
+	// Finished without results if ended by an uncaught exception, which is kept in the coroutine.
+	switch(execute(es, results, awaited))
+	{
+	case Exit::Yielded:
+		storage.writer(co, Coroutine::Reference::frameOffset, es.frame);
+		return CoroutineState::Yielded;
+	case Exit::Awaiting:
+		storage.writer(co, Coroutine::Reference::frameOffset, es.frame);
+		storage.writer(co, Coroutine::Reference::awaitedOffset, awaited);
+		return CoroutineState::Awaiting;
+	default:
+		{
+			const auto rs = storage.createArray(results.first.size(), 0);
+			copyReferences(results.first.begin(), results.first.end(), storage.accessReferences(rs));
+			storage.writer(co, Coroutine::Reference::resultReferencesOffset, rs);
+
+			const auto ss = storage.createArray(0, results.second.size());
+			std::copy(results.second.begin(), results.second.end(), storage.accessScalars(ss));
+			storage.writer(co, Coroutine::Reference::resultScalarsOffset, ss);
+
+			storage.writer(co, Coroutine::Reference::exceptionOffset, uncaught);
+			storage.writer(co, Coroutine::Reference::frameOffset, null);
+			storage.writer(co, Coroutine::Reference::awaitedOffset, null);
+			return CoroutineState::Finished;
+		}
+	}
+}
+
+Reference Vm::getAwaited(Reference co) const {
+	return storage.readr(co, Coroutine::Reference::awaitedOffset);
+}
+
+Reference Vm::getException(Reference co) const {
+	return storage.readr(co, Coroutine::Reference::exceptionOffset);
+}
+
+std::pair<std::vector<Reference>, std::vector<Value>> Vm::getResults(Reference co) const
+{
+	assert(storage.readr(co, Coroutine::Reference::frameOffset) == null); // Not finished yet
+
+	const auto rs = storage.readr(co, Coroutine::Reference::resultReferencesOffset);
+	const auto ss = storage.readr(co, Coroutine::Reference::resultScalarsOffset);
+	const auto r = storage.accessReferences(rs);
+	const auto s = storage.accessScalars(ss);
+
+	return std::make_pair(
+		std::vector<Reference>(r, r + storage.getLength(rs)),
+		std::vector<Value>(s, s + storage.getLength(ss)));
+}
+
+std::vector<Reference> Vm::addRoots(std::vector<Reference> roots) const
+{
+	roots.push_back(staticObject);
+
+	if(uncaught != null)
+	{
+		roots.push_back(uncaught);
+	}
+
+	return roots;
+}
+
+size_t Vm::gc(std::vector<Reference> roots) {
+	return storage.gc(addRoots(roots));
+}
+
+void Vm::startCollection(std::vector<Reference> roots) {
+	storage.startCollection(addRoots(roots));
+}
+
+void Vm::finishCollection(std::vector<Reference> roots) {
+	storage.finishCollection(addRoots(roots));
+}
+
+HeapSnapshot Vm::snapshot(std::vector<Reference> roots) const {
+	return storage.snapshot(addRoots(roots));
 }
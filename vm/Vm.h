@@ -2,17 +2,90 @@
 #define VM_H_
 
 #include "Storage.h"
+#include "Native.h"
 #include "program/Program.h"
 
+#ifdef VM_PROFILE
+#include "Profiler.h"
+#endif
+
 #include <vector>
+#include <memory>
 
 namespace vm {
 
+class ClosureTier;
+
 class Vm
 {
+public:
+	struct Statistics
+	{
+		uint64_t instructions = 0;
+		uint64_t calls = 0;
+		uint64_t tierUps = 0;
+	};
+
+private:
 	Storage& storage;
 	const prog::Program &program;
 	Reference staticObject;
+	Reference uncaught = null;
+	std::vector<NativeFunction> natives;
+	Statistics statistics;
+
+	/*
+	 * Call target decoded in advance, with the size of its frame already computed.
+	 */
+	struct Callee
+	{
+		prog::TypeInfo frameType;
+		uint32_t index, nRefs, nScalars;
+		decltype(prog::Function::code)::const_iterator begin, end;
+	};
+
+	/*
+	 * Position of a type in the preorder walk of the inheritance tree, along with the end of
+	 * the range of its subtypes, so that checking for subtyping is a pair of comparisons.
+	 */
+	struct TypeRange
+	{
+		uint32_t begin, end;
+	};
+
+public:
+	/*
+	 * The tables decoded from a program for executing it, immutable once built, so that any
+	 * number of instances running the same program can share them.
+	 */
+	class Decoded
+	{
+		friend Vm;
+		friend ClosureTier;
+
+		const prog::Program &program;
+		std::vector<Callee> callees;
+		std::vector<std::vector<const Callee*>> methods;
+		std::vector<TypeRange> typeRanges;
+
+		void decodeTypes();
+
+	public:
+		Decoded(const prog::Program &p);
+		Decoded(const Decoded&) = delete; // The method tables point into the callees
+	};
+
+private:
+	const std::unique_ptr<const Decoded> ownDecoded; // Only if not shared
+	const Decoded &decoded;
+
+	std::unique_ptr<ClosureTier> tier;
+
+#ifdef VM_PROFILE
+	Profiler* profiler = nullptr;
+#endif
+
+	friend ClosureTier;
 
 	struct ExecutionState
 	{
@@ -25,10 +98,20 @@ class Vm
 		inline ExecutionState() = default;
 	};
 
+	enum class Exit
+	{
+		Continue, Returned, Yielded, Awaiting, Raised,
+		Transfer // Switching to another function or tier, only used with the closure tier enabled.
+	};
+
+	typedef std::pair<std::vector<Reference>, std::vector<Value>> Results;
+
+	inline ExecutionState enter(const Callee& callee, Reference caller);
 	inline ExecutionState enter(uint32_t fnIdx, Reference caller);
 	inline Reference suspend(ExecutionState& es);
 	inline ExecutionState resume(Reference frame);
 	inline Reference getCallerFrame(ExecutionState& es);
+	inline void allocating(const ExecutionState& es);
 
 	inline bool fetch(ExecutionState& es, prog::Instruction& isn);
 	inline void jump(ExecutionState& es, uint32_t offset);
@@ -43,13 +126,76 @@ class Vm
 	inline void puts(ExecutionState& es, const std::vector<Value> & ss);
 	inline void putr(ExecutionState& es, const std::vector<Reference> & rs);
 
+	inline Exit call(ExecutionState& es, const Callee& callee, uint32_t nReferences, uint32_t nScalars);
+	Exit invoke(ExecutionState& es, const Callee& callee, uint32_t nReferences, uint32_t nScalars);
+	inline void ret(ExecutionState& es, Reference callerFrame, uint32_t nReferences, uint32_t nScalars);
+	inline void callNative(ExecutionState& es, uint32_t nativeIdx);
+	inline bool isInstance(Reference ref, uint32_t typeIdx);
+	inline Exit raise(ExecutionState& es, Reference exception);
+	std::vector<Reference> addRoots(std::vector<Reference> roots) const;
+	inline Exit step(ExecutionState& es, const prog::Instruction& isn, Results& results, Reference& awaited);
+	Exit interpret(ExecutionState& es, const prog::Instruction& isn, Results& results, Reference& awaited);
+	inline Exit execute(ExecutionState& es, Results& results, Reference& awaited);
+
+#ifdef VM_PROFILE
+	std::vector<uint32_t> getCallStack(const ExecutionState& es);
+#endif
+
 	template<class C> inline void unary(ExecutionState& es, const prog::Instruction& isn, C&& c);
 	template<class C> inline void conditional(ExecutionState& es, const prog::Instruction& isn, C&& c);
 	template<class C> inline void binary(ExecutionState& es, const prog::Instruction& isn, C&& c);
+	template<class T> inline void load(ExecutionState& es, const prog::Instruction& isn);
+	template<class T> inline void store(ExecutionState& es, const prog::Instruction& isn);
+	template<class T> inline void getPacked(ExecutionState& es, const prog::Instruction& isn);
+	template<class T> inline void putPacked(ExecutionState& es, const prog::Instruction& isn);
 
 public:
+	enum class CoroutineState
+	{
+		Yielded, Awaiting, Finished
+	};
+
 	Vm(Storage& storage, const prog::Program &p);
+	Vm(Storage& storage, const Decoded &d);
+	~Vm();
+
+	// Functions are translated to closures after being called or looping back the given number of times.
+	void enableClosureTier(uint32_t callThreshold = 100, uint32_t backEdgeThreshold = 1000);
+	uint32_t addNative(const NativeFunction& fn);
+
+	inline const Statistics& getStatistics() const {
+		return statistics;
+	}
+
+#ifdef VM_PROFILE
+	inline void setProfiler(Profiler* p) {
+		profiler = p;
+	}
+#endif
+
 	std::pair<std::vector<Reference>, std::vector<Value>> run(std::vector<Reference> rargs, std::vector<Value> sargs);
+
+	Reference startCoroutine(uint32_t fnIdx, std::vector<Reference> rargs, std::vector<Value> sargs);
+	CoroutineState resumeCoroutine(Reference co);
+	Reference getAwaited(Reference co) const;
+	std::pair<std::vector<Reference>, std::vector<Value>> getResults(Reference co) const;
+
+	// The exception that ended a finished coroutine (with no results), or null.
+	Reference getException(Reference co) const;
+
+	// The exception that ended the last run or coroutine resumption without being caught, or null.
+	inline Reference getUncaught() const {
+		return uncaught;
+	}
+
+	// Only between runs, every other live object must be reachable from the roots.
+	size_t gc(std::vector<Reference> roots);
+
+	// Background collection (see Storage), runs can be done between the start and the finish.
+	void startCollection(std::vector<Reference> roots);
+	void finishCollection(std::vector<Reference> roots);
+
+	HeapSnapshot snapshot(std::vector<Reference> roots) const;
 };
 
 } //namespace vm